@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_inject.c
+/// @brief    THIS FILE PROVIDES THE INJECTED ADC PHASE-CURRENT SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// TIM1 runs center-aligned mode 1, so compare flags are only raised while
+/// counting down. CCR4 = ARR - TriggerDelay therefore produces exactly one
+/// CC4 event per PWM period, just after the counter peak, in the middle of
+/// the low-side on-time where shunt currents are valid. That event starts
+/// the injected sequence. Each JOFRx holds the zero-current reading, so
+/// JDRx already reads as signed current.
+///
+/// The end-of-sequence interrupt costs one SREXT read and write, one JDR
+/// read per channel and two TIM1 reads for the latency, then the callback.
+/// Trigger-to-callback latency is the conversion time, (sample + 12.5) ADC
+/// clocks per channel, plus about 40 core cycles. For example, 3 channels at
+/// a 12 MHz ADC clock with 7.5 cycles sampling take 5 us + 0.6 us, which
+/// leaves 44 us of a 20 kHz period for the control loop. The measured value
+/// comes from TIM1 itself: ticks since CCR4 on the way down, or CCR4 plus
+/// the counter once the valley has been passed.
+///
+/// The application forwards the vector (shared with the comparators):
+///   void ADC_COMP_IRQHandler(void) { AdcInject_IRQHandler(&phase_adc); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_INJECT_C_
+
+// Files includes
+#include "adc_inject.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup ADC_INJECT
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: 7.5 cycles sampling, trigger one tick
+///         after the counter peak, no offsets.
+/// @param  init_struct: pointer to an AdcInject_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcInject_StructInit(AdcInject_InitTypeDef* init_struct)
+{
+    u8 i;
+
+    init_struct->Channels     = NULL;
+    init_struct->ChannelCount = 0;
+    for (i = 0; i < ADC_INJECT_MAX_CHANNELS; i++) {
+        init_struct->Offset[i] = 0;
+    }
+    init_struct->SampleTime   = ADC_Samctl_7_5;
+    init_struct->Prescaler    = ADC_PCLK2_PRESCARE_6;
+    init_struct->TriggerDelay = 1;
+    init_struct->TriggerShift = ADC_ANY_CR_JTRGSHIFT_0;
+    init_struct->Callback     = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Programs the injected sequence, the hardware offsets and the TIM1
+///         CC4 trigger, and enables the end-of-sequence interrupt. Regular
+///         conversions configured before (AdcScan) keep running.
+/// @param  inj: pointer to the service state.
+/// @param  init_struct: pointer to an AdcInject_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus AdcInject_Init(AdcInject_TypeDef* inj, const AdcInject_InitTypeDef* init_struct)
+{
+    ADC_InitTypeDef adc_init;
+    TIM_OCInitTypeDef oc_init;
+    u8 n = init_struct->ChannelCount;
+    u32 arr = TIM1->ARR;
+    u8 i;
+
+    if ((init_struct->Channels == NULL) || (n == 0) || (n > ADC_INJECT_MAX_CHANNELS) ||
+        (init_struct->TriggerDelay == 0) || (init_struct->TriggerDelay >= arr)) {
+        return ERROR;
+    }
+    inj->ChannelCount = n;
+    inj->Compare      = (u16)(arr - init_struct->TriggerDelay);
+    inj->Callback     = init_struct->Callback;
+    inj->Count        = 0;
+    for (i = 0; i < ADC_INJECT_MAX_CHANNELS; i++) {
+        inj->Sample[i] = 0;
+    }
+    AdcInject_ResetLatency(inj);
+
+    RCC_APB2PeriphClockCmd(RCC_APB2ENR_ADC1, ENABLE);
+    if (!(ADC1->ADCFG & ADC_CFGR_ADEN)) {
+        ADC_StructInit(&adc_init);
+        adc_init.ADC_PRESCARE = init_struct->Prescaler;
+        ADC_Init(ADC1, &adc_init);
+    }
+
+    ADC_InjectedSequencerLengthConfig(ADC1, (ADC_INJ_SEQ_LEN_TypeDef)(n - 1));
+    for (i = 0; i < n; i++) {
+        ADC_InjectedSequencerChannelConfig(ADC1, (ADC_INJ_SEQ_Channel_TypeDef)(i << 2),
+                                           (ADCCHANNEL_TypeDef)init_struct->Channels[i]);
+        ADC_SetInjectedOffset(ADC1, (ADC_INJ_SEQ_Channel_TypeDef)(i << 2), init_struct->Offset[i]);
+        ADC_RegularChannelConfig(ADC1, init_struct->Channels[i], 0, init_struct->SampleTime);
+    }
+    ADC_InjectedSequencerConfig(ADC1, ADC1_InjectExtTrigSrc_T1_CC4, init_struct->TriggerShift);
+    ADC1->SREXT = ADC_SREXT_JEOCIF | ADC_SREXT_JEOSIF;
+    ADC1->ANYCR |= ADC_ANY_CR_JEOSIE;
+    ADC_Cmd(ADC1, ENABLE);
+
+    // CC4 as a pure timing channel: no pin, only the compare event.
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OCMode = TIM_OCMode_Timing;
+    oc_init.TIM_Pulse  = inj->Compare;
+    TIM_OC4Init(TIM1, &oc_init);
+
+    DRV_NVICEnable(ADC_COMP_IRQn, 0);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Updates a hardware offset, e.g. after a zero-current calibration
+///         with the bridge off.
+/// @param  inj: pointer to the service state.
+/// @param  index: position in the injected sequence.
+/// @param  offset: raw reading at zero current.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcInject_SetOffset(AdcInject_TypeDef* inj, u8 index, u16 offset)
+{
+    if (index < inj->ChannelCount) {
+        ADC_SetInjectedOffset(ADC1, (ADC_INJ_SEQ_Channel_TypeDef)(index << 2), offset);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the measured trigger-to-callback latency.
+/// @param  inj: pointer to the service state.
+/// @param  worst: true for the maximum since the last reset, false for the
+///         latest sequence.
+/// @retval Latency in ns, 0 before the first sequence.
+////////////////////////////////////////////////////////////////////////////////
+u32 AdcInject_GetLatencyNs(AdcInject_TypeDef* inj, bool worst)
+{
+    u32 clock = DRV_TimerClock(TIM1) / (TIM1->PSC + 1);
+    u32 ticks = worst ? inj->LatencyMax : inj->LatencyLast;
+
+    return (u32)((u64)ticks * 1000000000 / clock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Restarts the latency statistics.
+/// @param  inj: pointer to the service state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcInject_ResetLatency(AdcInject_TypeDef* inj)
+{
+    inj->LatencyLast = 0;
+    inj->LatencyMin  = 0xFFFF;
+    inj->LatencyMax  = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Injected end-of-sequence service.
+/// @param  inj: pointer to the service state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcInject_IRQHandler(AdcInject_TypeDef* inj)
+{
+    u32 cnt, latency;
+    u8 i;
+
+    if (!(ADC1->SREXT & (0x01U << ADC_SREXT_JEOSIF_Pos))) {
+        return;
+    }
+    ADC1->SREXT = ADC_SREXT_JEOCIF | ADC_SREXT_JEOSIF;
+
+    for (i = 0; i < inj->ChannelCount; i++) {
+        inj->Sample[i] = (s16)ADC1->JDR[i];
+    }
+
+    cnt     = TIM1->CNT;
+    latency = (TIM1->CR1 & TIM_CR1_DIR) ? (inj->Compare - cnt) : (inj->Compare + cnt);
+    inj->LatencyLast = (u16)latency;
+    inj->LatencyMin  = (latency < inj->LatencyMin) ? (u16)latency : inj->LatencyMin;
+    inj->LatencyMax  = (latency > inj->LatencyMax) ? (u16)latency : inj->LatencyMax;
+    inj->Count++;
+
+    if (inj->Callback != NULL) {
+        inj->Callback(inj, inj->Sample);
+    }
+}
+
+/// @}
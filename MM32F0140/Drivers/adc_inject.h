@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_inject.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE INJECTED
+///           ADC PHASE-CURRENT SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __ADC_INJECT_H
+#define __ADC_INJECT_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_INJECT
+/// @brief Injected ADC phase-current service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_INJECT_Exported_Constants
+/// @{
+
+#define ADC_INJECT_MAX_CHANNELS     (4U)                                        ///< Injected sequence length
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_INJECT_Exported_Types
+/// @{
+
+struct _AdcInject;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sample hook, runs in ADC_COMP_IRQHandler once per PWM period.
+///         samples[i] is the conversion of Channels[i] minus Offset[i].
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*AdcInject_Callback)(struct _AdcInject* inj, const s16* samples);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Injected service init structure definition. TIM1 must already run
+///         center-aligned mode 1 (the PWM driver owns its time base).
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    const u8*                       Channels;                                   ///< ADCCHANNEL_TypeDef values, phase order
+    u8                              ChannelCount;                               ///< 1 to ADC_INJECT_MAX_CHANNELS
+    u16                             Offset[ADC_INJECT_MAX_CHANNELS];            ///< Zero-current reading, subtracted in hardware
+    ADCSAM_TypeDef                  SampleTime;
+    ADCPRE_TypeDef                  Prescaler;                                  ///< Used only if the ADC is not yet running
+    u16                             TriggerDelay;                               ///< TIM1 ticks after the counter peak, >= 1
+    u32                             TriggerShift;                               ///< ADC_ANY_CR_JTRGSHIFT_x, extra settling delay
+    AdcInject_Callback              Callback;
+} AdcInject_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Injected service state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _AdcInject {
+    u8                              ChannelCount;
+    u16                             Compare;                                    ///< CCR4 programmed for the trigger
+    s16                             Sample[ADC_INJECT_MAX_CHANNELS];            ///< Latest samples
+    AdcInject_Callback              Callback;
+    u32                             Count;                                      ///< Sequences serviced
+    u16                             LatencyLast;                                ///< TIM1 ticks, trigger to callback
+    u16                             LatencyMin;
+    u16                             LatencyMax;
+} AdcInject_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_INJECT_Exported_Functions
+/// @{
+
+void AdcInject_StructInit(AdcInject_InitTypeDef* init_struct);
+ErrorStatus AdcInject_Init(AdcInject_TypeDef* inj, const AdcInject_InitTypeDef* init_struct);
+void AdcInject_SetOffset(AdcInject_TypeDef* inj, u8 index, u16 offset);
+u32 AdcInject_GetLatencyNs(AdcInject_TypeDef* inj, bool worst);
+void AdcInject_ResetLatency(AdcInject_TypeDef* inj);
+void AdcInject_IRQHandler(AdcInject_TypeDef* inj);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __ADC_INJECT_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_scan.c
+/// @brief    THIS FILE PROVIDES THE ADC MULTI-CHANNEL SCAN ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The ANY-channel sequencer converts Channels in order, continuously.
+/// DMA1_Channel1 streams ADDATA into a circular buffer of two halves of
+/// Frames scans each. The half and full transfer interrupts fold the half
+/// the DMA just left into per-channel accumulators. Every 2^Oversample
+/// scans, the accumulators are shifted into Value:
+///   - averaging:  sum >> Oversample, 12-bit result, less noise;
+///   - decimation: sum >> (Oversample - Oversample / 2), i.e. 12 + Oversample/2
+///     bits. This only gains resolution when the input carries at least an
+///     LSB of noise.
+/// AdcScan_GetValue is a table lookup, so consumers pay nothing for it.
+///
+/// Throughput is ADC clock / (sample time + 12.5) conversions per second,
+/// shared by the channels. For example, PCLK2 = 72 MHz, prescaler 16 and
+/// 29.5 cycles sampling give 107 kS/s in total, or 8.9 kS/s for each of 12
+/// channels. The accumulate loop costs about 8 cycles per sample, so 100 kS/s
+/// is 0.8 Mcycles/s. With Frames = 32, each interrupt covers 384 samples, or
+/// 260 interrupts/s at roughly 100 cycles of entry and exit each, and the
+/// per-channel passes and published results add about 0.15 Mcycles/s. The
+/// total, as counted by host/adc_scan_bench.c, is about 1.4 % of a 72 MHz
+/// core.
+///
+/// With Trigger set, the timer's update event is routed to TRGO and starts
+/// one scan per period (single-period scan mode, rising edge). PSC/ARR are
+/// derived from the timer clock for ScanRate. The sample instants are then
+/// fixed by hardware, not by interrupt latency, to within one ADC clock.
+/// A scan must complete within a period, otherwise triggers are lost. The
+/// DMA interrupt reads the timer counter and the DMA position to record how
+/// long after the half's last trigger it ran. AdcScan_GetTiming reports the
+/// rate actually achieved and the spread of that service latency.
+///
+/// The application forwards the DMA vector:
+///   void DMA1_Channel1_IRQHandler(void) { AdcScan_DMAIRQHandler(&adc_scan); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_SCAN_C_
+
+// Files includes
+#include "adc_scan.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup ADC_SCAN
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Folds one half buffer into the accumulators and publishes every
+///         completed result set.
+/// @param  scan: pointer to the scan state.
+/// @param  half: first scan of the half.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void AdcScan_Accumulate(AdcScan_TypeDef* scan, const u16* half)
+{
+    u32 n = scan->ChannelCount;
+    u32 left = scan->Frames;
+    u32 chunk, ch, f, sum;
+    const u16* p;
+
+    while (left != 0) {
+        chunk = scan->Ratio - scan->Count;
+        if (chunk > left) {
+            chunk = left;
+        }
+        for (ch = 0; ch < n; ch++) {
+            p   = half + ch;
+            sum = 0;
+            for (f = 0; f < chunk; f++) {
+                sum += *p;
+                p   += n;
+            }
+            scan->Acc[ch] += sum;
+        }
+        half          += chunk * n;
+        left          -= chunk;
+        scan->Count   += chunk;
+        scan->Samples += chunk * n;
+        scan->Chunks++;
+
+        if (scan->Count == scan->Ratio) {
+            for (ch = 0; ch < n; ch++) {
+                scan->Value[ch] = (u16)(scan->Acc[ch] >> scan->Shift);
+                scan->Acc[ch]   = 0;
+            }
+            scan->Count = 0;
+            scan->Results++;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default scan settings: ADC clock PCLK2 / 16, 29.5 cycles
+///         sampling, averaging over 16 scans.
+/// @param  init_struct: pointer to an AdcScan_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcScan_StructInit(AdcScan_InitTypeDef* init_struct)
+{
+    init_struct->Channels     = NULL;
+    init_struct->ChannelCount = 0;
+    init_struct->Prescaler    = ADC_PCLK2_PRESCARE_16;
+    init_struct->SampleTime   = ADC_Samctl_29_5;
+    init_struct->Oversample   = 4;
+    init_struct->Decimate     = false;
+    init_struct->Buffer       = NULL;
+    init_struct->Frames       = 0;
+    init_struct->Callback     = NULL;
+    init_struct->Trigger      = NULL;
+    init_struct->ScanRate     = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Programs the pacing timer for the requested scan rate and routes
+///         its update event to TRGO.
+/// @param  scan: pointer to the scan state.
+/// @param  tim: TIM1, TIM2 or TIM3.
+/// @param  rate: scans per second.
+/// @retval ERROR if the rate cannot be reached.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus AdcScan_SetupTrigger(AdcScan_TypeDef* scan, TIM_TypeDef* tim, u32 rate)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    u32 clock = DRV_TimerClock(tim);
+    u32 ticks, prescaler;
+
+    if ((rate == 0) || (rate > clock / 2)) {
+        return ERROR;
+    }
+    ticks     = (clock + rate / 2) / rate;
+    prescaler = (tim == TIM2) ? 0 : (ticks - 1) / 0x10000;
+    if (prescaler > 0xFFFF) {
+        return ERROR;
+    }
+    scan->TickClock = clock / (prescaler + 1);
+    scan->Period    = (scan->TickClock + rate / 2) / rate;
+
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = (u16)prescaler;
+    tim_init.TIM_Period    = scan->Period - 1;
+    TIM_TimeBaseInit(tim, &tim_init);
+    TIM_SelectOutputTrigger(tim, TIM_TRIGSource_Update);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures ADC1 for a continuous ANY-channel scan and prepares
+///         the DMA channel. Nothing converts until AdcScan_Start.
+/// @param  scan: pointer to the scan state.
+/// @param  init_struct: pointer to an AdcScan_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus AdcScan_Init(AdcScan_TypeDef* scan, const AdcScan_InitTypeDef* init_struct)
+{
+    ADC_InitTypeDef adc_init;
+    u8 n = init_struct->ChannelCount;
+    u8 i;
+
+    if ((init_struct->Channels == NULL) || (n == 0) || (n > ADC_SCAN_MAX_CHANNELS) ||
+        (init_struct->Oversample > ADC_SCAN_MAX_OVERSAMPLE) || (init_struct->Buffer == NULL) ||
+        (init_struct->Frames == 0) || ((u32)init_struct->Frames * n * 2 > 0xFFFF)) {
+        return ERROR;
+    }
+
+    scan->Buffer       = init_struct->Buffer;
+    scan->Frames       = init_struct->Frames;
+    scan->ChannelCount = n;
+    scan->Ratio        = (u16)(1U << init_struct->Oversample);
+    scan->Shift        = init_struct->Decimate ? (u8)(init_struct->Oversample - init_struct->Oversample / 2) :
+                                                 init_struct->Oversample;
+    scan->Callback     = init_struct->Callback;
+    scan->Trigger      = init_struct->Trigger;
+    for (i = 0; i < ADC_SCAN_MAX_CHANNELS; i++) {
+        scan->Rank[i] = 0xFF;
+    }
+    for (i = 0; i < n; i++) {
+        scan->Rank[init_struct->Channels[i] & 0x0F] = i;
+    }
+
+    RCC_APB2PeriphClockCmd(RCC_APB2ENR_ADC1, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+
+    ADC_StructInit(&adc_init);
+    adc_init.ADC_Resolution = ADC_Resolution_12b;
+    adc_init.ADC_PRESCARE   = init_struct->Prescaler;
+    adc_init.ADC_Mode       = ADC_Mode_Continue;
+    adc_init.ADC_DataAlign  = ADC_DataAlign_Right;
+    if (scan->Trigger != NULL) {
+        if ((scan->Trigger != TIM1) && (scan->Trigger != TIM2) && (scan->Trigger != TIM3)) {
+            return ERROR;
+        }
+        if (AdcScan_SetupTrigger(scan, scan->Trigger, init_struct->ScanRate) != SUCCESS) {
+            return ERROR;
+        }
+        adc_init.ADC_Mode             = ADC_Mode_Scan;
+        adc_init.ADC_ExternalTrigConv = (scan->Trigger == TIM1) ? ADC1_ExternalTrigConv_T1_TRIG :
+                                        (scan->Trigger == TIM2) ? ADC1_ExternalTrigConv_T2_TRIG :
+                                                                  ADC1_ExternalTrigConv_T3_TRIG;
+    }
+    ADC_Init(ADC1, &adc_init);
+    // TRGO is a pulse: only its rising edge may start a scan.
+    ADC1->ADCR = (ADC1->ADCR & ~(ADC_CR_TRG_EDGE | ADC_CR_TRGSHIFT)) | ADC_CR_TRG_EDGE_UP;
+    ADC_ExternalTrigConvCmd(ADC1, (scan->Trigger != NULL) ? ENABLE : DISABLE);
+
+    ADC_ANY_NUM_Config(ADC1, n - 1);
+    for (i = 0; i < n; i++) {
+        ADC_ANY_CH_Config(ADC1, i, (ADCCHANNEL_TypeDef)init_struct->Channels[i]);
+        ADC_RegularChannelConfig(ADC1, init_struct->Channels[i], 0, init_struct->SampleTime);
+    }
+    ADC_ANY_Cmd(ADC1, ENABLE);
+
+    DRV_NVICEnable(DMA1_Channel1_IRQn, 1);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Clears the filters and starts the acquisition.
+/// @param  scan: pointer to the scan state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcScan_Start(AdcScan_TypeDef* scan)
+{
+    u8 i;
+
+    for (i = 0; i < scan->ChannelCount; i++) {
+        scan->Acc[i]   = 0;
+        scan->Value[i] = ADC_SCAN_NO_VALUE;
+    }
+    scan->Count      = 0;
+    scan->Results    = 0;
+    scan->Chunks     = 0;
+    scan->Samples    = 0;
+    scan->Late       = 0;
+    scan->Errors     = 0;
+    scan->LatencyMin = 0xFFFFFFFF;
+    scan->LatencyMax = 0;
+
+    DRV_DMAStart(DMA1_Channel1,
+                 DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_MSIZE_HALFWORD | DMA_CCR_PSIZE_WORD |
+                 DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_High,
+                 (u32)&ADC1->ADDATA, (u32)scan->Buffer, (u16)(scan->Frames * scan->ChannelCount * 2));
+    ADC_DMACmd(ADC1, ENABLE);
+    ADC_Cmd(ADC1, ENABLE);
+    if (scan->Trigger != NULL) {
+        TIM_SetCounter(scan->Trigger, 0);
+        TIM_Cmd(scan->Trigger, ENABLE);
+    }
+    else {
+        ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stops the acquisition; Value keeps the last results.
+/// @param  scan: pointer to the scan state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcScan_Stop(AdcScan_TypeDef* scan)
+{
+    if (scan->Trigger != NULL) {
+        TIM_Cmd(scan->Trigger, DISABLE);
+    }
+    ADC_SoftwareStartConvCmd(ADC1, DISABLE);
+    ADC_Cmd(ADC1, DISABLE);
+    ADC_DMACmd(ADC1, DISABLE);
+    DMA1_Channel1->CCR = 0;
+    DMA1->IFCR = DMA_CHANNEL_FLAGS(DMA1_Channel1, DMAx_FLAG_GLy | DMAx_FLAG_TCy | DMAx_FLAG_HTy | DMAx_FLAG_TEy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the latest filtered result of a channel.
+/// @param  scan: pointer to the scan state.
+/// @param  channel: ADCCHANNEL_TypeDef value.
+/// @retval Result, or ADC_SCAN_NO_VALUE if the channel is not scanned or has
+///         no result yet.
+////////////////////////////////////////////////////////////////////////////////
+u16 AdcScan_GetValue(AdcScan_TypeDef* scan, u8 channel)
+{
+    u8 rank = scan->Rank[channel & 0x0F];
+
+    return (rank == 0xFF) ? ADC_SCAN_NO_VALUE : scan->Value[rank];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reports the achieved scan rate and the measured service jitter of
+///         a paced acquisition. All fields are 0 when free-running.
+/// @param  scan: pointer to the scan state.
+/// @param  timing: receives the report.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcScan_GetTiming(AdcScan_TypeDef* scan, AdcScan_TimingTypeDef* timing)
+{
+    u32 min = scan->LatencyMin, max = scan->LatencyMax;
+
+    timing->RateMilliHz  = 0;
+    timing->LatencyMaxNs = 0;
+    timing->JitterNs     = 0;
+    if (scan->Trigger == NULL) {
+        return;
+    }
+    timing->RateMilliHz = (u32)(((u64)scan->TickClock * 1000 + scan->Period / 2) / scan->Period);
+    if (min <= max) {
+        timing->LatencyMaxNs = (u32)((u64)max * 1000000000 / scan->TickClock);
+        timing->JitterNs     = (u32)((u64)(max - min) * 1000000000 / scan->TickClock);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service: filters the half the DMA just finished.
+/// @param  scan: pointer to the scan state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcScan_DMAIRQHandler(AdcScan_TypeDef* scan)
+{
+    u32 isr = DMA1->ISR & DMA_CHANNEL_FLAGS(DMA1_Channel1, 0x0F);
+    u32 ht  = DMA_CHANNEL_FLAGS(DMA1_Channel1, DMAx_FLAG_HTy);
+    u32 tc  = DMA_CHANNEL_FLAGS(DMA1_Channel1, DMAx_FLAG_TCy);
+    u32 half_items = (u32)scan->Frames * scan->ChannelCount;
+    u32 results = scan->Results;
+    u32 count, done, latency;
+
+    if (isr == 0) {
+        return;
+    }
+    if (scan->Trigger != NULL) {
+        // Counter ticks since the last trigger, plus one period for each
+        // scan already converted past the half boundary.
+        count = scan->Trigger->CNT;
+        done  = half_items * 2 - DMA1_Channel1->CNDTR;
+        done  = (done >= half_items) ? done - half_items : done;
+        latency = (done / scan->ChannelCount) * scan->Period + count;
+        scan->LatencyMin = (latency < scan->LatencyMin) ? latency : scan->LatencyMin;
+        scan->LatencyMax = (latency > scan->LatencyMax) ? latency : scan->LatencyMax;
+    }
+    DMA1->IFCR = isr;
+
+    if (isr & DMA_CHANNEL_FLAGS(DMA1_Channel1, DMAx_FLAG_TEy)) {
+        scan->Errors++;
+        return;
+    }
+    if ((isr & ht) && (isr & tc)) {
+        // Only the half the DMA is not writing is still consistent.
+        scan->Late++;
+        isr &= (DMA1_Channel1->CNDTR > half_items) ? ~ht : ~tc;
+    }
+    if (isr & ht) {
+        AdcScan_Accumulate(scan, scan->Buffer);
+    }
+    if (isr & tc) {
+        AdcScan_Accumulate(scan, scan->Buffer + half_items);
+    }
+    if ((scan->Callback != NULL) && (scan->Results != results)) {
+        scan->Callback(scan);
+    }
+}
+
+/// @}
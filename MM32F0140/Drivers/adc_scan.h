@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_scan.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE ADC
+///           MULTI-CHANNEL SCAN ENGINE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __ADC_SCAN_H
+#define __ADC_SCAN_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SCAN
+/// @brief ADC multi-channel scan engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SCAN_Exported_Constants
+/// @{
+
+#define ADC_SCAN_MAX_CHANNELS       (16U)                                       ///< ANY-channel sequence length
+#define ADC_SCAN_MAX_OVERSAMPLE     (8U)                                        ///< log2 of the largest oversampling ratio
+#define ADC_SCAN_NO_VALUE           (0xFFFFU)                                   ///< Channel not in the sequence, or no result yet
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SCAN_Exported_Types
+/// @{
+
+struct _AdcScan;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  New-results hook, runs in the DMA interrupt after Value is updated.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*AdcScan_Callback)(struct _AdcScan* scan);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  ADC scan init structure definition. Pins (analog mode) and the
+///         internal sensor enables are left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    const u8*                       Channels;                                   ///< ADCCHANNEL_TypeDef values in conversion order
+    u8                              ChannelCount;                               ///< 1 to ADC_SCAN_MAX_CHANNELS
+    ADCPRE_TypeDef                  Prescaler;                                  ///< ADC clock = PCLK2 / prescaler
+    ADCSAM_TypeDef                  SampleTime;                                 ///< Applied to every channel in the sequence
+    u8                              Oversample;                                 ///< log2 of the samples per result, 0 to 8
+    bool                            Decimate;                                   ///< Keep Oversample / 2 extra bits instead of averaging
+    u16*                            Buffer;                                     ///< 2 * Frames * ChannelCount halfwords
+    u16                             Frames;                                     ///< Scans per half buffer
+    AdcScan_Callback                Callback;                                   ///< Optional
+    TIM_TypeDef*                    Trigger;                                    ///< TIM1, TIM2 or TIM3 paces the scans, NULL = free-running
+    u32                             ScanRate;                                   ///< Scans per second when Trigger is set
+} AdcScan_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Paced acquisition timing report
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             RateMilliHz;                                ///< Scan rate the timer really runs at
+    u32                             LatencyMaxNs;                               ///< Worst half-buffer service latency
+    u32                             JitterNs;                                   ///< Spread of the service latency
+} AdcScan_TimingTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  ADC scan state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _AdcScan {
+    u16*                            Buffer;
+    u16                             Frames;
+    u8                              ChannelCount;
+    u8                              Shift;                                      ///< Applied to the accumulated sum
+    u16                             Ratio;                                      ///< Samples per result
+    u16                             Count;                                      ///< Samples accumulated so far
+    u8                              Rank[ADC_SCAN_MAX_CHANNELS];                ///< Channel -> position in the sequence, 0xFF if absent
+    u32                             Acc[ADC_SCAN_MAX_CHANNELS];                 ///< Per position
+    volatile u16                    Value[ADC_SCAN_MAX_CHANNELS];               ///< Latest result per position
+    volatile u32                    Results;                                    ///< Result sets published
+    u32                             Chunks;                                     ///< Accumulation passes, each over every channel
+    u32                             Samples;                                    ///< Samples accumulated
+    AdcScan_Callback                Callback;
+    TIM_TypeDef*                    Trigger;                                    ///< Pacing timer, NULL if free-running
+    u32                             TickClock;                                  ///< Pacing timer counter clock, Hz
+    u32                             Period;                                     ///< Counter ticks per scan
+    u32                             LatencyMin;                                 ///< Counter ticks from trigger to service
+    u32                             LatencyMax;
+    u32                             Late;                                       ///< Both halves pending at once: a half was missed
+    u32                             Errors;                                     ///< DMA transfer errors
+} AdcScan_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SCAN_Exported_Functions
+/// @{
+
+void AdcScan_StructInit(AdcScan_InitTypeDef* init_struct);
+ErrorStatus AdcScan_Init(AdcScan_TypeDef* scan, const AdcScan_InitTypeDef* init_struct);
+void AdcScan_Start(AdcScan_TypeDef* scan);
+void AdcScan_Stop(AdcScan_TypeDef* scan);
+u16 AdcScan_GetValue(AdcScan_TypeDef* scan, u8 channel);
+void AdcScan_GetTiming(AdcScan_TypeDef* scan, AdcScan_TimingTypeDef* timing);
+void AdcScan_DMAIRQHandler(AdcScan_TypeDef* scan);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __ADC_SCAN_H
+////////////////////////////////////////////////////////////////////////////////
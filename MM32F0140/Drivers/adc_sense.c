@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_sense.c
+/// @brief    THIS FILE PROVIDES THE SUPPLY AND TEMPERATURE SENSING SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Vrefint and the temperature sensor are converted by the scan engine as
+/// two more channels of its sequence. Give the sequence a sample time of at
+/// least the sensor's minimum, since AdcScan applies one sample time to all
+/// channels. Every Interval result sets, AdcSense_Service derives from the
+/// Vrefint code:
+///   MilliVoltScale = (VrefintMv << 16) / vrefint     Q16 mV per code
+///   VddaMv         = MilliVoltScale * full scale
+///   Gain           = (VddaMv << 16) / NominalMv      Q16 ratiometric factor
+/// and the temperature from the sensor voltage and its calibration point.
+/// Those three divisions run once per update. Consumers then convert with
+/// a multiply and a shift instead of a 30-cycle software divide per
+/// reading: about 3 cycles for AdcSense_ToMilliVolts, and about 20 for
+/// AdcSense_Correct, whose product needs 64 bits with decimated codes.
+/// Both factors are in the scan's own resolution, decimated or not, and
+/// each is a single word, so interrupt-level readers never see a torn
+/// value.
+///
+/// The sensor defaults are typical placeholders. Load the values of the
+/// part from its datasheet, or run AdcSense_CalibrateTemperature once at a
+/// known temperature (one-point calibration) and store the result.
+///
+/// Typical use, from the main loop or the AdcScan callback:
+///   if (AdcSense_Service(&sense)) { ... sense.VddaMv, sense.TemperatureCenti ... }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_SENSE_C_
+
+// Files includes
+#include "adc_sense.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup ADC_SENSE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the full-scale code of the scan: 4095, shifted left by
+///         the extra bits of decimation.
+/// @param  scan: pointer to the scan state.
+/// @retval Full-scale code.
+////////////////////////////////////////////////////////////////////////////////
+static u32 AdcSense_FullScale(const AdcScan_TypeDef* scan)
+{
+    u32 oversample = 0;
+
+    while ((1U << oversample) < scan->Ratio) {
+        oversample++;
+    }
+    return 0x0FFFU << (oversample - scan->Shift);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: 1.2 V reference, 3.3 V nominal supply,
+///         an update every 16 result sets and typical sensor values.
+/// @param  init_struct: pointer to an AdcSense_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcSense_StructInit(AdcSense_InitTypeDef* init_struct)
+{
+    init_struct->Scan       = NULL;
+    init_struct->Interval   = 16;
+    init_struct->VrefintMv  = 1200;
+    init_struct->NominalMv  = 3300;
+    init_struct->TsCalMv    = 1430;
+    init_struct->TsCalCenti = 2500;
+    init_struct->TsSlopeUv  = -4300;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Enables the internal channels and starts with nominal factors
+///         until the first update.
+/// @param  sense: pointer to the service state.
+/// @param  init_struct: pointer to an AdcSense_InitTypeDef structure.
+/// @retval ERROR if the scan does not convert both internal channels.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus AdcSense_Init(AdcSense_TypeDef* sense, const AdcSense_InitTypeDef* init_struct)
+{
+    AdcScan_TypeDef* scan = init_struct->Scan;
+
+    if ((scan == NULL) || (scan->Rank[ADC_Channel_Vrefint] == 0xFF) || (scan->Rank[ADC_Channel_TempSensor] == 0xFF) ||
+        (init_struct->VrefintMv == 0) || (init_struct->NominalMv == 0) || (init_struct->TsSlopeUv == 0)) {
+        return ERROR;
+    }
+    sense->Scan             = scan;
+    sense->Interval         = init_struct->Interval;
+    sense->VrefintMv        = init_struct->VrefintMv;
+    sense->NominalMv        = init_struct->NominalMv;
+    sense->TsCalCenti       = init_struct->TsCalCenti;
+    sense->TsCalUv          = (u32)init_struct->TsCalMv * 1000;
+    sense->TsSlopeUv        = init_struct->TsSlopeUv;
+    sense->LastResults      = scan->Results - init_struct->Interval;
+    sense->MilliVoltScale   = ((u32)init_struct->NominalMv << 16) / AdcSense_FullScale(scan);
+    sense->Gain             = 1U << 16;
+    sense->VddaMv           = init_struct->NominalMv;
+    sense->TemperatureCenti = init_struct->TsCalCenti;
+    sense->TsUv             = sense->TsCalUv;
+    sense->Updates          = 0;
+
+    ADC_TempSensorVrefintCmd(ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Recomputes the correction factors and the temperature once
+///         Interval new result sets are available.
+/// @param  sense: pointer to the service state.
+/// @retval true if the values were updated.
+////////////////////////////////////////////////////////////////////////////////
+bool AdcSense_Service(AdcSense_TypeDef* sense)
+{
+    AdcScan_TypeDef* scan = sense->Scan;
+    u32 results = scan->Results;
+    u32 vref, ts, scale, vdda;
+
+    if (results - sense->LastResults < sense->Interval) {
+        return false;
+    }
+    vref = AdcScan_GetValue(scan, ADC_Channel_Vrefint);
+    ts   = AdcScan_GetValue(scan, ADC_Channel_TempSensor);
+    if ((vref == 0) || (vref == ADC_SCAN_NO_VALUE) || (ts == ADC_SCAN_NO_VALUE)) {
+        return false;
+    }
+    sense->LastResults = results;
+
+    scale = ((u32)sense->VrefintMv << 16) / vref;
+    vdda  = (scale * AdcSense_FullScale(scan) + 0x8000) >> 16;
+    sense->MilliVoltScale = scale;
+    sense->Gain           = (vdda << 16) / sense->NominalMv;
+    sense->VddaMv         = (u16)vdda;
+
+    sense->TsUv = (u32)(((u64)ts * scale * 1000) >> 16);
+    sense->TemperatureCenti = (s16)(sense->TsCalCenti + ((s32)sense->TsUv - (s32)sense->TsCalUv) * 100 / sense->TsSlopeUv);
+    sense->Updates++;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  One-point calibration: the last sensor voltage becomes the
+///         reading at the given temperature. Needs one update first.
+/// @param  sense: pointer to the service state.
+/// @param  centi: current temperature, 0.01 degC.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcSense_CalibrateTemperature(AdcSense_TypeDef* sense, s16 centi)
+{
+    sense->TsCalUv          = sense->TsUv;
+    sense->TsCalCenti       = centi;
+    sense->TemperatureCenti = centi;
+}
+
+/// @}
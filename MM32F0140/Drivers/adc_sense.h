@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_sense.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE SUPPLY AND
+///           TEMPERATURE SENSING SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __ADC_SENSE_H
+#define __ADC_SENSE_H
+
+// Files includes
+#include "drv_common.h"
+#include "adc_scan.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SENSE
+/// @brief Supply and temperature sensing service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SENSE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sensing service init structure definition
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    AdcScan_TypeDef*                Scan;                                       ///< Must convert Vrefint and the temperature sensor
+    u16                             Interval;                                   ///< Scan result sets between updates
+    u16                             VrefintMv;                                  ///< Internal reference voltage
+    u16                             NominalMv;                                  ///< VDDA that corrected codes refer to
+    u16                             TsCalMv;                                    ///< Sensor voltage at TsCalCenti
+    s16                             TsCalCenti;                                 ///< Calibration temperature, 0.01 degC
+    s16                             TsSlopeUv;                                  ///< uV per degC, negative if falling with temperature
+} AdcSense_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sensing service state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    AdcScan_TypeDef*                Scan;
+    u16                             Interval;
+    u16                             VrefintMv;
+    u16                             NominalMv;
+    s16                             TsCalCenti;
+    u32                             TsCalUv;
+    s16                             TsSlopeUv;
+    u32                             LastResults;                                ///< Scan->Results at the last update
+    volatile u32                    MilliVoltScale;                             ///< Q16 mV per code
+    volatile u32                    Gain;                                       ///< Q16 VDDA / NominalMv
+    volatile u16                    VddaMv;
+    volatile s16                    TemperatureCenti;                           ///< 0.01 degC
+    u32                             TsUv;                                       ///< Last sensor voltage
+    u32                             Updates;
+} AdcSense_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_SENSE_Exported_Functions
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Converts a code of the scan to millivolts at the measured VDDA.
+/// @param  sense: pointer to the service state.
+/// @param  raw: code in the resolution of the scan.
+/// @retval Millivolts.
+////////////////////////////////////////////////////////////////////////////////
+static inline u32 AdcSense_ToMilliVolts(const AdcSense_TypeDef* sense, u32 raw)
+{
+    return (raw * sense->MilliVoltScale) >> 16;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Rescales a code to what it would read with VDDA at NominalMv.
+///         The product is taken in 64 bits: a decimated code reaches 65520
+///         and Gain exceeds 1.0 whenever VDDA is above NominalMv.
+/// @param  sense: pointer to the service state.
+/// @param  raw: code in the resolution of the scan.
+/// @retval Corrected code.
+////////////////////////////////////////////////////////////////////////////////
+static inline u32 AdcSense_Correct(const AdcSense_TypeDef* sense, u32 raw)
+{
+    return (u32)(((u64)raw * sense->Gain) >> 16);
+}
+
+void AdcSense_StructInit(AdcSense_InitTypeDef* init_struct);
+ErrorStatus AdcSense_Init(AdcSense_TypeDef* sense, const AdcSense_InitTypeDef* init_struct);
+bool AdcSense_Service(AdcSense_TypeDef* sense);
+void AdcSense_CalibrateTemperature(AdcSense_TypeDef* sense, s16 centi);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __ADC_SENSE_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_watch.c
+/// @brief    THIS FILE PROVIDES THE ADC WINDOW MONITOR FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The analog watchdog compares every conversion of one channel (CMPCH)
+/// against one window (CMPR) and sets ADWIF when the result falls outside
+/// it. The monitor programs the window so that only a change of state
+/// leaves it:
+///   Normal:  [Low, High]                      leaves on over or under
+///   Over:    [High - Hysteresis, 0xFFF]       leaves when back inside
+///   Under:   [0, Low + Hysteresis]            leaves when back inside
+/// After each crossing the window is reprogrammed for the new state, so a
+/// value that stays out of range raises no further interrupts. The
+/// interrupt reads the channel's own data register and classifies that
+/// value. A flag raised while the window was being changed therefore
+/// cannot report a wrong state; it is only counted (Spurious).
+///
+/// The ADC itself is left to its owner (AdcScan, or a timer-paced scan).
+/// The guarded channel reacts within one conversion plus about 40 cycles
+/// of interrupt, i.e. 1 to 3 us. Several windows share the one watchdog by
+/// time multiplexing: AdcWatch_Rotate moves it to the next window and is
+/// meant to be called from a periodic context, e.g. the AdcScan callback.
+/// A crossing on a window that is not guarded at that moment is caught as
+/// soon as its slot comes round, because its value is then already
+/// outside the programmed window. With N windows rotated every T, the
+/// worst reaction is (N - 1) * T plus one conversion. Put the channel that
+/// needs microseconds alone, or list it in several slots.
+///
+/// The vector is shared with the comparators and the injected ADC path,
+/// so the application calls every handler in use:
+///   void ADC_COMP_IRQHandler(void) { AdcWatch_IRQHandler(&adc_watch); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_WATCH_C_
+
+// Files includes
+#include "adc_watch.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup ADC_WATCH
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Points the watchdog at the current slot's channel, with the
+///         window that matches the slot's state.
+/// @param  watch: pointer to the monitor state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void AdcWatch_Program(AdcWatch_TypeDef* watch)
+{
+    const AdcWatch_WindowTypeDef* w = &watch->Windows[watch->Slot];
+
+    switch (watch->State[watch->Slot]) {
+        case AdcWatch_Over:
+            ADC_AnalogWatchdogThresholdsConfig(ADC1, 0x0FFF, (u16)(w->High - w->Hysteresis));
+            break;
+        case AdcWatch_Under:
+            ADC_AnalogWatchdogThresholdsConfig(ADC1, (u16)(w->Low + w->Hysteresis), 0);
+            break;
+        default:
+            ADC_AnalogWatchdogThresholdsConfig(ADC1, w->High, w->Low);
+            break;
+    }
+    ADC_AnalogWatchdogSingleChannelConfig(ADC1, (ADCCHANNEL_TypeDef)w->Channel);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Applies the window and its hysteresis to a value.
+/// @param  w: window.
+/// @param  state: current state of the window.
+/// @param  value: 12-bit conversion result.
+/// @retval New state.
+////////////////////////////////////////////////////////////////////////////////
+static AdcWatch_StateTypeDef AdcWatch_Classify(const AdcWatch_WindowTypeDef* w, u8 state, u16 value)
+{
+    if ((value > w->High) || ((state == AdcWatch_Over) && (value >= w->High - w->Hysteresis))) {
+        return AdcWatch_Over;
+    }
+    if ((value < w->Low) || ((state == AdcWatch_Under) && (value <= w->Low + w->Hysteresis))) {
+        return AdcWatch_Under;
+    }
+    return AdcWatch_Normal;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts monitoring. The ADC must already be enabled and
+///         converting the channels.
+/// @param  watch: pointer to the monitor state.
+/// @param  windows: array of count windows, must stay valid.
+/// @param  count: 1 to ADC_WATCH_MAX_WINDOWS.
+/// @param  callback: crossing hook, may be NULL.
+/// @retval ERROR on an invalid window list or a disabled ADC.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus AdcWatch_Init(AdcWatch_TypeDef* watch, const AdcWatch_WindowTypeDef* windows, u8 count, AdcWatch_Callback callback)
+{
+    u8 i;
+
+    if ((count == 0) || (count > ADC_WATCH_MAX_WINDOWS) || !(ADC1->ADCFG & ADC_CFGR_ADEN)) {
+        return ERROR;
+    }
+    for (i = 0; i < count; i++) {
+        if ((windows[i].Channel > 15) || (windows[i].Low >= windows[i].High) || (windows[i].High > 0x0FFF) ||
+            (windows[i].Hysteresis > windows[i].High) || (windows[i].Low + windows[i].Hysteresis > 0x0FFF)) {
+            return ERROR;
+        }
+        watch->State[i] = AdcWatch_Normal;
+    }
+    watch->Windows   = windows;
+    watch->Count     = count;
+    watch->Slot      = 0;
+    watch->Callback  = callback;
+    watch->Crossings = 0;
+    watch->Spurious  = 0;
+    watch->Rotations = 0;
+
+    AdcWatch_Program(watch);
+    ADC_ClearFlag(ADC1, ADC_FLAG_AWD);
+    ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
+    ADC_AnalogWatchdogCmd(ADC1, ENABLE);
+    DRV_NVICEnable(ADC_COMP_IRQn, 0);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stops monitoring. The ADC keeps converting.
+/// @param  watch: pointer to the monitor state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcWatch_Stop(AdcWatch_TypeDef* watch)
+{
+    (void)watch;
+    ADC_AnalogWatchdogCmd(ADC1, DISABLE);
+    ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+    ADC_ClearFlag(ADC1, ADC_FLAG_AWD);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Moves the watchdog to the next window. A crossing pending on the
+///         current window is serviced first.
+/// @param  watch: pointer to the monitor state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcWatch_Rotate(AdcWatch_TypeDef* watch)
+{
+    if (watch->Count < 2) {
+        return;
+    }
+    DRV_ENTER_CRITICAL();
+    AdcWatch_IRQHandler(watch);
+    watch->Slot = (u8)((watch->Slot + 1 < watch->Count) ? watch->Slot + 1 : 0);
+    AdcWatch_Program(watch);
+    watch->Rotations++;
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the state of a window.
+/// @param  watch: pointer to the monitor state.
+/// @param  index: window index.
+/// @retval Window state.
+////////////////////////////////////////////////////////////////////////////////
+AdcWatch_StateTypeDef AdcWatch_GetState(AdcWatch_TypeDef* watch, u8 index)
+{
+    return (index < watch->Count) ? (AdcWatch_StateTypeDef)watch->State[index] : AdcWatch_Normal;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Analog watchdog service.
+/// @param  watch: pointer to the monitor state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void AdcWatch_IRQHandler(AdcWatch_TypeDef* watch)
+{
+    const AdcWatch_WindowTypeDef* w;
+    AdcWatch_StateTypeDef state;
+    u8 slot = watch->Slot;
+    u16 value;
+
+    if (!(ADC1->ADSTA & ADC_SR_ADWIF)) {
+        return;
+    }
+    ADC1->ADSTA = ADC_SR_ADWIF;
+
+    w     = &watch->Windows[slot];
+    value = (u16)((&ADC1->ADDR0)[w->Channel] & 0x0FFF);
+    state = AdcWatch_Classify(w, watch->State[slot], value);
+    if (state == watch->State[slot]) {
+        watch->Spurious++;
+        return;
+    }
+    watch->State[slot] = state;
+    AdcWatch_Program(watch);
+    watch->Crossings++;
+    if (watch->Callback != NULL) {
+        watch->Callback(watch, slot, state, value);
+    }
+}
+
+/// @}
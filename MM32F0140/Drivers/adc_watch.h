@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_watch.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE ADC
+///           WINDOW MONITOR.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __ADC_WATCH_H
+#define __ADC_WATCH_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_WATCH
+/// @brief ADC window monitor
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_WATCH_Exported_Constants
+/// @{
+
+#define ADC_WATCH_MAX_WINDOWS       (8U)                                        ///< Windows sharing the analog watchdog
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_WATCH_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Window state
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    AdcWatch_Normal,                                                            ///< Between Low and High
+    AdcWatch_Over,                                                              ///< Above High, until below High - Hysteresis
+    AdcWatch_Under                                                              ///< Below Low, until above Low + Hysteresis
+} AdcWatch_StateTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Window on one channel, 12-bit right-aligned codes
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8                              Channel;                                    ///< ADCCHANNEL_TypeDef value
+    u16                             Low;
+    u16                             High;
+    u16                             Hysteresis;                                 ///< Codes to move back inside before Normal
+} AdcWatch_WindowTypeDef;
+
+struct _AdcWatch;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Crossing hook, runs in ADC_COMP_IRQHandler on each state change.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*AdcWatch_Callback)(struct _AdcWatch* watch, u8 index, AdcWatch_StateTypeDef state, u16 value);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Window monitor state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _AdcWatch {
+    const AdcWatch_WindowTypeDef*   Windows;
+    u8                              Count;
+    u8                              Slot;                                       ///< Window the watchdog guards now
+    volatile u8                     State[ADC_WATCH_MAX_WINDOWS];               ///< AdcWatch_StateTypeDef per window
+    AdcWatch_Callback               Callback;
+    u32                             Crossings;                                  ///< State changes reported
+    u32                             Spurious;                                   ///< Flags without a state change
+    u32                             Rotations;
+} AdcWatch_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ADC_WATCH_Exported_Functions
+/// @{
+
+ErrorStatus AdcWatch_Init(AdcWatch_TypeDef* watch, const AdcWatch_WindowTypeDef* windows, u8 count, AdcWatch_Callback callback);
+void AdcWatch_Stop(AdcWatch_TypeDef* watch);
+void AdcWatch_Rotate(AdcWatch_TypeDef* watch);
+AdcWatch_StateTypeDef AdcWatch_GetState(AdcWatch_TypeDef* watch, u8 index);
+void AdcWatch_IRQHandler(AdcWatch_TypeDef* watch);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __ADC_WATCH_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,457 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     bldc.c
+/// @brief    THIS FILE PROVIDES THE BLDC SIX-STEP COMMUTATION SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Commutation is done entirely by the hardware:
+///   - The Hall timer (TIM2 or TIM3) XORs H1..H3 onto TI1 (TI1S). Every Hall
+///     edge resets its counter and prescaler through the TI1F_ED slave
+///     reset, and CCR1 captures the time since the previous edge.
+///   - Its TRGO is that reset, or OC2REF in PWM2 mode, rising CCR2 ticks
+///     after the edge when a commutation delay is set.
+///   - TRGO reaches TIM1 as TRGI (ITR1 for TIM2, ITR2 for TIM3). With CCPC
+///     and CCUS set, the rising edge is a COM event: the preloaded output
+///     modes (OCxM) and enables (CCxE, CCxNE) of CH1..CH3 all switch at
+///     once.
+/// The chain from the Hall pin to the bridge is a fixed few timer clocks,
+/// under 100 ns at 72 MHz after the input filter. The jitter is one clock
+/// of input sampling. The delay adds no quantisation jitter either, since
+/// the prescaler restarts at the edge.
+///
+/// The CPU only prepares the next step. The COM interrupt stores the
+/// interval, checks the Hall state against the step just applied and
+/// preloads the pattern of the following step. It takes about 300 cycles
+/// and has a whole step to complete, so its latency never reaches the
+/// outputs. A Hall state other than the predicted one is applied at once
+/// by a software COM and counted in Resyncs. An impossible code stops the
+/// bridge. The Hall timer's CC3 compare flags a standstill after StallMs.
+/// A 16-bit Hall timer also wraps 65536 ticks after the last edge. With a
+/// delay set, the wrap raises OC2REF once more, and the COM interrupt
+/// resyncs the stray step.
+///
+/// Each step drives one phase with PWM and holds one low. The step is
+/// defined by the Hall code through HallMap. The default map follows the
+/// 1-3-2-6-4-5 sequence and must be matched to the motor. Reverse drives
+/// the step opposite the Hall position. Speed is averaged over the last
+/// six intervals, which cancels the placement error of the sensors.
+///
+/// The application forwards the vectors:
+///   void TIM1_BRK_UP_TRG_COM_IRQHandler(void) { Bldc_IRQHandler(&motor); }
+///   void TIM3_IRQHandler(void)                { Bldc_HallIRQHandler(&motor); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _BLDC_C_
+
+// Files includes
+#include "bldc.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup BLDC
+/// @{
+
+static const u8 bldc_hall_map[8] = {BLDC_HALL_INVALID, 0, 2, 1, 4, 5, 3, BLDC_HALL_INVALID};
+
+static const u8 bldc_high[BLDC_STEPS] = {0, 0, 1, 1, 2, 2};                    ///< PWM phase of each step
+static const u8 bldc_low[BLDC_STEPS]  = {1, 2, 2, 0, 0, 1};                    ///< Low phase of each step
+
+static const TIMCHx_Typedef bldc_channel[3] = {TIM_Channel_1, TIM_Channel_2, TIM_Channel_3};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reads the Hall sensors.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval Step of the Hall code, or BLDC_HALL_INVALID.
+////////////////////////////////////////////////////////////////////////////////
+static u8 Bldc_ReadHall(Bldc_TypeDef* bldc)
+{
+    u8 code = 0;
+    u8 i;
+
+    for (i = 0; i < 3; i++) {
+        if (bldc->HallPort[i]->IDR & bldc->HallPin[i]) {
+            code |= 1 << i;
+        }
+    }
+    return bldc->HallMap[code];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Forgets the Hall intervals: the speed reads 0 until two more
+///         edges have been seen.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bldc_ResetSpeed(Bldc_TypeDef* bldc)
+{
+    u8 i;
+
+    for (i = 0; i < BLDC_STEPS; i++) {
+        bldc->Interval[i] = 0;
+    }
+    bldc->Sum     = 0;
+    bldc->Index   = 0;
+    bldc->Valid   = 0;
+    bldc->Stalled = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Writes the output pattern of a Hall step into the COM preload:
+///         PWM on the high phase, low side on for the low phase, the third
+///         phase off. Nothing changes until the next COM event.
+/// @param  bldc: pointer to the BLDC state.
+/// @param  step: Hall step, 0 to BLDC_STEPS - 1, or BLDC_STEPS for all off.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bldc_Preload(Bldc_TypeDef* bldc, u8 step)
+{
+    u8 drive = (bldc->Direction > 0) ? step : (u8)((step + 3) % BLDC_STEPS);
+    u8 p;
+
+    for (p = 0; p < 3; p++) {
+        if ((step < BLDC_STEPS) && (p == bldc_high[drive])) {
+            TIM_SelectOCxM(TIM1, bldc_channel[p], TIM_OCMode_PWM1);
+            TIM_CCxCmd(TIM1, bldc_channel[p], TIM_CCx_Enable);
+            TIM_CCxNCmd(TIM1, bldc_channel[p], bldc->Synchronous ? TIM_CCxN_Enable : TIM_CCxN_Disable);
+        }
+        else if ((step < BLDC_STEPS) && (p == bldc_low[drive])) {
+            TIM_SelectOCxM(TIM1, bldc_channel[p], TIM_ForcedAction_InActive);
+            TIM_CCxCmd(TIM1, bldc_channel[p], TIM_CCx_Enable);
+            TIM_CCxNCmd(TIM1, bldc_channel[p], TIM_CCxN_Enable);
+        }
+        else {
+            TIM_SelectOCxM(TIM1, bldc_channel[p], TIM_ForcedAction_InActive);
+            TIM_CCxCmd(TIM1, bldc_channel[p], TIM_CCx_Disable);
+            TIM_CCxNCmd(TIM1, bldc_channel[p], TIM_CCxN_Disable);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: TIM3 Hall interface at 1 MHz,
+///         commutation at the edge, 100 ms standstill, 20 kHz PWM with
+///         500 ns dead time, synchronous, break input enabled active low.
+/// @param  init_struct: pointer to a Bldc_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Bldc_StructInit(Bldc_InitTypeDef* init_struct)
+{
+    u8 i;
+
+    init_struct->Hall = TIM3;
+    for (i = 0; i < 3; i++) {
+        init_struct->HallPort[i] = NULL;
+        init_struct->HallPin[i]  = 0;
+    }
+    init_struct->HallMap       = NULL;
+    init_struct->HallFilter    = 0;
+    init_struct->TickHz        = 1000000;
+    init_struct->DelayQ8       = 0;
+    init_struct->StallMs       = 100;
+    init_struct->PolePairs     = 1;
+    init_struct->PwmHz         = 20000;
+    init_struct->DeadTimeNs    = 500;
+    init_struct->Synchronous   = true;
+    init_struct->Break         = true;
+    init_struct->BreakPolarity = TIM_BreakPolarity_Low;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets up the Hall timer and TIM1 and starts both with the bridge
+///         off.
+/// @param  bldc: pointer to the BLDC state.
+/// @param  init_struct: pointer to a Bldc_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Bldc_Init(Bldc_TypeDef* bldc, const Bldc_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_ICInitTypeDef ic_init;
+    TIM_OCInitTypeDef oc_init;
+    TIM_BDTRInitTypeDef bdtr_init;
+    TIM_TypeDef* hall = init_struct->Hall;
+    u32 hall_clock, pwm_clock, prescaler, period, stall;
+    u8 dead, i;
+
+    if (((hall != TIM2) && (hall != TIM3)) || (init_struct->TickHz == 0) || (init_struct->PwmHz == 0)) {
+        return ERROR;
+    }
+    for (i = 0; i < 3; i++) {
+        if (init_struct->HallPort[i] == NULL) {
+            return ERROR;
+        }
+    }
+    hall_clock = DRV_TimerClock(hall);
+    pwm_clock  = DRV_TimerClock(TIM1);
+    prescaler  = hall_clock / init_struct->TickHz;
+    period     = (pwm_clock != 0) ? pwm_clock / init_struct->PwmHz : 0;
+    if ((prescaler == 0) || (prescaler > 0x10000) || (period < 16) || (period > 0x10000) ||
+        (DRV_TimerDeadTime(TIM1, init_struct->DeadTimeNs, &dead) != SUCCESS)) {
+        return ERROR;
+    }
+
+    bldc->Hall = hall;
+    for (i = 0; i < 3; i++) {
+        bldc->HallPort[i] = init_struct->HallPort[i];
+        bldc->HallPin[i]  = init_struct->HallPin[i];
+    }
+    bldc->HallMap      = (init_struct->HallMap != NULL) ? init_struct->HallMap : bldc_hall_map;
+    bldc->TickHz       = hall_clock / prescaler;
+    bldc->DelayQ8      = init_struct->DelayQ8;
+    bldc->PolePairs    = init_struct->PolePairs;
+    bldc->Synchronous  = init_struct->Synchronous;
+    bldc->Period       = (u16)(period - 1);
+    bldc->Running      = false;
+    bldc->Direction    = 1;
+    bldc->Next         = BLDC_STEPS;
+    bldc->Commutations = 0;
+    bldc->Resyncs      = 0;
+    bldc->Faults       = 0;
+    Bldc_ResetSpeed(bldc);
+
+    // Hall interface: XOR of the three inputs on TI1, reset on each edge.
+    DRV_TimerClockCmd(hall, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = prescaler - 1;
+    tim_init.TIM_Period    = (hall == TIM2) ? 0xFFFFFFFF : 0xFFFF;
+    TIM_TimeBaseInit(hall, &tim_init);
+    TIM_SelectHallSensor(hall, ENABLE);
+    TIM_ICStructInit(&ic_init);
+    ic_init.TIM_Channel     = TIM_Channel_1;
+    ic_init.TIM_ICPolarity  = TIM_ICPolarity_Rising;
+    ic_init.TIM_ICSelection = TIM_ICSelection_TRC;
+    ic_init.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    ic_init.TIM_ICFilter    = init_struct->HallFilter;
+    TIM_ICInit(hall, &ic_init);
+    TIM_SelectInputTrigger(hall, TIM_TS_TI1F_ED);
+    TIM_SelectSlaveMode(hall, TIM_SlaveMode_Reset);
+    TIM_UpdateRequestConfig(hall, TIM_UpdateSource_Regular);
+
+    // CH2 delays the commutation, CH3 times the standstill; neither has a pin.
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OCMode = TIM_OCMode_PWM2;
+    oc_init.TIM_Pulse  = 1;
+    TIM_OC2Init(hall, &oc_init);
+    TIM_OC2PreloadConfig(hall, TIM_OCPreload_Enable);
+    stall = (u32)((u64)bldc->TickHz * init_struct->StallMs / 1000);
+    stall = (stall < tim_init.TIM_Period) ? stall : tim_init.TIM_Period;
+    oc_init.TIM_OCMode = TIM_OCMode_Timing;
+    oc_init.TIM_Pulse  = (stall != 0) ? stall : 1;
+    TIM_OC3Init(hall, &oc_init);
+    TIM_SelectOutputTrigger(hall, (bldc->DelayQ8 != 0) ? TIM_TRIGSource_OC2Ref : TIM_TRIGSource_Reset);
+    TIM_ClearITPendingBit(hall, TIM_IT_CC3);
+    TIM_ITConfig(hall, TIM_IT_CC3, ENABLE);
+    DRV_NVICEnable(DRV_TimerIRQn(hall), 1);
+    TIM_Cmd(hall, ENABLE);
+
+    // Bridge: edge-aligned PWM, patterns switched by COM events on TRGI.
+    DRV_TimerClockCmd(TIM1, ENABLE);
+    TIM_CtrlPWMOutputs(TIM1, DISABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = bldc->Period;
+    TIM_TimeBaseInit(TIM1, &tim_init);
+    TIM_ARRPreloadConfig(TIM1, ENABLE);
+
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OCMode       = TIM_ForcedAction_InActive;
+    oc_init.TIM_Pulse        = 0;
+    oc_init.TIM_OCPolarity   = TIM_OCPolarity_High;
+    oc_init.TIM_OCNPolarity  = TIM_OCNPolarity_High;
+    oc_init.TIM_OCIdleState  = TIM_OCIdleState_Reset;
+    oc_init.TIM_OCNIdleState = TIM_OCNIdleState_Reset;
+    TIM_OC1Init(TIM1, &oc_init);
+    TIM_OC2Init(TIM1, &oc_init);
+    TIM_OC3Init(TIM1, &oc_init);
+    TIM_OC1PreloadConfig(TIM1, TIM_OCPreload_Enable);
+    TIM_OC2PreloadConfig(TIM1, TIM_OCPreload_Enable);
+    TIM_OC3PreloadConfig(TIM1, TIM_OCPreload_Enable);
+
+    TIM_BDTRStructInit(&bdtr_init);
+    bdtr_init.TIM_OSSRState       = TIM_OSSRState_Enable;
+    bdtr_init.TIM_OSSIState       = TIM_OSSIState_Enable;
+    bdtr_init.TIM_LOCKLevel       = TIM_LOCKLevel_OFF;
+    bdtr_init.TIM_DeadTime        = dead;
+    bdtr_init.TIM_Break           = init_struct->Break ? TIM_Break_Enable : TIM_Break_Disable;
+    bdtr_init.TIM_BreakPolarity   = init_struct->BreakPolarity;
+    bdtr_init.TIM_AutomaticOutput = TIM_AutomaticOutput_Disable;
+    TIM_BDTRConfig(TIM1, &bdtr_init);
+
+    TIM_CCPreloadControl(TIM1, ENABLE);
+    TIM_SelectCOM(TIM1, ENABLE);
+    TIM_SelectInputTrigger(TIM1, (hall == TIM2) ? TIM_TS_ITR1 : TIM_TS_ITR2);
+    TIM_GenerateEvent(TIM1, TIM_EventSource_Update);
+    TIM_ClearITPendingBit(TIM1, TIM_IT_COM);
+    TIM_ITConfig(TIM1, TIM_IT_COM, ENABLE);
+    DRV_NVICEnable(TIM1_BRK_UP_TRG_COM_IRQn, 1);
+    TIM_Cmd(TIM1, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Applies the pattern of the current Hall step, preloads the next
+///         one and switches the bridge on.
+/// @param  bldc: pointer to the BLDC state.
+/// @param  direction: 1 forward, -1 reverse.
+/// @retval ERROR on an impossible Hall code or an active break input.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Bldc_Start(Bldc_TypeDef* bldc, s8 direction)
+{
+    u8 step = Bldc_ReadHall(bldc);
+
+    if (((direction != 1) && (direction != -1)) || (step >= BLDC_STEPS)) {
+        return ERROR;
+    }
+    {
+        DRV_ENTER_CRITICAL();
+        bldc->Direction = direction;
+        Bldc_ResetSpeed(bldc);
+        Bldc_Preload(bldc, step);
+        TIM_GenerateEvent(TIM1, TIM_EventSource_COM);
+        TIM_ClearITPendingBit(TIM1, TIM_IT_COM);
+        bldc->Next = (u8)((step + BLDC_STEPS + direction) % BLDC_STEPS);
+        Bldc_Preload(bldc, bldc->Next);
+        bldc->Running = true;
+        DRV_EXIT_CRITICAL();
+    }
+    TIM_ClearFlag(TIM1, TIM_FLAG_Break);
+    TIM_CtrlPWMOutputs(TIM1, ENABLE);
+    if (!(TIM1->BDTR & TIM_BDTR_MOEN)) {
+        bldc->Running = false;
+        return ERROR;
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the bridge off and clears the pattern.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Bldc_Stop(Bldc_TypeDef* bldc)
+{
+    bldc->Running = false;
+    TIM_CtrlPWMOutputs(TIM1, DISABLE);
+    Bldc_Preload(bldc, BLDC_STEPS);
+    TIM_GenerateEvent(TIM1, TIM_EventSource_COM);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets the PWM duty of the driven phase.
+/// @param  bldc: pointer to the BLDC state.
+/// @param  duty: 0 to BLDC_DUTY_FULL.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Bldc_SetDuty(Bldc_TypeDef* bldc, u16 duty)
+{
+    u32 compare;
+
+    duty    = (duty < BLDC_DUTY_FULL) ? duty : BLDC_DUTY_FULL;
+    compare = (u32)duty * (bldc->Period + 1) / BLDC_DUTY_FULL;
+    TIM_SetCompare1(TIM1, compare);
+    TIM_SetCompare2(TIM1, compare);
+    TIM_SetCompare3(TIM1, compare);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the shaft speed from the latest Hall intervals.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval Mechanical speed in rpm, 0 at standstill.
+////////////////////////////////////////////////////////////////////////////////
+u32 Bldc_GetRpm(Bldc_TypeDef* bldc)
+{
+    u32 sum;
+    u8 valid;
+
+    {
+        DRV_ENTER_CRITICAL();
+        sum   = bldc->Sum;
+        valid = bldc->Valid;
+        DRV_EXIT_CRITICAL();
+    }
+    if ((valid == 0) || (sum == 0) || (bldc->PolePairs == 0)) {
+        return 0;
+    }
+    // Six intervals per electrical turn: rpm = 60 * f / (6 * mean * pairs).
+    return (u32)((u64)bldc->TickHz * 10 * valid / ((u64)sum * bldc->PolePairs));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  COM interrupt service: records the Hall interval, checks the
+///         step just applied and preloads the next one.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Bldc_IRQHandler(Bldc_TypeDef* bldc)
+{
+    u32 interval;
+    u8 step;
+
+    if (!TIM_GetITStatus(TIM1, TIM_IT_COM)) {
+        return;
+    }
+    TIM_ClearITPendingBit(TIM1, TIM_IT_COM);
+    if (!bldc->Running) {
+        return;
+    }
+    if (!(TIM1->BDTR & TIM_BDTR_MOEN)) {
+        // The break input has switched the bridge off.
+        bldc->Faults++;
+        Bldc_Stop(bldc);
+        return;
+    }
+
+    // CCR1 holds the capture of the edge behind this event.
+    interval = bldc->Hall->CCR1;
+    if (bldc->Stalled) {
+        bldc->Stalled = false;
+    }
+    else {
+        bldc->Sum                  += interval - bldc->Interval[bldc->Index];
+        bldc->Interval[bldc->Index] = interval;
+        bldc->Index                 = (bldc->Index < BLDC_STEPS - 1) ? bldc->Index + 1 : 0;
+        if (bldc->Valid < BLDC_STEPS) {
+            bldc->Valid++;
+        }
+        if (bldc->DelayQ8 != 0) {
+            // Takes effect at the next edge (CCR2 preload).
+            bldc->Hall->CCR2 = (u32)(((u64)interval * bldc->DelayQ8) >> 8) + 1;
+        }
+    }
+
+    step = Bldc_ReadHall(bldc);
+    if (step >= BLDC_STEPS) {
+        bldc->Faults++;
+        Bldc_Stop(bldc);
+        return;
+    }
+    if (step != bldc->Next) {
+        // A missed or bouncing edge: apply the right pattern now.
+        bldc->Resyncs++;
+        Bldc_Preload(bldc, step);
+        TIM_GenerateEvent(TIM1, TIM_EventSource_COM);
+        TIM_ClearITPendingBit(TIM1, TIM_IT_COM);
+    }
+    bldc->Next = (u8)((step + BLDC_STEPS + bldc->Direction) % BLDC_STEPS);
+    Bldc_Preload(bldc, bldc->Next);
+    bldc->Commutations++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Hall timer interrupt service: no edge for StallMs.
+/// @param  bldc: pointer to the BLDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Bldc_HallIRQHandler(Bldc_TypeDef* bldc)
+{
+    if (!TIM_GetITStatus(bldc->Hall, TIM_IT_CC3)) {
+        return;
+    }
+    TIM_ClearITPendingBit(bldc->Hall, TIM_IT_CC3);
+    Bldc_ResetSpeed(bldc);
+    if (bldc->DelayQ8 != 0) {
+        bldc->Hall->CCR2 = 1;
+    }
+}
+
+/// @}
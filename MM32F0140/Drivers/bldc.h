@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     bldc.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE BLDC
+///           SIX-STEP COMMUTATION SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __BLDC_H
+#define __BLDC_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup BLDC
+/// @brief BLDC six-step commutation service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup BLDC_Exported_Constants
+/// @{
+
+#define BLDC_STEPS                  (6U)                                        ///< Commutation steps per electrical turn
+#define BLDC_HALL_INVALID           (0xFFU)                                     ///< HallMap entry of an impossible code
+#define BLDC_DUTY_FULL              (10000U)                                    ///< Duty in 0.01 % steps
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup BLDC_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  BLDC init structure definition. The TIM1 CH1..CH3/CH1N..CH3N
+///         outputs, the break pin and the Hall inputs (CH1..CH3 of the Hall
+///         timer) are left to the caller. The Hall pins are also read
+///         through HallPort/HallPin to check every step.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Hall;                                       ///< Hall interface: TIM2 or TIM3
+    GPIO_TypeDef*                   HallPort[3];                                ///< H1, H2, H3
+    u16                             HallPin[3];                                 ///< Pin masks
+    const u8*                       HallMap;                                    ///< Hall code (H3 H2 H1) to step, NULL for the default
+    u8                              HallFilter;                                 ///< Input filter, 0..15
+    u32                             TickHz;                                     ///< Hall timer clock
+    u8                              DelayQ8;                                    ///< Commutation delay, 1/256 of the last step, 0 at the edge
+    u16                             StallMs;                                    ///< No Hall edge for this long reads as standstill
+    u8                              PolePairs;
+    u32                             PwmHz;
+    u16                             DeadTimeNs;                                 ///< Up to 1008 timer clocks
+    bool                            Synchronous;                                ///< Switch the low side of the PWM phase too
+    bool                            Break;                                      ///< Enable the break input
+    TIMBKP_Typedef                  BreakPolarity;
+} Bldc_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  BLDC state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Hall;
+    GPIO_TypeDef*                   HallPort[3];
+    u16                             HallPin[3];
+    const u8*                       HallMap;
+    u32                             TickHz;
+    u8                              DelayQ8;
+    u8                              PolePairs;
+    bool                            Synchronous;
+    u16                             Period;                                     ///< TIM1 ARR
+    volatile bool                   Running;
+    s8                              Direction;                                  ///< 1 forward, -1 reverse
+    u8                              Next;                                       ///< Hall step of the preloaded pattern
+    u32                             Interval[BLDC_STEPS];                       ///< Latest Hall intervals, ticks
+    u32                             Sum;
+    u8                              Index;
+    u8                              Valid;                                      ///< Intervals held, 0 when stalled
+    bool                            Stalled;                                    ///< The next capture spans a standstill
+    u32                             Commutations;
+    u32                             Resyncs;                                    ///< Hall steps other than the predicted one
+    u32                             Faults;                                     ///< Break events and impossible Hall codes
+} Bldc_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup BLDC_Exported_Functions
+/// @{
+
+void Bldc_StructInit(Bldc_InitTypeDef* init_struct);
+ErrorStatus Bldc_Init(Bldc_TypeDef* bldc, const Bldc_InitTypeDef* init_struct);
+ErrorStatus Bldc_Start(Bldc_TypeDef* bldc, s8 direction);
+void Bldc_Stop(Bldc_TypeDef* bldc);
+void Bldc_SetDuty(Bldc_TypeDef* bldc, u16 duty);
+u32 Bldc_GetRpm(Bldc_TypeDef* bldc);
+void Bldc_IRQHandler(Bldc_TypeDef* bldc);
+void Bldc_HallIRQHandler(Bldc_TypeDef* bldc);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __BLDC_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     comp_event.c
+/// @brief    THIS FILE PROVIDES THE COMPARATOR EVENT ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Capture mode: COMP1's output is routed inside the chip to a timer input
+/// capture, TIM2 IC4 or TIM3 IC1, on both edges. The timer latches its
+/// counter at the edge itself. The timestamp resolution is one timer clock
+/// (14 ns at 72 MHz) whatever the interrupt latency, plus the comparator
+/// filter delay, which is constant. The timer runs free with a 16-bit
+/// reload, and its update interrupt (about every 0.9 ms) extends the count
+/// to 32 bits. A capture that coincides with a pending update is assigned
+/// by the usual half-period test. The comparator watches one input at a
+/// time. For sensorless zero-cross detection, only the floating phase
+/// matters: CompEvent_Select switches the input at commutation, or
+/// AutoAdvance moves to the next input after every edge. Edges within
+/// Blanking ticks of a switch are the mux's own transient (or
+/// demagnetisation) and are dropped.
+///
+/// Poll mode: the comparator's polling logic cycles the non-inverting
+/// inputs in hardware against a fixed inverting input and latches each
+/// result in POUT. The timer update interrupt samples POUT every
+/// PollPeriod ticks and queues one event per changed bit. This watches 2
+/// or 3 inputs at once, at the cost of timestamps quantised to PollPeriod.
+/// POUT has no change interrupt of its own, and the comparator output
+/// (EXTI, ADC_COMP_IRQHandler) toggles as the polling steps between
+/// inputs, so sampling is the only way to read it. Each sample is an
+/// interrupt of about 70 cycles with the flash wait states, plus about 25
+/// per queued event. The default PollPeriod, 20 us at 72 MHz, costs
+/// 3.5 Mcycles/s, 4.9 % of the core; Init rejects a period that would
+/// interrupt faster than COMP_EVENT_POLL_MAX_HZ.
+///
+/// The application forwards the timer vector:
+///   void TIM2_IRQHandler(void) { CompEvent_IRQHandler(&zero_cross); }
+/// and drains events in thread context with CompEvent_Read (single
+/// producer, single consumer, no locking).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _COMP_EVENT_C_
+
+// Files includes
+#include "comp_event.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup COMP_EVENT
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Appends an event, or counts it as dropped if the queue is full.
+/// @param  engine: pointer to the engine state.
+/// @param  time: timestamp in timer ticks.
+/// @param  input: input index.
+/// @param  level: comparator output after the edge.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void CompEvent_Push(CompEvent_TypeDef* engine, u32 time, u8 input, u8 level)
+{
+    u8 head = engine->Head;
+    u8 next = (u8)((head + 1) & (COMP_EVENT_QUEUE_SIZE - 1));
+
+    if (next == engine->Tail) {
+        engine->Dropped++;
+        return;
+    }
+    engine->Queue[head].Time  = time;
+    engine->Queue[head].Input = input;
+    engine->Queue[head].Level = level;
+    engine->Head = next;
+    engine->Events++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the comparator to an input and starts its blanking.
+/// @param  engine: pointer to the engine state.
+/// @param  index: input index.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void CompEvent_Switch(CompEvent_TypeDef* engine, u8 index)
+{
+    engine->Current    = index;
+    COMP->CSR1         = engine->Csr | engine->Inputs[index];
+    engine->SwitchTime = CompEvent_GetTime(engine);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: capture mode on TIM2, 30 mV
+///         hysteresis, 1 us blanking and a 20 us poll period at 72 MHz.
+/// @param  init_struct: pointer to a CompEvent_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void CompEvent_StructInit(CompEvent_InitTypeDef* init_struct)
+{
+    init_struct->Mode        = CompEvent_Capture;
+    init_struct->Timer       = TIM2;
+    init_struct->Inputs      = NULL;
+    init_struct->InputCount  = 0;
+    init_struct->Inverting   = COMP_InvertingInput_IO0;
+    init_struct->Hysteresis  = COMP_Hysteresis_Medium;
+    init_struct->Filter      = COMP_Filter_4_Period;
+    init_struct->AutoAdvance = false;
+    init_struct->Blanking    = 72;
+    init_struct->PollPeriod  = 1440;
+    init_struct->PollWait    = COMP_POLL_PERIOD_4;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures COMP1 and the timer and starts queuing events.
+/// @param  engine: pointer to the engine state.
+/// @param  init_struct: pointer to a CompEvent_InitTypeDef structure.
+/// @retval ERROR on invalid parameters, or a poll period shorter than
+///         COMP_EVENT_POLL_MAX_HZ allows at the timer clock.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus CompEvent_Init(CompEvent_TypeDef* engine, const CompEvent_InitTypeDef* init_struct)
+{
+    COMP_InitTypeDef comp_init;
+    COMP_POLL_InitTypeDef poll_init;
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_ICInitTypeDef ic_init;
+    TIM_TypeDef* tim = init_struct->Timer;
+    bool poll = (init_struct->Mode == CompEvent_Poll);
+    u8 n = init_struct->InputCount;
+
+    if (((tim != TIM2) && (tim != TIM3)) ||
+        (poll && (((n != 2) && (n != 3)) || (init_struct->PollPeriod < 2) ||
+                  (DRV_TimerClock(tim) / init_struct->PollPeriod > COMP_EVENT_POLL_MAX_HZ))) ||
+        (!poll && ((init_struct->Inputs == NULL) || (n == 0) || (n > COMP_EVENT_MAX_INPUTS)))) {
+        return ERROR;
+    }
+    engine->Mode        = init_struct->Mode;
+    engine->Timer       = tim;
+    engine->Capture     = (tim == TIM2) ? &tim->CCR4 : &tim->CCR1;
+    engine->CaptureFlag = (tim == TIM2) ? TIM_SR_CC4I : TIM_SR_CC1I;
+    engine->OverFlag    = (tim == TIM2) ? TIM_SR_CC4O : TIM_SR_CC1O;
+    engine->Inputs      = init_struct->Inputs;
+    engine->InputCount  = n;
+    engine->Current     = 0;
+    engine->AutoAdvance = init_struct->AutoAdvance;
+    engine->Blanking    = init_struct->Blanking;
+    engine->Period      = poll ? init_struct->PollPeriod : 0x10000;
+    engine->Base        = 0;
+    engine->TickClock   = DRV_TimerClock(tim);
+    engine->Head        = 0;
+    engine->Tail        = 0;
+    engine->Events      = 0;
+    engine->Dropped     = 0;
+    engine->Blanked     = 0;
+    engine->Overruns    = 0;
+
+    RCC_APB2PeriphClockCmd(RCC_APB2ENR_COMP, ENABLE);
+    COMP_StructInit(&comp_init);
+    comp_init.Invert     = init_struct->Inverting;
+    comp_init.NonInvert  = poll ? COMP_NonInvertingInput_IO0 : init_struct->Inputs[0];
+    comp_init.Output     = poll ? COMP_Output_None : (tim == TIM2) ? COMP_Output_TIM2IC4 : COMP_Output_TIM3IC1;
+    comp_init.Hysteresis = init_struct->Hysteresis;
+    comp_init.Mode       = COMP_Mode_HighSpeed;
+    comp_init.OFLT       = init_struct->Filter;
+    COMP_Init(COMP1, &comp_init);
+    COMP_Cmd(COMP1, ENABLE);
+    engine->Csr = COMP->CSR1 & ~(COMP_CSR_INP | COMP_CSR_STA);
+
+    if (poll) {
+        poll_init.COMP_Poll_En     = COMP_POLL_EN_ENABLE;
+        poll_init.COMP_Poll_Ch     = (n == 3) ? COMP_POLL_CH_1_2_3 : COMP_POLL_CH_1_2;
+        poll_init.COMP_Poll_Fixn   = COMP_POLL_FIXN_FIXED;
+        poll_init.COMP_Poll_Period = init_struct->PollWait;
+        poll_init.COMP_Poll_Pout   = 0;
+        COMP_POLL_Init(COMP1, &poll_init);
+        engine->Level = (u8)((COMP->POLL1 & COMP_POLL_POUT) >> COMP_POLL_POUT_Pos);
+    }
+
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = engine->Period - 1;
+    TIM_TimeBaseInit(tim, &tim_init);
+    if (!poll) {
+        TIM_ICStructInit(&ic_init);
+        ic_init.TIM_Channel     = (tim == TIM2) ? TIM_Channel_4 : TIM_Channel_1;
+        ic_init.TIM_ICPolarity  = TIM_ICPolarity_BothEdge;
+        ic_init.TIM_ICSelection = TIM_ICSelection_DirectTI;
+        TIM_ICInit(tim, &ic_init);
+    }
+    tim->SR = 0;
+    TIM_ITConfig(tim, poll ? TIM_IT_Update : (TIM_IT_Update | ((tim == TIM2) ? TIM_IT_CC4 : TIM_IT_CC1)), ENABLE);
+    DRV_NVICEnable(DRV_TimerIRQn(tim), 0);
+    TIM_Cmd(tim, ENABLE);
+    engine->SwitchTime = CompEvent_GetTime(engine);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Selects the input watched in capture mode, e.g. the floating
+///         phase at each commutation.
+/// @param  engine: pointer to the engine state.
+/// @param  index: input index.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void CompEvent_Select(CompEvent_TypeDef* engine, u8 index)
+{
+    if ((engine->Mode != CompEvent_Capture) || (index >= engine->InputCount)) {
+        return;
+    }
+    DRV_ENTER_CRITICAL();
+    CompEvent_Switch(engine, index);
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Takes the oldest queued event.
+/// @param  engine: pointer to the engine state.
+/// @param  event: receives the event.
+/// @retval false if the queue is empty.
+////////////////////////////////////////////////////////////////////////////////
+bool CompEvent_Read(CompEvent_TypeDef* engine, CompEvent_EventTypeDef* event)
+{
+    u8 tail = engine->Tail;
+
+    if (tail == engine->Head) {
+        return false;
+    }
+    *event = engine->Queue[tail];
+    engine->Tail = (u8)((tail + 1) & (COMP_EVENT_QUEUE_SIZE - 1));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the current time on the event time base.
+/// @param  engine: pointer to the engine state.
+/// @retval Timer ticks.
+////////////////////////////////////////////////////////////////////////////////
+u32 CompEvent_GetTime(CompEvent_TypeDef* engine)
+{
+    TIM_TypeDef* tim = engine->Timer;
+    u32 base, cnt;
+
+    DRV_ENTER_CRITICAL();
+    base = engine->Base;
+    cnt  = tim->CNT;
+    if ((tim->SR & TIM_SR_UI) && (cnt < engine->Period / 2)) {
+        base += engine->Period;
+    }
+    DRV_EXIT_CRITICAL();
+    return base + cnt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Timer interrupt service: captured edges and time base extension
+///         or POUT sampling.
+/// @param  engine: pointer to the engine state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void CompEvent_IRQHandler(CompEvent_TypeDef* engine)
+{
+    TIM_TypeDef* tim = engine->Timer;
+    u32 status = tim->SR;
+    u32 ccr, time;
+    u8 pout, changed, i;
+
+    if (status & engine->CaptureFlag) {
+        ccr  = *engine->Capture;
+        time = engine->Base + ccr;
+        if ((status & TIM_SR_UI) && (ccr < engine->Period / 2)) {
+            time += engine->Period;
+        }
+        if (status & engine->OverFlag) {
+            tim->SR = ~engine->OverFlag;
+            engine->Overruns++;
+        }
+        if (time - engine->SwitchTime < engine->Blanking) {
+            engine->Blanked++;
+        }
+        else {
+            CompEvent_Push(engine, time, engine->Current, (u8)((COMP->CSR1 & COMP_CSR_STA) != 0));
+            if (engine->AutoAdvance && (engine->InputCount > 1)) {
+                CompEvent_Switch(engine, (u8)((engine->Current + 1 < engine->InputCount) ? engine->Current + 1 : 0));
+            }
+        }
+    }
+    if (status & TIM_SR_UI) {
+        tim->SR = ~TIM_SR_UI;
+        engine->Base += engine->Period;
+        if (engine->Mode == CompEvent_Poll) {
+            pout    = (u8)((COMP->POLL1 & COMP_POLL_POUT) >> COMP_POLL_POUT_Pos);
+            changed = (u8)((pout ^ engine->Level) & ((1U << engine->InputCount) - 1));
+            engine->Level = pout;
+            for (i = 0; changed != 0; i++, changed >>= 1) {
+                if (changed & 0x01) {
+                    CompEvent_Push(engine, engine->Base, i, (u8)((pout >> i) & 0x01));
+                }
+            }
+        }
+    }
+}
+
+/// @}
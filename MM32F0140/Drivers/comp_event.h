@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     comp_event.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE COMPARATOR
+///           EVENT ENGINE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __COMP_EVENT_H
+#define __COMP_EVENT_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup COMP_EVENT
+/// @brief Comparator event engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup COMP_EVENT_Exported_Constants
+/// @{
+
+#define COMP_EVENT_MAX_INPUTS       (4U)                                        ///< Non-inverting inputs of COMP1
+#define COMP_EVENT_QUEUE_SIZE       (16U)                                       ///< Events, power of two
+#define COMP_EVENT_POLL_MAX_HZ      (50000U)                                    ///< Poll: highest sampling interrupt rate
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup COMP_EVENT_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Acquisition mode
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    CompEvent_Capture,                                                          ///< One input at a time, edges captured by the timer
+    CompEvent_Poll                                                              ///< Hardware polling of 2 or 3 inputs, sampled per period
+} CompEvent_ModeTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Comparator transition
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             Time;                                       ///< Timer ticks, wraps at 32 bits
+    u8                              Input;                                      ///< Index in Inputs (Capture) or polled channel (Poll)
+    u8                              Level;                                      ///< Comparator output after the edge
+} CompEvent_EventTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Comparator event engine init structure definition. Pins (analog
+///         mode) are left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    CompEvent_ModeTypeDef           Mode;
+    TIM_TypeDef*                    Timer;                                      ///< TIM2 (IC4) or TIM3 (IC1)
+    const u32*                      Inputs;                                     ///< Capture: COMP_NonInvertingInput_IOx values
+    u8                              InputCount;                                 ///< Capture: 1 to 4, Poll: 2 or 3
+    u32                             Inverting;                                  ///< COMP_InvertingInput_x, e.g. the star point
+    u32                             Hysteresis;                                 ///< COMP_Hysteresis_x
+    u32                             Filter;                                     ///< COMP_Filter_x_Period
+    bool                            AutoAdvance;                                ///< Capture: select the next input after each edge
+    u16                             Blanking;                                   ///< Capture: ticks ignored after an input switch
+    u16                             PollPeriod;                                 ///< Poll: ticks between samples, COMP_EVENT_POLL_MAX_HZ at most
+    u32                             PollWait;                                   ///< Poll: COMP_POLL_PERIOD_x per channel
+} CompEvent_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Comparator event engine state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    CompEvent_ModeTypeDef           Mode;
+    TIM_TypeDef*                    Timer;
+    __IO u32*                       Capture;                                    ///< CCRx fed by the comparator
+    u32                             CaptureFlag;                                ///< TIM_SR_CCxI
+    u32                             OverFlag;                                   ///< TIM_SR_CCxO
+    const u32*                      Inputs;
+    u8                              InputCount;
+    u8                              Current;                                    ///< Capture: selected input
+    bool                            AutoAdvance;
+    u16                             Blanking;
+    u32                             Csr;                                        ///< COMP1 CSR without the input selection
+    u32                             SwitchTime;                                 ///< Capture: last input switch
+    u32                             Period;                                     ///< Timer reload + 1
+    u8                              Level;                                      ///< Poll: last POUT
+    volatile u32                    Base;                                       ///< Ticks at the last timer update
+    u32                             TickClock;                                  ///< Timer counter clock, Hz
+    CompEvent_EventTypeDef          Queue[COMP_EVENT_QUEUE_SIZE];
+    volatile u8                     Head;
+    volatile u8                     Tail;
+    u32                             Events;
+    u32                             Dropped;                                    ///< Queue full
+    u32                             Blanked;                                    ///< Edges inside the blanking time
+    u32                             Overruns;                                   ///< Edges lost to overcapture
+} CompEvent_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup COMP_EVENT_Exported_Functions
+/// @{
+
+void CompEvent_StructInit(CompEvent_InitTypeDef* init_struct);
+ErrorStatus CompEvent_Init(CompEvent_TypeDef* engine, const CompEvent_InitTypeDef* init_struct);
+void CompEvent_Select(CompEvent_TypeDef* engine, u8 index);
+bool CompEvent_Read(CompEvent_TypeDef* engine, CompEvent_EventTypeDef* event);
+u32 CompEvent_GetTime(CompEvent_TypeDef* engine);
+void CompEvent_IRQHandler(CompEvent_TypeDef* engine);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __COMP_EVENT_H
+////////////////////////////////////////////////////////////////////////////////
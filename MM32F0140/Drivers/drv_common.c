@@ -0,0 +1,240 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     drv_common.c
+/// @brief    THIS FILE PROVIDES THE HELPERS SHARED BY THE DRIVERS IN THIS
+///           FOLDER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _DRV_COMMON_C_
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup DRV_COMMON
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the counter clock of a timer before its prescaler.
+/// @param  tim: TIM1, TIM2, TIM3, TIM14, TIM16 or TIM17.
+/// @retval Timer kernel clock in Hz. Doubles the APB clock when the APB
+///         prescaler is not 1, as the timer clock multiplier does.
+////////////////////////////////////////////////////////////////////////////////
+u32 DRV_TimerClock(TIM_TypeDef* tim)
+{
+    u32 pclk = ((tim == TIM2) || (tim == TIM3)) ? RCC_GetPCLK1Freq() : RCC_GetPCLK2Freq();
+
+    return (pclk == RCC_GetHCLKFreq()) ? pclk : (pclk * 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Enables or disables the bus clock of a timer.
+/// @param  tim: TIM1, TIM2, TIM3, TIM14, TIM16 or TIM17.
+/// @param  state: ENABLE or DISABLE.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void DRV_TimerClockCmd(TIM_TypeDef* tim, FunctionalState state)
+{
+    if (tim == TIM1) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_TIM1, state);
+    }
+    else if (tim == TIM2) {
+        RCC_APB1PeriphClockCmd(RCC_APB1ENR_TIM2, state);
+    }
+    else if (tim == TIM3) {
+        RCC_APB1PeriphClockCmd(RCC_APB1ENR_TIM3, state);
+    }
+    else if (tim == TIM14) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_TIM14, state);
+    }
+    else if (tim == TIM16) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_TIM16, state);
+    }
+    else if (tim == TIM17) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_TIM17, state);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the update interrupt line of a timer.
+/// @param  tim: TIM1, TIM2, TIM3, TIM14, TIM16 or TIM17.
+/// @retval IRQ number (TIM1_BRK_UP_TRG_COM_IRQn for TIM1).
+////////////////////////////////////////////////////////////////////////////////
+IRQn_Type DRV_TimerIRQn(TIM_TypeDef* tim)
+{
+    if (tim == TIM1) {
+        return TIM1_BRK_UP_TRG_COM_IRQn;
+    }
+    if (tim == TIM2) {
+        return TIM2_IRQn;
+    }
+    if (tim == TIM3) {
+        return TIM3_IRQn;
+    }
+    if (tim == TIM14) {
+        return TIM14_IRQn;
+    }
+    if (tim == TIM16) {
+        return TIM16_IRQn;
+    }
+    return TIM17_IRQn;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the DMA channel that serves a timer DMA request. TIM16 and
+///         TIM17 follow their SYSCFG remap bits.
+/// @param  tim: TIM1, TIM2, TIM3, TIM16 or TIM17.
+/// @param  source: a single TIM_DMA_xxx request.
+/// @retval DMA channel, or NULL if the request has no channel.
+////////////////////////////////////////////////////////////////////////////////
+DMA_Channel_TypeDef* DRV_TimerDMAChannel(TIM_TypeDef* tim, TIMDMASRC_Typedef source)
+{
+    if (tim == TIM1) {
+        switch (source) {
+            case TIM_DMA_CC1:
+                return DMA1_Channel2;
+            case TIM_DMA_CC2:
+                return DMA1_Channel3;
+            case TIM_DMA_CC4:
+            case TIM_DMA_COM:
+            case TIM_DMA_Trigger:
+                return DMA1_Channel4;
+            case TIM_DMA_CC3:
+            case TIM_DMA_Update:
+                return DMA1_Channel5;
+            default:
+                return NULL;
+        }
+    }
+    if (tim == TIM2) {
+        switch (source) {
+            case TIM_DMA_CC3:
+                return DMA1_Channel1;
+            case TIM_DMA_Update:
+                return DMA1_Channel2;
+            case TIM_DMA_CC2:
+                return DMA1_Channel3;
+            case TIM_DMA_CC4:
+                return DMA1_Channel4;
+            case TIM_DMA_CC1:
+                return DMA1_Channel5;
+            default:
+                return NULL;
+        }
+    }
+    if (tim == TIM3) {
+        switch (source) {
+            case TIM_DMA_CC3:
+                return DMA1_Channel2;
+            case TIM_DMA_CC4:
+            case TIM_DMA_Update:
+                return DMA1_Channel3;
+            case TIM_DMA_CC1:
+            case TIM_DMA_Trigger:
+                return DMA1_Channel4;
+            default:
+                return NULL;
+        }
+    }
+    if ((source != TIM_DMA_CC1) && (source != TIM_DMA_Update)) {
+        return NULL;
+    }
+    if (tim == TIM16) {
+        return (SYSCFG->CFGR & SYSCFG_CFGR_TIM16_DMA_RMP) ? DMA1_Channel4 : DMA1_Channel3;
+    }
+    if (tim == TIM17) {
+        return (SYSCFG->CFGR & SYSCFG_CFGR_TIM17_DMA_RMP) ? DMA1_Channel2 : DMA1_Channel1;
+    }
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the interrupt line of a DMA channel.
+/// @param  channel: DMA1_Channel1 .. DMA1_Channel5.
+/// @retval IRQ number (shared by channels 2/3 and 4/5).
+////////////////////////////////////////////////////////////////////////////////
+IRQn_Type DRV_DMAIRQn(DMA_Channel_TypeDef* channel)
+{
+    if (channel == DMA1_Channel1) {
+        return DMA1_Channel1_IRQn;
+    }
+    if ((channel == DMA1_Channel2) || (channel == DMA1_Channel3)) {
+        return DMA1_Channel2_3_IRQn;
+    }
+    return DMA1_Channel4_5_IRQn;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Encodes a dead time for the BDTR dead-time generator of an
+///         advanced timer running with CKD = 1. The generator counts 1, 2, 8
+///         or 16 clocks per step; the time is rounded down.
+/// @param  tim: TIM1.
+/// @param  ns: dead time, up to 1008 timer clocks.
+/// @param  dtg: receives the DTG field value.
+/// @retval ERROR if the dead time is beyond the generator's range.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus DRV_TimerDeadTime(TIM_TypeDef* tim, u32 ns, u8* dtg)
+{
+    u64 dead = (u64)DRV_TimerClock(tim) * ns / 1000000000;
+
+    if (dead > 1008) {
+        return ERROR;
+    }
+    if (dead >= 512) {
+        *dtg = (u8)(0xE0 | (dead / 16 - 32));
+    }
+    else if (dead >= 256) {
+        *dtg = (u8)(0xC0 | (dead / 8 - 32));
+    }
+    else if (dead >= 128) {
+        *dtg = (u8)(0x80 | (dead / 2 - 64));
+    }
+    else {
+        *dtg = (u8)dead;
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Integer square root.
+/// @param  x: radicand.
+/// @retval floor(sqrt(x)).
+////////////////////////////////////////////////////////////////////////////////
+u32 DRV_Sqrt(u64 x)
+{
+    u64 root = 0;
+    u64 bit  = (u64)1 << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x    -= root + bit;
+            root  = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (u32)root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Enables an interrupt line with the given priority.
+/// @param  irq: interrupt number.
+/// @param  priority: 0 (highest) .. 3.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void DRV_NVICEnable(IRQn_Type irq, u8 priority)
+{
+    NVIC_InitTypeDef nvic_init;
+
+    nvic_init.NVIC_IRQChannel         = (u8)irq;
+    nvic_init.NVIC_IRQChannelPriority = priority;
+    nvic_init.NVIC_IRQChannelCmd      = ENABLE;
+    NVIC_Init(&nvic_init);
+}
+
+/// @}
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     drv_common.h
+/// @brief    THIS FILE CONTAINS THE HELPERS SHARED BY THE DRIVERS IN THIS
+///           FOLDER (CRITICAL SECTIONS, DMA CHANNEL FLAGS, TIMER CLOCKS).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __DRV_COMMON_H
+#define __DRV_COMMON_H
+
+// Files includes
+#include "hal_conf.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup DRV_COMMON
+/// @brief Helpers shared by the drivers
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup DRV_COMMON_Exported_Constants
+/// @{
+
+/// Bit offset of a channel's GL/TC/HT/TE group in DMA1->ISR and DMA1->IFCR.
+/// Channels are 0x14 apart starting at offset 0x08, each group is 4 bits wide.
+#define DMA_CHANNEL_SHIFT(channel)          (((((u32)(channel)) & 0xFFU) - 8U) / 5U)
+
+/// Moves DMAx_FLAG_xxy / DMAx_IT_xxy bits onto the given channel.
+#define DMA_CHANNEL_FLAGS(channel, flags)   ((u32)(flags) << DMA_CHANNEL_SHIFT(channel))
+
+/// Saves PRIMASK and masks interrupts; pair with DRV_EXIT_CRITICAL in the
+/// same scope.
+#define DRV_ENTER_CRITICAL()                u32 drv_primask = __get_PRIMASK(); __disable_irq()
+#define DRV_EXIT_CRITICAL()                 __set_PRIMASK(drv_primask)
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup DRV_COMMON_Exported_Functions
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reprograms and starts a DMA channel in one go.
+/// @param  channel: DMA1_Channel1 .. DMA1_Channel5.
+/// @param  ccr: complete CCR value without the EN bit.
+/// @param  peripheral: peripheral register address.
+/// @param  memory: memory buffer address.
+/// @param  count: number of data items.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static inline void DRV_DMAStart(DMA_Channel_TypeDef* channel, u32 ccr, u32 peripheral, u32 memory, u16 count)
+{
+    channel->CCR   = 0;
+    DMA1->IFCR     = DMA_CHANNEL_FLAGS(channel, DMAx_FLAG_GLy | DMAx_FLAG_TCy | DMAx_FLAG_HTy | DMAx_FLAG_TEy);
+    channel->CPAR  = peripheral;
+    channel->CMAR  = memory;
+    channel->CNDTR = count;
+    channel->CCR   = ccr | DMA_CCR_EN;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Unsigned 32-bit division on the hardware divider through the
+///         HAL (HWDivider_Init, HWDivider_Calc), in about 20 cycles instead
+///         of about 100 for the library routine. The divider is shared and
+///         the HAL calls are not reentrant, so the pair runs masked.
+///         RCC_AHBENR_HWDIV must be enabled.
+/// @param  dividend: dividend.
+/// @param  divisor: divisor, not 0.
+/// @retval Quotient.
+////////////////////////////////////////////////////////////////////////////////
+static inline u32 DRV_Div(u32 dividend, u32 divisor)
+{
+    u32 quotient;
+
+    DRV_ENTER_CRITICAL();
+    HWDivider_Init(true, false);
+    quotient = (u32)HWDivider_Calc(dividend, divisor);
+    DRV_EXIT_CRITICAL();
+    return quotient;
+}
+
+u32 DRV_TimerClock(TIM_TypeDef* tim);
+void DRV_TimerClockCmd(TIM_TypeDef* tim, FunctionalState state);
+IRQn_Type DRV_TimerIRQn(TIM_TypeDef* tim);
+DMA_Channel_TypeDef* DRV_TimerDMAChannel(TIM_TypeDef* tim, TIMDMASRC_Typedef source);
+IRQn_Type DRV_DMAIRQn(DMA_Channel_TypeDef* channel);
+void DRV_NVICEnable(IRQn_Type irq, u8 priority);
+ErrorStatus DRV_TimerDeadTime(TIM_TypeDef* tim, u32 ns, u8* dtg);
+u32 DRV_Sqrt(u64 x);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __DRV_COMMON_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     encoder.c
+/// @brief    THIS FILE PROVIDES THE QUADRATURE ENCODER POSITION AND VELOCITY
+///           SERVICE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The counter timer runs in x4 encoder mode over a 16-bit range.
+/// Encoder_Update is called at a fixed rate, typically from the control
+/// interrupt. It adds the signed 16-bit difference to a 64-bit position,
+/// which stays exact as long as the shaft moves less than 32767 counts per
+/// sample. A second timer runs free and captures both edges of A (CH1)
+/// and B (CH2). Every count is one of these edges, so the newer of the two
+/// captures is the time of the latest count.
+///
+/// Velocity is returned in counts per sample, Q16:
+///   - M/T: M counts over the time T between the last edge of the
+///     previous window and the last edge of this one,
+///     v = M * (Ts << 16) / T. This is exact to one capture clock instead
+///     of one count, so it also works at a few counts per second. If no
+///     edge came in a window, the estimate is capped to one count over the
+///     time since the last edge, and it reads 0 after StopMs.
+///   - M: above HighCounts per sample, M alone is precise enough, and the
+///     edges are too dense to read back consistently: v = M << 16.
+///     The method falls back to M/T below HighCounts / 2.
+/// The only division, (Ts << 16) / T, runs on the hardware divider (DRV_Div).
+/// An M/T update takes about 90 cycles, an M update about 30.
+///
+/// The capture timer may be the one running the Timestamp service. It is
+/// used as is, and TIM2 then allows 59 s between edges. A 16-bit capture
+/// timer limits StopMs to 0.45 ms at 72 MHz.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ENCODER_C_
+
+// Files includes
+#include "encoder.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup ENCODER
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default encoder settings: TIM3 counting, TIM2
+///         capturing, 10 kHz update, M method from 32 counts per sample,
+///         standstill after 100 ms.
+/// @param  init_struct: pointer to an Encoder_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Encoder_StructInit(Encoder_InitTypeDef* init_struct)
+{
+    init_struct->Counter    = TIM3;
+    init_struct->Capture    = TIM2;
+    init_struct->SampleHz   = 10000;
+    init_struct->HighCounts = 32;
+    init_struct->StopMs     = 100;
+    init_struct->Filter     = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the encoder interface and the edge captures.
+/// @param  enc: pointer to the encoder state.
+/// @param  init_struct: pointer to an Encoder_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Encoder_Init(Encoder_TypeDef* enc, const Encoder_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_ICInitTypeDef ic_init;
+    TIM_TypeDef* counter = init_struct->Counter;
+    TIM_TypeDef* cap     = init_struct->Capture;
+    u32 clock, period;
+
+    if (((counter != TIM1) && (counter != TIM2) && (counter != TIM3)) || (cap == NULL) || (cap == counter) ||
+        (init_struct->SampleHz == 0) || (init_struct->HighCounts < 2)) {
+        return ERROR;
+    }
+    clock = DRV_TimerClock(cap);
+    if (clock == 0) {
+        return ERROR;
+    }
+    enc->Counter    = counter;
+    enc->Capture    = cap;
+    enc->HighCounts = init_struct->HighCounts;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_HWDIV, ENABLE);
+    DRV_TimerClockCmd(counter, ENABLE);
+    DRV_TimerClockCmd(cap, ENABLE);
+
+    TIM_ICStructInit(&ic_init);
+    ic_init.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    ic_init.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    ic_init.TIM_ICFilter    = init_struct->Filter;
+
+    // Position: x4 encoder interface over 16 bits, extended by the updates.
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = 0xFFFF;
+    TIM_TimeBaseInit(counter, &tim_init);
+    ic_init.TIM_ICPolarity = TIM_ICPolarity_Rising;
+    ic_init.TIM_Channel    = TIM_Channel_1;
+    TIM_ICInit(counter, &ic_init);
+    ic_init.TIM_Channel    = TIM_Channel_2;
+    TIM_ICInit(counter, &ic_init);
+    TIM_EncoderInterfaceConfig(counter, TIM_EncoderMode_TI12, TIM_ICPolarity_Rising, TIM_ICPolarity_Rising);
+    TIM_Cmd(counter, ENABLE);
+
+    // Edge times: a running time base is shared as it is.
+    if (!(cap->CR1 & TIM_CR1_CEN)) {
+        tim_init.TIM_Period = 0xFFFFFFFF;
+        TIM_TimeBaseInit(cap, &tim_init);
+        TIM_Cmd(cap, ENABLE);
+    }
+    ic_init.TIM_ICPolarity = TIM_ICPolarity_BothEdge;
+    ic_init.TIM_Channel    = TIM_Channel_1;
+    TIM_ICInit(cap, &ic_init);
+    ic_init.TIM_Channel    = TIM_Channel_2;
+    TIM_ICInit(cap, &ic_init);
+
+    clock         /= cap->PSC + 1;
+    enc->Mask      = cap->ARR;
+    enc->StopTicks = (u32)((u64)clock * init_struct->StopMs / 1000);
+    enc->StopTicks = (enc->StopTicks < (enc->Mask >> 1)) ? enc->StopTicks : (enc->Mask >> 1);
+    period         = clock / init_struct->SampleHz;
+    enc->Shift     = 16;
+    while ((enc->Shift > 0) && ((period >> (32 - enc->Shift)) != 0)) {
+        enc->Shift--;
+    }
+    enc->Scale = period << enc->Shift;
+
+    enc->LastCount = (u16)counter->CNT;
+    enc->Position  = 0;
+    enc->Velocity  = 0;
+    enc->Mode      = Encoder_ModeMT;
+    enc->EdgeValid = false;
+    enc->Direction = 0;
+    enc->LastEdge  = 0;
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Samples the encoder: extends the position and estimates the
+///         velocity. Call it at SampleHz.
+/// @param  enc: pointer to the encoder state.
+/// @retval Velocity in counts per sample, Q16.
+////////////////////////////////////////////////////////////////////////////////
+s32 Encoder_Update(Encoder_TypeDef* enc)
+{
+    TIM_TypeDef* cap = enc->Capture;
+    u32 c1, c2, now, edge, t, limit;
+    u16 count;
+    s32 m, v;
+
+    if (enc->Mode == Encoder_ModeM) {
+        count          = (u16)enc->Counter->CNT;
+        m              = (s16)(count - enc->LastCount);
+        enc->LastCount = count;
+        enc->Position += m;
+        v              = m * 65536;
+        if (((m < 0) ? -m : m) < (enc->HighCounts >> 1)) {
+            // Back to M/T once the next edge gives a reference.
+            enc->Mode      = Encoder_ModeMT;
+            enc->EdgeValid = false;
+        }
+        enc->Velocity = v;
+        return v;
+    }
+
+    // An edge between the reads would be counted but not timed, or the
+    // reverse: read the captures again until they hold still.
+    do {
+        c1    = cap->CCR1;
+        c2    = cap->CCR2;
+        now   = cap->CNT;
+        count = (u16)enc->Counter->CNT;
+    } while ((c1 != cap->CCR1) || (c2 != cap->CCR2));
+    m              = (s16)(count - enc->LastCount);
+    enc->LastCount = count;
+    enc->Position += m;
+    edge = (((now - c1) & enc->Mask) < ((now - c2) & enc->Mask)) ? c1 : c2;
+
+    if (m != 0) {
+        if (enc->EdgeValid && (enc->Direction == ((m > 0) ? 1 : -1))) {
+            t = (edge - enc->LastEdge) & enc->Mask;
+            v = m * (s32)(DRV_Div(enc->Scale, (t != 0) ? t : 1) << (16 - enc->Shift));
+        }
+        else {
+            // No reference edge, or a reversal inside the window.
+            v = m * 65536;
+        }
+        enc->LastEdge  = edge;
+        enc->EdgeValid = true;
+        enc->Direction = (m > 0) ? 1 : -1;
+        if (((m < 0) ? -m : m) >= enc->HighCounts) {
+            enc->Mode = Encoder_ModeM;
+        }
+    }
+    else if (enc->EdgeValid) {
+        // The next edge is at least the time since the last one away.
+        t = (now - enc->LastEdge) & enc->Mask;
+        if (t > enc->StopTicks) {
+            v              = 0;
+            enc->EdgeValid = false;
+        }
+        else {
+            limit = DRV_Div(enc->Scale, (t != 0) ? t : 1) << (16 - enc->Shift);
+            v     = enc->Velocity;
+            if ((u32)((v < 0) ? -v : v) > limit) {
+                v = enc->Direction * (s32)limit;
+            }
+        }
+    }
+    else {
+        v = 0;
+    }
+    enc->Velocity = v;
+    return v;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets the position, e.g. on an index or homing event.
+/// @param  enc: pointer to the encoder state.
+/// @param  position: new position, in counts.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Encoder_SetPosition(Encoder_TypeDef* enc, s64 position)
+{
+    DRV_ENTER_CRITICAL();
+    enc->Position = position;
+    DRV_EXIT_CRITICAL();
+}
+
+/// @}
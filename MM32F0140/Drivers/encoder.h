@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     encoder.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE
+///           QUADRATURE ENCODER POSITION AND VELOCITY SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __ENCODER_H
+#define __ENCODER_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ENCODER
+/// @brief Quadrature encoder service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ENCODER_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Velocity estimators
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    Encoder_ModeMT,                                                             ///< Counts over the time between edges
+    Encoder_ModeM                                                               ///< Counts per sample, above HighCounts
+} Encoder_ModeTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Encoder init structure definition. The pins are left to the
+///         caller: A and B go to CH1/CH2 of both timers.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Counter;                                    ///< Encoder interface: TIM1, TIM2 or TIM3
+    TIM_TypeDef*                    Capture;                                    ///< Edge timestamps, TIM2 preferred
+    u32                             SampleHz;                                   ///< Encoder_Update rate
+    u16                             HighCounts;                                 ///< Counts per sample that select the M method
+    u16                             StopMs;                                     ///< No edge for this long reads as standstill
+    u8                              Filter;                                     ///< Input filter, 0..15
+} Encoder_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Encoder state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Counter;
+    TIM_TypeDef*                    Capture;
+    u32                             Mask;                                       ///< Capture counter range - 1
+    u32                             Scale;                                      ///< Sample period in clocks << Shift
+    u8                              Shift;
+    u16                             HighCounts;
+    u32                             StopTicks;
+    u16                             LastCount;
+    s64                             Position;                                   ///< Counts, four per line
+    s32                             Velocity;                                   ///< Counts per sample, Q16
+    Encoder_ModeTypeDef             Mode;
+    bool                            EdgeValid;                                  ///< LastEdge is a reference for the next span
+    s8                              Direction;
+    u32                             LastEdge;                                   ///< Capture time of the latest counted edge
+} Encoder_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup ENCODER_Exported_Functions
+/// @{
+
+void Encoder_StructInit(Encoder_InitTypeDef* init_struct);
+ErrorStatus Encoder_Init(Encoder_TypeDef* enc, const Encoder_InitTypeDef* init_struct);
+s32 Encoder_Update(Encoder_TypeDef* enc);
+void Encoder_SetPosition(Encoder_TypeDef* enc, s64 position);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the low 32 bits of the position.
+/// @param  enc: pointer to the encoder state.
+/// @retval Counts, wrapping at 32 bits.
+////////////////////////////////////////////////////////////////////////////////
+static inline s32 Encoder_GetPosition32(const Encoder_TypeDef* enc)
+{
+    return (s32)enc->Position;
+}
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __ENCODER_H
+////////////////////////////////////////////////////////////////////////////////
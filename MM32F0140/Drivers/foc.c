@@ -0,0 +1,421 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     foc.c
+/// @brief    THIS FILE PROVIDES THE FIELD-ORIENTED MOTOR CONTROL SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// TIM1 drives the bridge: center-aligned mode 1, PWM1 on CH1..CH3 with
+/// complementary outputs, dead time and an optional break input. CH4 is
+/// left to the AdcInject service, which triggers the phase-current
+/// conversions just after the counter peak. Foc_Init therefore comes before
+/// AdcInject_Init, and the whole loop runs in the injected-complete
+/// interrupt:
+///   static void current_cb(AdcInject_TypeDef* inj, const s16* samples)
+///   {
+///       Foc_Run(&motor, samples);
+///   }
+/// samples[0] and samples[1] are the phase A and B currents, positive into
+/// the motor.
+///
+/// One period is Clarke (Ia, Ib -> alpha, beta), Park with a sin/cos table
+/// lookup, two PI loops, a circular voltage limit, inverse Park and
+/// space-vector PWM by min/max zero-sequence injection, which reaches the
+/// same Vbus / sqrt(3) phase amplitude as sector-based SVPWM with no
+/// divisions or sector tables. The new compares are preloaded and take
+/// effect at the next update event.
+///
+/// Cycle budget on the M0 (single-cycle multiplier), measured by
+/// host/foc_bench.c over a one-second trajectory into the voltage limit:
+///   sin/cos, two interpolated lookups     ~45
+///   Clarke and Park                       ~30
+///   two PI loops with clamping            ~60
+///   voltage circle test                   ~20
+///   inverse Park and SVPWM                ~60
+///   break check, compare writes, entry    ~45
+/// About 260 cycles, 390 with the flash wait states at 72 MHz: 5.4 us, or
+/// 11 % of a 20 kHz period. A period that leaves the circle also takes
+/// DRV_Sqrt, 466 cycles for a radicand near Limit^2, which brings the worst
+/// case to 726 cycles, about 1090 with wait states: 15 us, or 30 % of the
+/// period. Wrap Foc_Run in PROFILE_BEGIN/PROFILE_END to measure it on the
+/// target.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _FOC_C_
+
+// Files includes
+#include "foc.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup FOC
+/// @{
+
+#define FOC_ONE_OVER_SQRT3          (18919)                                     ///< Q15
+#define FOC_SQRT3_OVER_TWO          (28378)                                     ///< Q15
+
+/// sin(i * pi / 512), Q15, a quarter turn plus one padding entry for the
+/// interpolation.
+static const s16 foc_sine[258] = {
+        0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,
+     2009,  2210,  2411,  2611,  2811,  3012,  3212,  3412,  3612,  3812,
+     4011,  4211,  4410,  4609,  4808,  5007,  5205,  5404,  5602,  5800,
+     5998,  6195,  6393,  6590,  6787,  6983,  7180,  7376,  7571,  7767,
+     7962,  8157,  8351,  8546,  8740,  8933,  9127,  9319,  9512,  9704,
+     9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+    13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+    15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+    17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+    18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+    20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+    22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+    23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+    24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+    26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+    27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+    28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+    29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+    30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+    30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+    31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+    31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+    32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+    32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+    32746, 32753, 32758, 32762, 32766, 32767, 32767, 32767,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the sine of an angle, interpolated between table steps.
+/// @param  angle: FOC_ANGLE_TURN per turn.
+/// @retval sin(angle), Q15.
+////////////////////////////////////////////////////////////////////////////////
+static s16 Foc_Sine(u16 angle)
+{
+    u32 a = angle & 0x3FFF;
+    u32 i;
+    s32 s;
+
+    if (angle & 0x4000) {
+        a = 0x4000 - a;
+    }
+    i = a >> 6;
+    s = foc_sine[i] + (((foc_sine[i + 1] - foc_sine[i]) * (s32)(a & 0x3F)) >> 6);
+    return (s16)((angle & 0x8000) ? -s : s);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs one PI step. The integral is clamped to the output range,
+///         so it never winds up beyond what the bridge can apply.
+/// @param  pi: pointer to the controller state.
+/// @param  error: reference minus measurement, current counts.
+/// @param  limit: output range, Q15.
+/// @retval Voltage command, Q15.
+////////////////////////////////////////////////////////////////////////////////
+static s16 Foc_PI(Foc_PITypeDef* pi, s32 error, s32 limit)
+{
+    s32 max = limit << FOC_GAIN_SHIFT;
+    s32 out;
+
+    pi->Integral += pi->Ki * error;
+    if (pi->Integral > max) {
+        pi->Integral = max;
+    }
+    else if (pi->Integral < -max) {
+        pi->Integral = -max;
+    }
+    out = (pi->Kp * error + pi->Integral) >> FOC_GAIN_SHIFT;
+    if (out > limit) {
+        out = limit;
+    }
+    else if (out < -limit) {
+        out = -limit;
+    }
+    return (s16)out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Keeps the voltage vector inside the circle of radius Limit. Each
+///         loop only clamps its own axis, so Vd and Vq together could reach
+///         sqrt(2) * Limit; d keeps priority and q, integral included, gets
+///         sqrt(Limit^2 - Vd^2). The root is only taken when the vector or
+///         the q integral actually leaves the circle.
+/// @param  foc: pointer to the FOC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Foc_Circle(Foc_TypeDef* foc)
+{
+    s32 room = foc->Limit * foc->Limit - foc->Vd * foc->Vd;
+    s32 vq   = (foc->Vq < 0) ? -foc->Vq : foc->Vq;
+    s32 iq   = (foc->PiQ.Integral < 0) ? -foc->PiQ.Integral : foc->PiQ.Integral;
+    s32 max;
+
+    iq = (iq + (1 << FOC_GAIN_SHIFT) - 1) >> FOC_GAIN_SHIFT;
+    if ((vq * vq <= room) && (iq * iq <= room)) {
+        return;
+    }
+    max = (s32)DRV_Sqrt((u64)room);
+    if (foc->Vq > max) {
+        foc->Vq = (s16)max;
+    }
+    else if (foc->Vq < -max) {
+        foc->Vq = (s16)-max;
+    }
+    max <<= FOC_GAIN_SHIFT;
+    if (foc->PiQ.Integral > max) {
+        foc->PiQ.Integral = max;
+    }
+    else if (foc->PiQ.Integral < -max) {
+        foc->PiQ.Integral = -max;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: 20 kHz, 500 ns dead time, break
+///         input enabled active low, soft gains, full voltage range.
+/// @param  init_struct: pointer to a Foc_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Foc_StructInit(Foc_InitTypeDef* init_struct)
+{
+    init_struct->PwmHz         = 20000;
+    init_struct->DeadTimeNs    = 500;
+    init_struct->Break         = true;
+    init_struct->BreakPolarity = TIM_BreakPolarity_Low;
+    init_struct->Kp            = 1 << FOC_GAIN_SHIFT;
+    init_struct->Ki            = 1 << (FOC_GAIN_SHIFT - 4);
+    init_struct->Limit         = 32767;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets up TIM1 as a three-phase bridge driver and starts it with
+///         the outputs off and all phases at 50 %.
+/// @param  foc: pointer to the FOC state.
+/// @param  init_struct: pointer to a Foc_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Foc_Init(Foc_TypeDef* foc, const Foc_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_OCInitTypeDef oc_init;
+    TIM_BDTRInitTypeDef bdtr_init;
+    u32 clock = DRV_TimerClock(TIM1);
+    u32 period;
+    u8 dead;
+
+    if ((clock == 0) || (init_struct->PwmHz == 0) || (init_struct->Limit <= 0)) {
+        return ERROR;
+    }
+    period = clock / 2 / init_struct->PwmHz;
+    if ((period < 16) || (period > 0xFFFF) || (DRV_TimerDeadTime(TIM1, init_struct->DeadTimeNs, &dead) != SUCCESS)) {
+        return ERROR;
+    }
+
+    foc->Period       = (u16)period;
+    foc->Gain         = (u16)((period * FOC_ONE_OVER_SQRT3) >> 15);
+    foc->Limit        = init_struct->Limit;
+    foc->Enabled      = false;
+    foc->Angle        = 0;
+    foc->AngleStep    = 0;
+    foc->IdRef        = 0;
+    foc->IqRef        = 0;
+    foc->PiD.Kp       = init_struct->Kp;
+    foc->PiD.Ki       = init_struct->Ki;
+    foc->PiD.Integral = 0;
+    foc->PiQ          = foc->PiD;
+    foc->Id           = 0;
+    foc->Iq           = 0;
+    foc->Vd           = 0;
+    foc->Vq           = 0;
+    foc->Duty[0]      = (u16)(period / 2);
+    foc->Duty[1]      = (u16)(period / 2);
+    foc->Duty[2]      = (u16)(period / 2);
+    foc->Count        = 0;
+    foc->Faults       = 0;
+
+    DRV_TimerClockCmd(TIM1, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler   = 0;
+    tim_init.TIM_Period      = period;
+    tim_init.TIM_CounterMode = TIM_CounterMode_CenterAligned1;
+    TIM_TimeBaseInit(TIM1, &tim_init);
+    TIM_ARRPreloadConfig(TIM1, ENABLE);
+
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OCMode       = TIM_OCMode_PWM1;
+    oc_init.TIM_OutputState  = TIM_OutputState_Enable;
+    oc_init.TIM_OutputNState = TIM_OutputNState_Enable;
+    oc_init.TIM_Pulse        = period / 2;
+    oc_init.TIM_OCPolarity   = TIM_OCPolarity_High;
+    oc_init.TIM_OCNPolarity  = TIM_OCNPolarity_High;
+    oc_init.TIM_OCIdleState  = TIM_OCIdleState_Reset;
+    oc_init.TIM_OCNIdleState = TIM_OCNIdleState_Reset;
+    TIM_OC1Init(TIM1, &oc_init);
+    TIM_OC2Init(TIM1, &oc_init);
+    TIM_OC3Init(TIM1, &oc_init);
+    TIM_OC1PreloadConfig(TIM1, TIM_OCPreload_Enable);
+    TIM_OC2PreloadConfig(TIM1, TIM_OCPreload_Enable);
+    TIM_OC3PreloadConfig(TIM1, TIM_OCPreload_Enable);
+
+    // Off-state selection keeps the low sides driven low while MOE is clear.
+    TIM_BDTRStructInit(&bdtr_init);
+    bdtr_init.TIM_OSSRState       = TIM_OSSRState_Enable;
+    bdtr_init.TIM_OSSIState       = TIM_OSSIState_Enable;
+    bdtr_init.TIM_LOCKLevel       = TIM_LOCKLevel_OFF;
+    bdtr_init.TIM_DeadTime        = dead;
+    bdtr_init.TIM_Break           = init_struct->Break ? TIM_Break_Enable : TIM_Break_Disable;
+    bdtr_init.TIM_BreakPolarity   = init_struct->BreakPolarity;
+    bdtr_init.TIM_AutomaticOutput = TIM_AutomaticOutput_Disable;
+    TIM_BDTRConfig(TIM1, &bdtr_init);
+
+    TIM_GenerateEvent(TIM1, TIM_EventSource_Update);
+    TIM_Cmd(TIM1, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the bridge on or off. Turning on clears the loops and
+///         the break flag first.
+/// @param  foc: pointer to the FOC state.
+/// @param  state: ENABLE or DISABLE.
+/// @retval ERROR if the break input is still active.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Foc_Enable(Foc_TypeDef* foc, FunctionalState state)
+{
+    if (state == DISABLE) {
+        foc->Enabled = false;
+        TIM_CtrlPWMOutputs(TIM1, DISABLE);
+        return SUCCESS;
+    }
+    {
+        DRV_ENTER_CRITICAL();
+        foc->PiD.Integral = 0;
+        foc->PiQ.Integral = 0;
+        DRV_EXIT_CRITICAL();
+    }
+    TIM_ClearFlag(TIM1, TIM_FLAG_Break);
+    TIM_CtrlPWMOutputs(TIM1, ENABLE);
+    if (!(TIM1->BDTR & TIM_BDTR_MOEN)) {
+        return ERROR;
+    }
+    foc->Enabled = true;
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets the current references.
+/// @param  foc: pointer to the FOC state.
+/// @param  id: flux current, counts.
+/// @param  iq: torque current, counts.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Foc_SetCurrent(Foc_TypeDef* foc, s16 id, s16 iq)
+{
+    DRV_ENTER_CRITICAL();
+    foc->IdRef = id;
+    foc->IqRef = iq;
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets the rotor angle, e.g. from an encoder or an observer, and
+///         the step added every period until the next call.
+/// @param  foc: pointer to the FOC state.
+/// @param  angle: electrical angle, FOC_ANGLE_TURN per turn.
+/// @param  step: angle per period, 0 for a sensored drive.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Foc_SetAngle(Foc_TypeDef* foc, u16 angle, s16 step)
+{
+    DRV_ENTER_CRITICAL();
+    foc->Angle     = angle;
+    foc->AngleStep = step;
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the sine and cosine of an angle from the quarter-wave
+///         table, interpolated: the error stays below 2 LSB.
+/// @param  angle: FOC_ANGLE_TURN per turn.
+/// @param  sin_out: sine, Q15.
+/// @param  cos_out: cosine, Q15.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Foc_SinCos(u16 angle, s16* sin_out, s16* cos_out)
+{
+    *sin_out = Foc_Sine(angle);
+    *cos_out = Foc_Sine((u16)(angle + 0x4000));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs one control period. Call it from the AdcInject callback.
+/// @param  foc: pointer to the FOC state.
+/// @param  samples: phase A and B currents, counts.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Foc_Run(Foc_TypeDef* foc, const s16* samples)
+{
+    s32 alpha, beta, d, q, va, vb, vc, max, min, offset, duty;
+    s16 s, c;
+    u32 i;
+    s32 v[3];
+
+    // Clarke, with Ic = -Ia - Ib.
+    alpha = samples[0];
+    beta  = ((samples[0] + 2 * samples[1]) * FOC_ONE_OVER_SQRT3) >> 15;
+
+    // Park.
+    Foc_SinCos(foc->Angle, &s, &c);
+    foc->Angle = (u16)(foc->Angle + foc->AngleStep);
+    d          = (alpha * c + beta * s) >> 15;
+    q          = (beta * c - alpha * s) >> 15;
+    foc->Id    = (s16)d;
+    foc->Iq    = (s16)q;
+    foc->Count++;
+
+    if (!foc->Enabled) {
+        return;
+    }
+    if (!(TIM1->BDTR & TIM_BDTR_MOEN)) {
+        // The break input has switched the bridge off.
+        foc->Enabled = false;
+        foc->Faults++;
+        return;
+    }
+
+    // Current loops, then the voltage circle.
+    foc->Vd = Foc_PI(&foc->PiD, foc->IdRef - d, foc->Limit);
+    foc->Vq = Foc_PI(&foc->PiQ, foc->IqRef - q, foc->Limit);
+    Foc_Circle(foc);
+
+    // Inverse Park.
+    alpha = (foc->Vd * c - foc->Vq * s) >> 15;
+    beta  = (foc->Vd * s + foc->Vq * c) >> 15;
+
+    // Phase voltages, centred between the highest and the lowest.
+    va     = alpha;
+    vb     = ((beta * FOC_SQRT3_OVER_TWO) >> 15) - (alpha >> 1);
+    vc     = -va - vb;
+    max    = (va > vb) ? va : vb;
+    max    = (vc > max) ? vc : max;
+    min    = (va < vb) ? va : vb;
+    min    = (vc < min) ? vc : min;
+    offset = (max + min) >> 1;
+    v[0]   = va;
+    v[1]   = vb;
+    v[2]   = vc;
+    for (i = 0; i < 3; i++) {
+        duty = (foc->Period >> 1) + (((v[i] - offset) * foc->Gain) >> 15);
+        if (duty < 0) {
+            duty = 0;
+        }
+        else if (duty > foc->Period) {
+            duty = foc->Period;
+        }
+        foc->Duty[i] = (u16)duty;
+    }
+    TIM1->CCR1 = foc->Duty[0];
+    TIM1->CCR2 = foc->Duty[1];
+    TIM1->CCR3 = foc->Duty[2];
+}
+
+/// @}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     foc.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE
+///           FIELD-ORIENTED MOTOR CONTROL SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __FOC_H
+#define __FOC_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup FOC
+/// @brief Field-oriented motor control service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup FOC_Exported_Constants
+/// @{
+
+#define FOC_GAIN_SHIFT              (12U)                                       ///< PI gains are Q12, volts per current count
+#define FOC_ANGLE_TURN              (0x10000U)                                  ///< Electrical angle units per turn
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup FOC_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  FOC init structure definition. The six TIM1 CH1..CH3/CH1N..CH3N
+///         pins and the break pin are left to the caller. Voltages are Q15 of
+///         Vbus / sqrt(3), the largest undistorted phase amplitude; currents
+///         are signed 12-bit ADC counts.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             PwmHz;                                      ///< Center-aligned PWM and loop rate
+    u16                             DeadTimeNs;                                 ///< Up to 1008 timer clocks
+    bool                            Break;                                      ///< Enable the break input
+    TIMBKP_Typedef                  BreakPolarity;
+    u16                             Kp;                                         ///< Q12, shared by both current loops
+    u16                             Ki;                                         ///< Q12 per period
+    s16                             Limit;                                      ///< Radius of the (Vd, Vq) circle, Q15
+} Foc_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  PI controller state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u16                             Kp;
+    u16                             Ki;
+    s32                             Integral;                                   ///< Q12, clamped to the output range
+} Foc_PITypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  FOC state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u16                             Period;                                     ///< TIM1 ARR
+    u16                             Gain;                                       ///< Period / sqrt(3), Q15 volts to ticks
+    s16                             Limit;
+    volatile bool                   Enabled;
+    u16                             Angle;                                      ///< Electrical, FOC_ANGLE_TURN per turn
+    s16                             AngleStep;                                  ///< Added each period, for open loop
+    s16                             IdRef;
+    s16                             IqRef;
+    Foc_PITypeDef                   PiD;
+    Foc_PITypeDef                   PiQ;
+    s16                             Id;                                         ///< Latest measured currents
+    s16                             Iq;
+    s16                             Vd;                                         ///< Latest voltage commands, Q15
+    s16                             Vq;
+    u16                             Duty[3];                                    ///< Latest compares, phase order
+    u32                             Count;                                      ///< Periods run
+    u32                             Faults;                                     ///< Break events seen
+} Foc_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup FOC_Exported_Functions
+/// @{
+
+void Foc_StructInit(Foc_InitTypeDef* init_struct);
+ErrorStatus Foc_Init(Foc_TypeDef* foc, const Foc_InitTypeDef* init_struct);
+ErrorStatus Foc_Enable(Foc_TypeDef* foc, FunctionalState state);
+void Foc_SetCurrent(Foc_TypeDef* foc, s16 id, s16 iq);
+void Foc_SetAngle(Foc_TypeDef* foc, u16 angle, s16 step);
+void Foc_SinCos(u16 angle, s16* sin_out, s16* cos_out);
+void Foc_Run(Foc_TypeDef* foc, const s16* samples);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __FOC_H
+////////////////////////////////////////////////////////////////////////////////
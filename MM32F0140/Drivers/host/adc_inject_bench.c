@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_inject_bench.c
+/// @brief    HOST BUILD ONLY: TRIGGER-TO-CALLBACK LATENCY OF THE INJECTED
+///           PHASE-CURRENT SERVICE AT A 20 KHZ PWM.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Build and run from the MM32F0140 folder:
+///   gcc -O2 -std=gnu99 -w -IDrivers/host -IDrivers -ISTARTUP/core
+///       -ISTARTUP/Include -IHAL_Lib/Inc Drivers/host/adc_inject_bench.c
+///       Drivers/host/host.c Drivers/adc_inject.c Drivers/drv_common.c
+///       HAL_Lib/Src/*.c -o adc_inject_bench
+///   ./adc_inject_bench
+///
+/// TIM1 runs center-aligned at 72 MHz with ARR = 1800, i.e. a 20 kHz PWM.
+/// Three phase currents are sampled with the defaults (ADC clock 12 MHz,
+/// 7.5 cycles sampling). For every PWM period the model places the CC4
+/// trigger, adds the conversion time, the exception entry, the handler up to
+/// its TIM1 read and a pseudo-random delay for a lower-priority handler
+/// finishing its current instruction or a tail-chained exception. It then
+/// sets CNT and DIR to where the counter is at that instant, raises JEOS and
+/// runs AdcInject_IRQHandler. The driver's own latency figures must match
+/// the model tick for tick, including once the valley has been passed.
+///
+/// One second of PWM periods is replayed per trigger position. The worst
+/// latency follows from the model's own constants, so it is reported as a
+/// share of the PWM period for reference, not checked.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_INJECT_BENCH_C_
+
+// Files includes
+#include "host.h"
+#include "adc_inject.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+#define BENCH_CORE_HZ               (72000000U)                                 ///< Core, PCLK2 and TIM1
+#define BENCH_PWM_HZ                (20000U)
+#define BENCH_ARR                   (BENCH_CORE_HZ / BENCH_PWM_HZ / 2)
+#define BENCH_CHANNELS              (3U)
+#define BENCH_ADC_PRESCALER         (6U)                                        ///< ADC_PCLK2_PRESCARE_6
+#define BENCH_ADC_CYCLES_X2         (40U)                                       ///< 2 * (7.5 sampling + 12.5 conversion)
+#define BENCH_ADC_SYNC              (2U)                                        ///< ADC clocks from trigger to sampling
+#define BENCH_M0_CYCLES_ENTRY       (16U)                                       ///< Exception entry, zero wait states
+#define BENCH_M0_CYCLES_READ        (30U)                                       ///< SREXT test and clear, 3 JDR reads, CNT read
+#define BENCH_M0_CYCLES_BLOCK       (64U)                                       ///< Worst extra delay before entry
+
+static AdcInject_TypeDef inj;
+static u32 calls;
+static u32 wrong;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sample hook: checks the signed currents the model put in JDR.
+/// @param  s: pointer to the service state.
+/// @param  samples: phase currents.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Callback(AdcInject_TypeDef* s, const s16* samples)
+{
+    (void)s;
+    if ((samples[0] != -100) || (samples[1] != 0) || (samples[2] != 2047)) {
+        wrong++;
+    }
+    calls++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs the core at 72 MHz from the PLL, all buses undivided, so
+///         DRV_TimerClock reads what the target would.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Clock(void)
+{
+    RCC->PLLCFGR = (u32)(BENCH_CORE_HZ / HSI_VALUE_PLL_ON - 1) << RCC_PLLCFGR_PLL_DN_Pos;
+    RCC->CFGR    = RCC_CFGR_SWS_PLL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Replays one second of PWM periods for one trigger position.
+/// @param  delay: TriggerDelay, TIM1 ticks after the counter peak.
+/// @param  worst: receives the modeled worst latency in ticks.
+/// @retval Number of periods whose latency the driver got wrong.
+////////////////////////////////////////////////////////////////////////////////
+static u32 Bench_Run(u16 delay, u32* worst)
+{
+    static const u8 channels[BENCH_CHANNELS] = {ADC_Channel_0, ADC_Channel_1, ADC_Channel_2};
+    const u32 conversion = (BENCH_CHANNELS * BENCH_ADC_CYCLES_X2 / 2 + BENCH_ADC_SYNC) * BENCH_ADC_PRESCALER;
+    AdcInject_InitTypeDef init;
+    u32 period, ticks, seed = 1, mismatches = 0;
+
+    AdcInject_StructInit(&init);
+    init.Channels     = channels;
+    init.ChannelCount = BENCH_CHANNELS;
+    init.Offset[0]    = 2048;
+    init.Offset[1]    = 2050;
+    init.Offset[2]    = 2046;
+    init.TriggerDelay = delay;
+    init.Callback     = Bench_Callback;
+    Host_Check(AdcInject_Init(&inj, &init) == SUCCESS, "init");
+    Host_Check((ADC1->JOFR[0] == 2048) && (ADC1->JOFR[1] == 2050) && (ADC1->JOFR[2] == 2046),
+               "offsets programmed in hardware");
+    Host_Check(TIM1->CCR4 == BENCH_ARR - delay, "CC4 placed after the peak");
+
+    *worst = 0;
+    for (period = 0; period < BENCH_PWM_HZ; period++) {
+        seed  = seed * 1103515245U + 12345U;
+        ticks = conversion + BENCH_M0_CYCLES_ENTRY + BENCH_M0_CYCLES_READ + (seed >> 16) % (BENCH_M0_CYCLES_BLOCK + 1);
+        *worst = (ticks > *worst) ? ticks : *worst;
+
+        // Where the counter is when the handler reads it.
+        if (ticks <= inj.Compare) {
+            TIM1->CNT = inj.Compare - ticks;
+            TIM1->CR1 = TIM_CR1_DIR | TIM_CR1_CMS_CENTERALIGNED1 | TIM_CR1_CEN;
+        }
+        else {
+            TIM1->CNT = ticks - inj.Compare;
+            TIM1->CR1 = TIM_CR1_CMS_CENTERALIGNED1 | TIM_CR1_CEN;
+        }
+        ADC1->JDR[0] = (u16)-100;
+        ADC1->JDR[1] = 0;
+        ADC1->JDR[2] = 2047;
+        ADC1->SREXT  = ADC_SREXT_JEOSIF | ADC_SREXT_JEOCIF;
+        AdcInject_IRQHandler(&inj);
+        if (inj.LatencyLast != ticks) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Benchmark entry point.
+/// @param  None.
+/// @retval 0 if every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+    static const u16 delays[] = {1, BENCH_ARR - 200};
+    const u32 period_ns = 1000000000U / BENCH_PWM_HZ;
+    u32 worst, worst_ns, i;
+
+    Host_Init();
+    Bench_Clock();
+    TIM1->ARR = BENCH_ARR;
+    TIM1->PSC = 0;
+
+    printf("TIM1 %u MHz center-aligned, ARR %u (%u Hz PWM), %u phases\n", BENCH_CORE_HZ / 1000000, BENCH_ARR,
+           BENCH_PWM_HZ, BENCH_CHANNELS);
+    for (i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        calls = 0;
+        wrong = 0;
+        Host_Check(Bench_Run(delays[i], &worst) == 0, "measured latency matches the trigger instant");
+        worst_ns = AdcInject_GetLatencyNs(&inj, true);
+
+        printf("  trigger %4u ticks after the peak: latency last %u ns, worst %u ns (%u ticks), %u%% of the period\n",
+               delays[i], (unsigned)AdcInject_GetLatencyNs(&inj, false), (unsigned)worst_ns, (unsigned)inj.LatencyMax,
+               (unsigned)(worst_ns * 100 / period_ns));
+
+        Host_Check(inj.LatencyMax == worst, "worst latency recorded");
+        Host_Check(worst_ns == (u32)((u64)worst * 1000000000 / BENCH_CORE_HZ), "latency converted at the TIM1 clock");
+        Host_Check((calls == BENCH_PWM_HZ) && (inj.Count == BENCH_PWM_HZ) && (wrong == 0),
+                   "one callback per period with the signed samples");
+    }
+    return Host_Result();
+}
+
+/// @}
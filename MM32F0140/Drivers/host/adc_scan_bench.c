@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     adc_scan_bench.c
+/// @brief    HOST BUILD ONLY: CPU BUDGET OF THE ADC SCAN ENGINE FOR A
+///           12-CHANNEL MONITOR AT 100 KS/S AGGREGATE.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Build and run from the MM32F0140 folder:
+///   gcc -O2 -std=gnu99 -w -IDrivers/host -IDrivers -ISTARTUP/core
+///       -ISTARTUP/Include -IHAL_Lib/Inc Drivers/host/adc_scan_bench.c
+///       Drivers/host/host.c Drivers/adc_scan.c Drivers/drv_common.c
+///       HAL_Lib/Src/*.c -o adc_scan_bench
+///   ./adc_scan_bench
+///
+/// The engine runs with its defaults (PCLK2 / 16, 29.5 cycles sampling,
+/// averaging over 16 scans) on 12 channels, 32 scans per half buffer. Each
+/// half the "DMA" completes is filled with a ramp per channel and the half or
+/// full transfer interrupt is raised; BENCH_SECONDS of acquisition at
+/// 100 kS/s are replayed. Every published result must equal the mean of its
+/// 16 scans.
+///
+/// The CPU cost is counted, not timed on the host: each interrupt the bench
+/// raised, and each per-channel pass, sample and published value the
+/// engine reports in Chunks, Samples and Results, is charged its Cortex-M0
+/// cycle count. The total is compared with the 5 % budget at 72 MHz. Host
+/// time is printed for reference only.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _ADC_SCAN_BENCH_C_
+
+// Files includes
+#include "host.h"
+#include "adc_scan.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+#define BENCH_CHANNELS              (12U)
+#define BENCH_FRAMES                (32U)                                       ///< Scans per half buffer
+#define BENCH_OVERSAMPLE            (4U)
+#define BENCH_RATE                  (100000U)                                   ///< Aggregate samples per second
+#define BENCH_SECONDS               (10U)
+#define BENCH_CORE_HZ               (72000000U)                                 ///< Core and PCLK2
+#define BENCH_ADC_CYCLES_X2         (84U)                                       ///< 2 * (29.5 sampling + 12.5 conversion)
+#define BENCH_M0_CYCLES_IRQ         (100U)                                      ///< Entry, exit, flag handling
+#define BENCH_M0_CYCLES_PASS        (14U)                                       ///< Per channel and chunk: loop setup, Acc update
+#define BENCH_M0_CYCLES_SAMPLE      (8U)                                        ///< LDRH, ADDS, ADDS, SUBS, taken BNE
+#define BENCH_M0_CYCLES_PUBLISH     (10U)                                       ///< Per channel and result: shift, store, clear
+#define BENCH_BUDGET_PERCENT        (5U)
+
+static AdcScan_TypeDef scan;
+static u16 buffer[2 * BENCH_FRAMES * BENCH_CHANNELS];
+static u32 published;
+static u32 wrong;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  New-results hook, once per interrupt that completed a result set:
+///         checks every channel against the ramp mean.
+/// @param  s: pointer to the scan state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Callback(AdcScan_TypeDef* s)
+{
+    u16 mean = (u16)((1U << BENCH_OVERSAMPLE) - 1) / 2;
+    u8  ch;
+
+    for (ch = 0; ch < BENCH_CHANNELS; ch++) {
+        if (AdcScan_GetValue(s, ch) != ch * 256 + mean) {
+            wrong++;
+        }
+    }
+    published++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Writes one half buffer as the DMA would: channel ch of scan f
+///         reads ch * 256 + f mod 2^Oversample.
+/// @param  half: first halfword of the half.
+/// @param  first: global index of the first scan.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Fill(u16* half, u32 first)
+{
+    u32 f, ch;
+
+    for (f = 0; f < BENCH_FRAMES; f++) {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++) {
+            half[f * BENCH_CHANNELS + ch] = (u16)(ch * 256 + ((first + f) & ((1U << BENCH_OVERSAMPLE) - 1)));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Benchmark entry point.
+/// @param  None.
+/// @retval 0 if every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+    static const u8 channels[BENCH_CHANNELS] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    const u32 half_items = BENCH_FRAMES * BENCH_CHANNELS;
+    const u32 halves     = BENCH_RATE * BENCH_SECONDS / half_items;
+    AdcScan_InitTypeDef init;
+    u32 i, adc_rate, results, irqs = 0;
+    u64 t0, cycles = 0, m0;
+    double percent;
+
+    Host_Init();
+    AdcScan_StructInit(&init);
+    init.Channels     = channels;
+    init.ChannelCount = BENCH_CHANNELS;
+    init.Oversample   = BENCH_OVERSAMPLE;
+    init.Buffer       = buffer;
+    init.Frames       = BENCH_FRAMES;
+    init.Callback     = Bench_Callback;
+    Host_Check(AdcScan_Init(&scan, &init) == SUCCESS, "init");
+    AdcScan_Start(&scan);
+
+    for (i = 0; i < halves; i++) {
+        Bench_Fill(buffer + (i & 1) * half_items, i * BENCH_FRAMES);
+        DMA1_Channel1->CNDTR = (i & 1) ? half_items * 2 : half_items;
+        DMA1->ISR = DMA_CHANNEL_FLAGS(DMA1_Channel1, DMAx_FLAG_GLy | ((i & 1) ? DMAx_FLAG_TCy : DMAx_FLAG_HTy));
+        t0 = Host_Cycles();
+        AdcScan_DMAIRQHandler(&scan);
+        cycles += Host_Cycles() - t0;
+        irqs++;
+    }
+    AdcScan_Stop(&scan);
+
+    results  = scan.Results;
+    m0       = (u64)irqs * BENCH_M0_CYCLES_IRQ + (u64)scan.Chunks * BENCH_CHANNELS * BENCH_M0_CYCLES_PASS +
+               (u64)scan.Samples * BENCH_M0_CYCLES_SAMPLE + (u64)results * BENCH_CHANNELS * BENCH_M0_CYCLES_PUBLISH;
+    percent  = (double)m0 * 100.0 / BENCH_SECONDS / BENCH_CORE_HZ;
+    adc_rate = BENCH_CORE_HZ / 16 * 2 / BENCH_ADC_CYCLES_X2;
+
+    printf("%u channels, %u scans per half, averaging over %u, %u S/s aggregate for %u s\n", BENCH_CHANNELS,
+           BENCH_FRAMES, 1U << BENCH_OVERSAMPLE, BENCH_RATE, BENCH_SECONDS);
+    printf("  ADC at PCLK2 / 16 converts %u S/s\n", (unsigned)adc_rate);
+    printf("  %u interrupts/s, %u accumulation passes/s, %u result sets/s\n", (unsigned)(irqs / BENCH_SECONDS),
+           (unsigned)(scan.Chunks / BENCH_SECONDS), (unsigned)(results / BENCH_SECONDS));
+    printf("  Cortex-M0 at %u MHz: %.2f %% of the core (budget %u %%)\n", BENCH_CORE_HZ / 1000000, percent,
+           BENCH_BUDGET_PERCENT);
+    printf("  host: %.2f cycles per sample\n", (double)cycles / ((double)halves * half_items));
+
+    Host_Check(adc_rate >= BENCH_RATE, "ADC keeps up with the aggregate rate");
+    Host_Check(results == halves * BENCH_FRAMES >> BENCH_OVERSAMPLE, "one result set per 16 scans");
+    Host_Check(scan.Samples == halves * half_items, "every sample accumulated once");
+    Host_Check((scan.Chunks >= results) && (scan.Chunks <= halves + results),
+               "chunks end at half boundaries and results only");
+    Host_Check((published == halves) && (wrong == 0), "every result is the mean of its scans");
+    Host_Check((scan.Late == 0) && (scan.Errors == 0), "no missed halves");
+    Host_Check(AdcScan_GetValue(&scan, 12) == ADC_SCAN_NO_VALUE, "unscanned channel has no value");
+    Host_Check(percent < BENCH_BUDGET_PERCENT, "within the CPU budget");
+    return Host_Result();
+}
+
+/// @}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     core_cm0.h
+/// @brief    HOST BUILD ONLY: WRAPS THE CMSIS CORE HEADER SO THE DRIVERS AND
+///           THE HAL COMPILE NATIVELY ON LINUX.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Found ahead of STARTUP/core through -IDrivers/host. The register and HAL
+/// headers are used unchanged; only the intrinsics that are Cortex-M0
+/// instructions are renamed away and replaced here. PRIMASK is a variable,
+/// and clearing it runs Host_IRQHook, so a model's "interrupts" fire at the
+/// end of a critical section as pending IRQs do on the target.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __HOST_CORE_CM0_H
+#define __HOST_CORE_CM0_H
+
+#define __enable_irq                __arm_enable_irq
+#define __disable_irq               __arm_disable_irq
+#define __get_PRIMASK               __arm_get_PRIMASK
+#define __set_PRIMASK               __arm_set_PRIMASK
+#define __ISB                       __arm_ISB
+#define __DSB                       __arm_DSB
+#define __DMB                       __arm_DMB
+
+#include_next <core_cm0.h>
+
+#undef __enable_irq
+#undef __disable_irq
+#undef __get_PRIMASK
+#undef __set_PRIMASK
+#undef __ISB
+#undef __DSB
+#undef __DMB
+#undef __NOP
+#undef __WFI
+#undef __WFE
+#undef __SEV
+
+extern volatile uint32_t Host_PRIMASK;
+extern void (*Host_IRQHook)(void);
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return Host_PRIMASK;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    Host_PRIMASK = primask & 1U;
+    if ((Host_PRIMASK == 0) && (Host_IRQHook != 0)) {
+        Host_IRQHook();
+    }
+}
+
+static inline void __disable_irq(void)
+{
+    Host_PRIMASK = 1;
+}
+
+static inline void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+#define __ISB()                     __sync_synchronize()
+#define __DSB()                     __sync_synchronize()
+#define __DMB()                     __sync_synchronize()
+#define __NOP()                     ((void)0)
+#define __WFI()                     ((void)0)
+#define __WFE()                     ((void)0)
+#define __SEV()                     ((void)0)
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __HOST_CORE_CM0_H
+////////////////////////////////////////////////////////////////////////////////
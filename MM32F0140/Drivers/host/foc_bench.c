@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     foc_bench.c
+/// @brief    HOST BUILD ONLY: ACCURACY, VOLTAGE LIMIT AND CYCLE BUDGET OF THE
+///           FIELD-ORIENTED CONTROL LOOP AT A 20 KHZ PWM.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Build and run from the MM32F0140 folder:
+///   gcc -O2 -std=gnu99 -w -IDrivers/host -IDrivers -ISTARTUP/core
+///       -ISTARTUP/Include -IHAL_Lib/Inc Drivers/host/foc_bench.c
+///       Drivers/host/host.c Drivers/foc.c Drivers/drv_common.c
+///       HAL_Lib/Src/*.c -lm -Wl,--wrap=DRV_Sqrt -o foc_bench
+///   ./foc_bench
+///
+/// TIM1 runs at 72 MHz with the default 20 kHz PWM, and one second of
+/// periods drives Foc_Run through a sensored trajectory: the rotor speeds
+/// up to 250 Hz electrical while the torque current is held, its back-EMF
+/// pushes the q voltage into the limit, and for the last quarter a negative
+/// d current is asked for on top. The motor is a first-order model per
+/// axis; the phase currents it returns go through the inverse Clarke and
+/// Park transforms in double precision.
+///
+/// Every period is checked against double-precision references: Id and Iq
+/// from the samples, the three compares from the loop's Vd and Vq, and the
+/// voltage vector and the q integral against the circle of radius Limit.
+///
+/// The cycle budget is counted, not timed on the host: every period is
+/// charged the Cortex-M0 cost of the fixed stages, and every square root
+/// the circle limit takes is charged by the iterations DRV_Sqrt runs for
+/// its radicand, seen through the linker's --wrap. The typical and worst
+/// periods of the run are the figures documented in foc.c. Host time is
+/// printed for reference only.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _FOC_BENCH_C_
+
+// Files includes
+#include <math.h>
+#include <stdlib.h>
+#include "host.h"
+#include "foc.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+#define BENCH_CORE_HZ               (72000000U)                                 ///< Core, PCLK2 and TIM1
+#define BENCH_PWM_HZ                (20000U)
+#define BENCH_LIMIT                 (30000)                                     ///< Voltage circle radius, Q15
+#define BENCH_IQ                    (1000)                                      ///< Torque current, counts
+#define BENCH_ID                    (-800)                                      ///< Flux current of the last quarter
+#define BENCH_TOP_HZ                (250.0)                                     ///< Electrical speed at the end of the ramp
+#define BENCH_AMPS_PER_VOLT         (2000.0 / 32768)                            ///< Steady current per Q15 volt
+#define BENCH_EMF_AT_TOP            (2500.0)                                    ///< Back-EMF at the top speed, current counts
+#define BENCH_TAU                   (20.0)                                      ///< Electrical time constant, periods
+#define BENCH_M0_CYCLES_SINCOS      (45U)                                       ///< Two interpolated lookups
+#define BENCH_M0_CYCLES_PARK        (30U)                                       ///< Clarke and Park
+#define BENCH_M0_CYCLES_PI          (60U)                                       ///< Two PI loops with clamping
+#define BENCH_M0_CYCLES_CIRCLE      (20U)                                       ///< Two absolutes, two MULS, compares
+#define BENCH_M0_CYCLES_SVPWM       (60U)                                       ///< Inverse Park and SVPWM
+#define BENCH_M0_CYCLES_ENTRY       (45U)                                       ///< Call, break check, compare writes
+#define BENCH_M0_CYCLES_CLAMP       (30U)                                       ///< DRV_Sqrt call and setup, Vq and integral clamps
+#define BENCH_M0_CYCLES_SCAN        (8U)                                        ///< DRV_Sqrt start bit search, u64 compare and shift
+#define BENCH_M0_CYCLES_STEP        (20U)                                       ///< DRV_Sqrt digit, u64 compare, add, subtract, shifts
+#define BENCH_FLASH_PERCENT         (150U)                                      ///< Two flash wait states at 72 MHz
+
+static Foc_TypeDef foc;
+static u32 roots;
+static u64 root_cycles;
+
+u32 __real_DRV_Sqrt(u64 x);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stands in for DRV_Sqrt while foc.c is linked with --wrap: counts
+///         the start bit search and digit iterations the real routine runs
+///         for this radicand and charges them.
+/// @param  x: radicand.
+/// @retval floor(sqrt(x)).
+////////////////////////////////////////////////////////////////////////////////
+u32 __wrap_DRV_Sqrt(u64 x)
+{
+    u64 bit = (u64)1 << 62;
+    u32 scan = 0, step = 0;
+
+    while (bit > x) {
+        bit >>= 2;
+        scan++;
+    }
+    for (; bit != 0; bit >>= 2) {
+        step++;
+    }
+    roots++;
+    root_cycles += BENCH_M0_CYCLES_CLAMP + scan * BENCH_M0_CYCLES_SCAN + step * BENCH_M0_CYCLES_STEP;
+    return __real_DRV_Sqrt(x);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs the core at 72 MHz from the PLL, all buses undivided, so
+///         DRV_TimerClock reads what the target would.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Clock(void)
+{
+    RCC->PLLCFGR = (u32)(BENCH_CORE_HZ / HSI_VALUE_PLL_ON - 1) << RCC_PLLCFGR_PLL_DN_Pos;
+    RCC->CFGR    = RCC_CFGR_SWS_PLL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Computes the compares the loop should write for a voltage
+///         vector, in double precision.
+/// @param  vd: flux voltage, Q15.
+/// @param  vq: torque voltage, Q15.
+/// @param  theta: electrical angle, radians.
+/// @param  duty: receives the three compares.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Svpwm(double vd, double vq, double theta, double* duty)
+{
+    double alpha = vd * cos(theta) - vq * sin(theta);
+    double beta  = vd * sin(theta) + vq * cos(theta);
+    double v[3], max, min, gain = foc.Period / sqrt(3.0) / 32768;
+    u32 i;
+
+    v[0] = alpha;
+    v[1] = -alpha / 2 + beta * sqrt(3.0) / 2;
+    v[2] = -v[0] - v[1];
+    max  = fmax(v[0], fmax(v[1], v[2]));
+    min  = fmin(v[0], fmin(v[1], v[2]));
+    for (i = 0; i < 3; i++) {
+        duty[i] = foc.Period / 2.0 + (v[i] - (max + min) / 2) * gain;
+        duty[i] = fmin(fmax(duty[i], 0), foc.Period);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Benchmark entry point.
+/// @param  None.
+/// @retval 0 if every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+    Foc_InitTypeDef init;
+    double id = 0, iq = 0, theta = 0, speed, ref[3], worst_park = 0, worst_duty = 0, over = 0;
+    u32 period, i, saturated = 0, unsaturated_roots = 0, last_roots, typical = 0, worst = 0, cycles;
+    u64 t0, host = 0, total = 0;
+    s16 samples[2];
+    u16 angle;
+
+    Host_Init();
+    Bench_Clock();
+    Foc_StructInit(&init);
+    init.Limit = BENCH_LIMIT;
+    Host_Check(Foc_Init(&foc, &init) == SUCCESS, "init");
+    Host_Check(Foc_Enable(&foc, ENABLE) == SUCCESS, "bridge enabled");
+    Foc_SetCurrent(&foc, 0, BENCH_IQ);
+
+    for (period = 0; period < BENCH_PWM_HZ; period++) {
+        if (period == BENCH_PWM_HZ * 3 / 4) {
+            Foc_SetCurrent(&foc, BENCH_ID, BENCH_IQ);
+        }
+        speed = (period < BENCH_PWM_HZ / 2) ? (double)period / (BENCH_PWM_HZ / 2) : 1.0;
+        angle = (u16)lround(theta * FOC_ANGLE_TURN / (2 * M_PI));
+        theta = angle * 2 * M_PI / FOC_ANGLE_TURN;
+        Foc_SetAngle(&foc, angle, 0);
+
+        // Inverse Park and Clarke of the model currents.
+        samples[0] = (s16)lround(id * cos(theta) - iq * sin(theta));
+        samples[1] = (s16)lround(id * cos(theta - 2 * M_PI / 3) - iq * sin(theta - 2 * M_PI / 3));
+
+        last_roots = roots;
+        t0 = Host_Cycles();
+        Foc_Run(&foc, samples);
+        host += Host_Cycles() - t0;
+
+        // Park of the rounded samples, in double precision.
+        {
+            double alpha = samples[0];
+            double beta  = (samples[0] + 2.0 * samples[1]) / sqrt(3.0);
+            double d     = alpha * cos(theta) + beta * sin(theta);
+            double q     = beta * cos(theta) - alpha * sin(theta);
+
+            worst_park = fmax(worst_park, fmax(fabs(foc.Id - d), fabs(foc.Iq - q)));
+        }
+
+        Bench_Svpwm(foc.Vd, foc.Vq, theta, ref);
+        for (i = 0; i < 3; i++) {
+            worst_duty = fmax(worst_duty, fabs(foc.Duty[i] - ref[i]));
+        }
+        Host_Check((TIM1->CCR1 == foc.Duty[0]) && (TIM1->CCR2 == foc.Duty[1]) && (TIM1->CCR3 == foc.Duty[2]),
+                   "compares written");
+
+        // Circle of radius Limit, for the vector and the q integral.
+        {
+            double room = sqrt((double)BENCH_LIMIT * BENCH_LIMIT - (double)foc.Vd * foc.Vd);
+
+            over = fmax(over, hypot(foc.Vd, foc.Vq) - BENCH_LIMIT);
+            over = fmax(over, fabs((double)foc.PiQ.Integral / (1 << FOC_GAIN_SHIFT)) - room);
+            if (fabs(foc.Vq) >= floor(room)) {
+                saturated++;
+            }
+            else if ((roots != last_roots) && (fabs(foc.PiQ.Integral) < floor(room) * (1 << FOC_GAIN_SHIFT))) {
+                unsaturated_roots++;
+            }
+        }
+
+        cycles = BENCH_M0_CYCLES_ENTRY + BENCH_M0_CYCLES_SINCOS + BENCH_M0_CYCLES_PARK + BENCH_M0_CYCLES_PI +
+                 BENCH_M0_CYCLES_CIRCLE + BENCH_M0_CYCLES_SVPWM;
+        if (roots == last_roots) {
+            typical = cycles;
+        }
+        else {
+            cycles += (u32)root_cycles;
+        }
+        root_cycles = 0;
+        worst  = (cycles > worst) ? cycles : worst;
+        total += cycles;
+
+        // Motor: first order per axis, back-EMF on q.
+        id    += (foc.Vd * BENCH_AMPS_PER_VOLT - id) / BENCH_TAU;
+        iq    += (foc.Vq * BENCH_AMPS_PER_VOLT - speed * BENCH_EMF_AT_TOP - iq) / BENCH_TAU;
+        theta += 2 * M_PI * speed * BENCH_TOP_HZ / BENCH_PWM_HZ;
+        theta  = fmod(theta, 2 * M_PI);
+    }
+
+    printf("%u periods at %u Hz PWM (ARR %u), Limit %d, up to %.0f Hz electrical\n", BENCH_PWM_HZ, BENCH_PWM_HZ,
+           foc.Period, BENCH_LIMIT, BENCH_TOP_HZ);
+    printf("  Park error %.2f counts, compare error %.2f ticks, %.3f outside the circle\n", worst_park, worst_duty,
+           fmax(over, 0));
+    printf("  %u periods on the voltage circle, %u square roots\n", (unsigned)saturated, (unsigned)roots);
+    printf("  Cortex-M0 cycles: typical %u, mean %u, worst %u\n", (unsigned)typical,
+           (unsigned)(total / BENCH_PWM_HZ), (unsigned)worst);
+    printf("  with flash wait states: typical %u (%.1f us, %.1f %%), worst %u (%.1f us, %.1f %%)\n",
+           typical * BENCH_FLASH_PERCENT / 100, typical * BENCH_FLASH_PERCENT / 100 * 1e6 / BENCH_CORE_HZ,
+           typical * BENCH_FLASH_PERCENT / 100 * 100.0 * BENCH_PWM_HZ / BENCH_CORE_HZ,
+           worst * BENCH_FLASH_PERCENT / 100, worst * BENCH_FLASH_PERCENT / 100 * 1e6 / BENCH_CORE_HZ,
+           worst * BENCH_FLASH_PERCENT / 100 * 100.0 * BENCH_PWM_HZ / BENCH_CORE_HZ);
+    printf("  host: %.1f cycles per period\n", (double)host / BENCH_PWM_HZ);
+
+    Host_Check(foc.Count == BENCH_PWM_HZ, "one loop per period");
+    Host_Check(worst_park <= 3.0, "Clarke and Park within 3 counts");
+    Host_Check(worst_duty <= 2.0, "compares within 2 ticks of SVPWM");
+    Host_Check(over <= 0.0, "voltage vector and q integral inside the circle");
+    Host_Check((saturated > 0) && (roots > 0), "trajectory reaches the voltage limit");
+    Host_Check(unsaturated_roots == 0, "no square root inside the circle");
+    Host_Check((foc.Vd < 0) && (abs(foc.Id - BENCH_ID) < 50), "d current held with priority on the limit");
+    return Host_Result();
+}
+
+/// @}
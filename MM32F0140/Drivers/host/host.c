@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     host.c
+/// @brief    HOST BUILD ONLY: MAPS THE PERIPHERAL ADDRESS SPACE AS PLAIN
+///           MEMORY AND PROVIDES CYCLE TIMING AND RESULT REPORTING.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The register blocks are mapped at their target addresses, so the drivers
+/// and the HAL run unchanged and every pointer still fits in a u32. Registers
+/// behave as RAM: status flags are whatever the model writes, and write-1-to
+/// -clear registers keep the bits the driver wrote until the model applies
+/// them.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _HOST_C_
+
+// Files includes
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "host.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE         (0x100000)
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+volatile u32 Host_PRIMASK;
+void (*Host_IRQHook)(void);
+
+static u32 host_failures;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Maps one register region at its target address.
+/// @param  base: first address.
+/// @param  size: bytes.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Host_Map(u32 base, u32 size)
+{
+    void* p = mmap((void*)(uintptr_t)base, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != (void*)(uintptr_t)base) {
+        fprintf(stderr, "host: cannot map 0x%08X\n", (unsigned)base);
+        exit(2);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Maps the APB/AHB peripherals, the GPIO ports and the system
+///         control space.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Host_Init(void)
+{
+    Host_Map(PERIPH_BASE, 0x40000);
+    Host_Map(GPIOA_BASE, 0x2000);
+    Host_Map(SCS_BASE, 0x1000);
+    Host_PRIMASK = 0;
+    Host_IRQHook = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reads the host cycle counter.
+/// @param  None.
+/// @retval TSC cycles on x86, nanoseconds elsewhere.
+////////////////////////////////////////////////////////////////////////////////
+u64 Host_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000U + (u64)ts.tv_nsec;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Records one check, printing it when it fails.
+/// @param  ok: check result.
+/// @param  what: description.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Host_Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        host_failures++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Prints the verdict.
+/// @param  None.
+/// @retval Process exit code, 0 when every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int Host_Result(void)
+{
+    printf("%s (%u failed checks)\n", host_failures ? "FAILED" : "PASSED", (unsigned)host_failures);
+    return host_failures ? 1 : 0;
+}
+
+/// @}
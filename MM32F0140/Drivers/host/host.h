@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     host.h
+/// @brief    HOST BUILD ONLY: PERIPHERAL MEMORY AND TIMING FOR THE LINUX
+///           MODELS AND BENCHMARKS IN THIS FOLDER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __HOST_H
+#define __HOST_H
+
+// Files includes
+#include <stdio.h>
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup HOST
+/// @brief Linux harness for the drivers
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup HOST_Exported_Functions
+/// @{
+
+void Host_Init(void);
+u64 Host_Cycles(void);
+void Host_Check(bool ok, const char* what);
+int Host_Result(void);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __HOST_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,623 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_nor_model.c
+/// @brief    HOST BUILD ONLY: SPI NOR FLASH MODEL RUNNING THE SPI NOR DRIVER
+///           AND THE SPI QUEUE UNCHANGED, FOR CORRECTNESS AND THROUGHPUT.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Build and run from the MM32F0140 folder:
+///   gcc -O2 -std=gnu99 -w -IDrivers/host -IDrivers -ISTARTUP/core
+///       -ISTARTUP/Include -IHAL_Lib/Inc Drivers/host/spi_nor_model.c
+///       Drivers/host/host.c Drivers/spi_nor.c Drivers/spi_queue.c
+///       Drivers/drv_common.c HAL_Lib/Src/*.c -o spi_nor_model
+///   ./spi_nor_model
+///
+/// The chip decodes the byte stream of every queue transfer (RDID, RDSFDP,
+/// FAST_READ, RDSR, WREN, PP, SE, suspend, resume, EN4B) against a RAM array
+/// with page wrap, AND-only programming and busy times. CS follows KeepCS of
+/// the completed transfers. Time is simulated: the bus runs at MODEL_SCK_HZ,
+/// WIP holds for tPP/tSE and the poll timer expires when nothing else is
+/// pending. The DMA and SPI flags are set as the hardware would, including
+/// the TXEPT flag still latched from the idle bus, and write-1-to-clear
+/// registers are applied after each handler. Protocol violations fail the
+/// run: a command while busy, PP/SE without WREN, CS released with frames
+/// still in the TX FIFO.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SPI_NOR_MODEL_C_
+
+// Files includes
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "spi_nor.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+#define MODEL_SCK_HZ                (18000000U)                                 ///< Bus clock
+#define MODEL_XFER_NS               (1000U)                                     ///< Interrupt and restart gap per transfer
+#define MODEL_TPP_NS                (700000U)                                   ///< Typical page program time
+#define MODEL_TSE_NS                (30000000U)                                 ///< Typical 4 KB erase time
+#define MODEL_TSUS_NS               (20000U)                                    ///< Suspend latency
+#define MODEL_SFDP_BFPT             (0x30U)                                     ///< BFPT offset in the SFDP space
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  NOR chip state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8*                             Mem;
+    u32                             Size;
+    u8                              Id[3];
+    bool                            HasSFDP;
+    u8                              Sfdp[MODEL_SFDP_BFPT + 16 * 4];
+    bool                            Wel;
+    bool                            Addr4;
+    u64                             BusyUntil;                                  ///< WIP holds until then
+    bool                            Erasing;                                    ///< Erase running or parked
+    bool                            Suspended;
+    u64                             Remaining;                                  ///< Erase time left when suspended
+    u8                              Op;                                         ///< Opcode of the selected command
+    u32                             Count;                                      ///< Bytes clocked since CS went low
+    u32                             Addr;
+    u8                              PageBuf[256];
+    bool                            Selected;
+} Model_ChipTypeDef;
+
+static Model_ChipTypeDef chip;
+static SpiQueue_TypeDef  queue;
+static SpiNor_TypeDef    nor;
+static u64  model_now;                                                          // Simulated time, ns
+static u64  timer_due;
+static bool model_isr;
+static u32  model_irqs;
+static u64  driver_cycles;
+static u32  done_count;
+static ErrorStatus done_status;
+static u64  done_time;
+static u32  model_violations;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Records a protocol violation.
+/// @param  what: description.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Violation(const char* what)
+{
+    printf("violation at %llu us: %s (op 0x%02X)\n", (unsigned long long)(model_now / 1000), what, chip.Op);
+    model_violations++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns whether the chip reports WIP, retiring a finished erase.
+/// @param  None.
+/// @retval true while busy.
+////////////////////////////////////////////////////////////////////////////////
+static bool Model_Busy(void)
+{
+    if (model_now < chip.BusyUntil) {
+        return true;
+    }
+    if (!chip.Suspended) {
+        chip.Erasing = false;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the SFDP header and a JESD216B basic flash parameter table.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_BuildSFDP(void)
+{
+    u32 dw[17];
+    u32 i;
+
+    memset(chip.Sfdp, 0xFF, sizeof(chip.Sfdp));
+    memcpy(chip.Sfdp, "SFDP", 4);
+    chip.Sfdp[4]  = 6;                                                          // JESD216B
+    chip.Sfdp[5]  = 1;
+    chip.Sfdp[6]  = 0;                                                          // One parameter header
+    chip.Sfdp[7]  = 0xFF;
+    chip.Sfdp[8]  = 0x00;                                                       // BFPT
+    chip.Sfdp[9]  = 6;
+    chip.Sfdp[10] = 1;
+    chip.Sfdp[11] = 16;
+    chip.Sfdp[12] = MODEL_SFDP_BFPT;
+    chip.Sfdp[13] = 0;
+    chip.Sfdp[14] = 0;
+
+    memset(dw, 0, sizeof(dw));
+    dw[1]  = 0x01U | (SPI_NOR_CMD_SE << 8);                                     // 4 KB erase, 3-byte addressing
+    dw[2]  = chip.Size * 8 - 1;
+    dw[8]  = 12U | (SPI_NOR_CMD_SE << 8);                                       // Erase type 1: 4 KB
+    dw[10] = (29U << 4) | (0U << 9);                                            // Type 1 typical 30 ms
+    dw[11] = (8U << 4) | (10U << 8) | (1U << 13);                               // 256-byte page, 704 us
+    dw[12] = 0;                                                                 // Suspend supported
+    dw[13] = ((u32)SPI_NOR_CMD_SUSPEND << 24) | ((u32)SPI_NOR_CMD_RESUME << 16);
+    for (i = 1; i <= 16; i++) {
+        chip.Sfdp[MODEL_SFDP_BFPT + (i - 1) * 4 + 0] = (u8)dw[i];
+        chip.Sfdp[MODEL_SFDP_BFPT + (i - 1) * 4 + 1] = (u8)(dw[i] >> 8);
+        chip.Sfdp[MODEL_SFDP_BFPT + (i - 1) * 4 + 2] = (u8)(dw[i] >> 16);
+        chip.Sfdp[MODEL_SFDP_BFPT + (i - 1) * 4 + 3] = (u8)(dw[i] >> 24);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Powers up a new chip.
+/// @param  id: JEDEC manufacturer, type, capacity code.
+/// @param  size: array size in bytes.
+/// @param  sfdp: true if the chip answers RDSFDP.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Chip(u32 id, u32 size, bool sfdp)
+{
+    free(chip.Mem);
+    memset(&chip, 0, sizeof(chip));
+    chip.Mem     = malloc(size);
+    chip.Size    = size;
+    chip.Id[0]   = (u8)(id >> 16);
+    chip.Id[1]   = (u8)(id >> 8);
+    chip.Id[2]   = (u8)id;
+    chip.HasSFDP = sfdp;
+    memset(chip.Mem, 0xFF, size);
+    Model_BuildSFDP();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Clocks one byte through the chip while CS is low.
+/// @param  tx: byte from the master.
+/// @retval Byte driven on MISO.
+////////////////////////////////////////////////////////////////////////////////
+static u8 Model_Byte(u8 tx)
+{
+    u32 n = chip.Count++;
+    u32 alen = (chip.Addr4 && (chip.Op != SPI_NOR_CMD_RDSFDP)) ? 4 : 3;
+    bool busy;
+
+    if (!chip.Selected) {
+        chip.Selected = true;
+        chip.Count    = 1;
+        chip.Op       = tx;
+        chip.Addr     = 0;
+        memset(chip.PageBuf, 0xFF, sizeof(chip.PageBuf));
+        busy = Model_Busy();
+        if (busy && (tx != SPI_NOR_CMD_RDSR) && !((tx == SPI_NOR_CMD_SUSPEND) && chip.Erasing && !chip.Suspended)) {
+            Model_Violation("command while busy");
+        }
+        if (!busy && chip.Suspended && (tx != SPI_NOR_CMD_RDSR) && (tx != SPI_NOR_CMD_FAST_READ) &&
+            (tx != SPI_NOR_CMD_RESUME)) {
+            Model_Violation("command while an erase is suspended");
+        }
+        return 0xFF;
+    }
+
+    switch (chip.Op) {
+        case SPI_NOR_CMD_RDID:
+            return (n <= 3) ? chip.Id[n - 1] : 0xFF;
+
+        case SPI_NOR_CMD_RDSR:
+            return (u8)((Model_Busy() ? SPI_NOR_SR_WIP : 0) | (chip.Wel ? 0x02 : 0));
+
+        case SPI_NOR_CMD_FAST_READ:
+        case SPI_NOR_CMD_RDSFDP:
+        case SPI_NOR_CMD_PP:
+        case SPI_NOR_CMD_SE:
+            if (n <= alen) {
+                chip.Addr = (chip.Addr << 8) | tx;
+                return 0xFF;
+            }
+            if (chip.Op == SPI_NOR_CMD_PP) {
+                chip.PageBuf[(chip.Addr + n - alen - 1) & 0xFFU] = tx;
+                return 0xFF;
+            }
+            if ((chip.Op == SPI_NOR_CMD_SE) || (n == alen + 1)) {
+                return 0xFF;                                                    // Dummy byte
+            }
+            if (chip.Op == SPI_NOR_CMD_RDSFDP) {
+                n = chip.Addr + n - alen - 2;
+                return (chip.HasSFDP && (n < sizeof(chip.Sfdp))) ? chip.Sfdp[n] : 0xFF;
+            }
+            return chip.Mem[(chip.Addr + n - alen - 2) % chip.Size];
+
+        default:
+            return 0xFF;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  CS rising edge: executes write-type commands.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Deselect(void)
+{
+    u32 base, i;
+
+    if (!chip.Selected) {
+        return;
+    }
+    chip.Selected = false;
+
+    switch (chip.Op) {
+        case SPI_NOR_CMD_WREN:
+            chip.Wel = true;
+            break;
+
+        case SPI_NOR_CMD_PP:
+            if (!chip.Wel) {
+                Model_Violation("program without WREN");
+                break;
+            }
+            base = (chip.Addr % chip.Size) & ~0xFFU;
+            for (i = 0; i < 256; i++) {
+                chip.Mem[base + i] &= chip.PageBuf[i];
+            }
+            chip.Wel       = false;
+            chip.BusyUntil = model_now + MODEL_TPP_NS;
+            break;
+
+        case SPI_NOR_CMD_SE:
+            if (!chip.Wel) {
+                Model_Violation("erase without WREN");
+                break;
+            }
+            memset(chip.Mem + ((chip.Addr % chip.Size) & ~0xFFFU), 0xFF, 4096);
+            chip.Wel       = false;
+            chip.Erasing   = true;
+            chip.BusyUntil = model_now + MODEL_TSE_NS;
+            break;
+
+        case SPI_NOR_CMD_SUSPEND:
+            if (chip.Erasing && !chip.Suspended && (model_now < chip.BusyUntil)) {
+                chip.Remaining = chip.BusyUntil - model_now;
+                chip.Suspended = true;
+                chip.BusyUntil = model_now + MODEL_TSUS_NS;
+            }
+            break;
+
+        case SPI_NOR_CMD_RESUME:
+            if (chip.Suspended) {
+                chip.Suspended = false;
+                chip.BusyUntil = model_now + chip.Remaining;
+            }
+            break;
+
+        case SPI_NOR_CMD_EN4B:
+            chip.Addr4 = true;
+            break;
+
+        default:
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Applies the write-1-to-clear registers the driver wrote.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_ApplyClears(void)
+{
+    DMA1->ISR  &= ~DMA1->IFCR;
+    DMA1->IFCR  = 0;
+    SPI2->ISR  &= ~SPI2->ICR;
+    SPI2->ICR   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Notes a poll timer the driver (re)started since the last look.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_TimerSync(void)
+{
+    if ((TIM14->CR1 & TIM_CR1_CEN) && (TIM14->CNT == 0)) {
+        timer_due  = model_now + (u64)TIM14->ARR * 1000;
+        TIM14->CNT = 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs one interrupt handler of the driver.
+/// @param  handler: 0 for DMA, 1 for SPI, 2 for the poll timer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_IRQ(u8 handler)
+{
+    u64 t0 = Host_Cycles();
+
+    model_irqs++;
+    if (handler == 0) {
+        SpiQueue_DMAIRQHandler(&queue);
+    }
+    else if (handler == 1) {
+        SpiQueue_IRQHandler(&queue);
+    }
+    else {
+        SpiNor_TimerIRQHandler(&nor);
+    }
+    driver_cycles += Host_Cycles() - t0;
+    Model_ApplyClears();
+    Model_TimerSync();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Moves the active transfer over the bus and raises its interrupts.
+/// @param  xfer: head transfer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Transfer(SpiQueue_TransferTypeDef* xfer)
+{
+    const u8* tx = (const u8*)xfer->TxData;
+    u8*  rx      = (u8*)xfer->RxData;
+    bool keep    = xfer->KeepCS;
+    u32  done    = queue.Completed + queue.Errors;
+    u32  i;
+    u8   value;
+
+    for (i = 0; i < xfer->Length; i++) {
+        value = Model_Byte((tx != NULL) ? tx[i] : 0xFF);
+        if (rx != NULL) {
+            rx[i] = value;
+        }
+    }
+    model_now   += (u64)xfer->Length * 8 * 1000000000U / MODEL_SCK_HZ + MODEL_XFER_NS;
+
+    DMA1->ISR |= DMA_CHANNEL_FLAGS(queue.TxChannel, DMAx_FLAG_GLy | DMAx_FLAG_TCy);
+    if (queue.RxEnabled) {
+        DMA1->ISR |= DMA_CHANNEL_FLAGS(queue.RxChannel, DMAx_FLAG_GLy | DMAx_FLAG_TCy);
+        Model_IRQ(0);
+    }
+    else {
+        // TX DMA is done but the last frames are still in the FIFO.
+        SPI2->SR &= ~SPI_SR_TXEPT;
+        Model_IRQ(0);
+        if ((SPI2->IER & SPI_IER_TXEPT_IEN) && (SPI2->ISR & SPI_ISR_TXEPT_INTF)) {
+            Model_IRQ(1);
+        }
+        if (queue.Completed + queue.Errors != done) {
+            Model_Violation("CS released with frames in the TX FIFO");
+        }
+        SPI2->SR  |= SPI_SR_TXEPT;
+        SPI2->ISR |= SPI_ISR_TXEPT_INTF;
+        if ((SPI2->IER & SPI_IER_TXEPT_IEN) && (queue.Completed + queue.Errors == done)) {
+            Model_IRQ(1);
+        }
+    }
+    if (queue.Completed + queue.Errors == done) {
+        Model_Violation("transfer not retired");
+        xfer->Status = SPIQ_Status_Error;
+        queue.Head   = NULL;
+        queue.Tail   = NULL;
+    }
+    if (!keep) {
+        Model_Deselect();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Pending-interrupt hook: runs the bus until it is idle.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Service(void)
+{
+    if (model_isr || Host_PRIMASK) {
+        return;
+    }
+    model_isr = true;
+    Model_TimerSync();
+    while ((queue.Head != NULL) && (queue.Head->Status == SPIQ_Status_Active)) {
+        Model_Transfer(queue.Head);
+    }
+    model_isr = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Lets time pass to the next poll timer expiry and services it.
+/// @param  None.
+/// @retval false if nothing is armed.
+////////////////////////////////////////////////////////////////////////////////
+static bool Model_Step(void)
+{
+    Model_Service();
+    if (!(TIM14->CR1 & TIM_CR1_CEN)) {
+        return false;
+    }
+    if (model_now < timer_due) {
+        model_now = timer_due;
+    }
+    TIM14->CR1 &= ~TIM_CR1_CEN;
+    TIM14->SR  |= TIM_SR_UI;
+    model_isr   = true;
+    Model_IRQ(2);
+    model_isr   = false;
+    Model_Service();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs until the driver is idle.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Run(void)
+{
+    Model_Service();
+    while (SpiNor_IsBusy(&nor)) {
+        if (!Model_Step()) {
+            Model_Violation("driver busy with nothing pending");
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Completion callback shared by all requests.
+/// @param  n: driver state.
+/// @param  status: result.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Done(SpiNor_TypeDef* n, ErrorStatus status)
+{
+    (void)n;
+    done_count++;
+    done_status = status;
+    done_time   = model_now;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Brings up the queue and the driver on a fresh chip.
+/// @param  id: JEDEC ID of the chip.
+/// @param  size: array size in bytes.
+/// @param  sfdp: true if the chip has SFDP.
+/// @retval Result of SpiNor_Init.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus Model_Bringup(u32 id, u32 size, bool sfdp)
+{
+    static const SpiQueue_DeviceTypeDef device = {
+        SPI_CPOL_Low, SPI_CPHA_1Edge, SPI_FirstBit_MSB, SPI_BaudRatePrescaler_2, 8, GPIOB, GPIO_Pin_12
+    };
+
+    Model_Chip(id, size, sfdp);
+    memset(TIM14, 0, sizeof(*TIM14));
+    SpiQueue_Init(&queue, SPI2);
+    SPI2->SR  = SPI_SR_TXEPT;
+    SPI2->ISR = SPI_ISR_TXEPT_INTF;                                             // Latched by the idle bus
+    model_now    = 0;
+    Host_IRQHook = Model_Service;
+    return SpiNor_Init(&nor, &queue, &device, TIM14);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Converts bytes over simulated time to a rate.
+/// @param  bytes: bytes moved.
+/// @param  ns: simulated time taken.
+/// @retval KB/s.
+////////////////////////////////////////////////////////////////////////////////
+static double Model_Rate(u32 bytes, u64 ns)
+{
+    return (double)bytes * 1000000000.0 / 1024.0 / (double)ns;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Erases [addr, addr + len) sector by sector through the driver.
+/// @param  addr: first byte.
+/// @param  len: bytes.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_Erase(u32 addr, u32 len)
+{
+    u32 end = addr + len;
+
+    done_count = 0;
+    for (addr &= ~0xFFFU; addr < end; addr += 4096) {
+        while (SpiNor_EraseSector(&nor, addr, Model_Done) != SUCCESS) {
+            Model_Step();
+        }
+    }
+    Model_Run();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Write, read-back and erase-suspend checks on one chip geometry.
+/// @param  base: flash address of the test area.
+/// @param  len: bytes written and read back.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Model_DataTest(u32 base, u32 len)
+{
+    u8* src = malloc(len);
+    u8* dst = malloc(len);
+    u64 t0, cycles0;
+    u32 irqs0, pages, i;
+
+    for (i = 0; i < len; i++) {
+        src[i] = (u8)(rand() >> 7);
+    }
+
+    Model_Erase(base, len);
+    Host_Check((done_count == ((base + len - 1) >> 12) - (base >> 12) + 1) && (done_status == SUCCESS), "erase callbacks");
+
+    t0 = model_now; irqs0 = model_irqs; cycles0 = driver_cycles;
+    done_count = 0;
+    Host_Check(SpiNor_Write(&nor, base, src, len, Model_Done) == SUCCESS, "write accepted");
+    Model_Run();
+    Host_Check((done_count == 1) && (done_status == SUCCESS), "write callback");
+    Host_Check(memcmp(chip.Mem + base, src, len) == 0, "array holds the written data");
+    pages = ((base + len - 1) >> 8) - (base >> 8) + 1;
+    printf("  write %6u B at 0x%07X: %6.1f KB/s, %u pages, %.1f IRQs/page, %.0f host cycles/KB in the driver\n",
+           (unsigned)len, (unsigned)base, Model_Rate(len, model_now - t0), (unsigned)pages,
+           (double)(model_irqs - irqs0) / pages, (double)(driver_cycles - cycles0) * 1024.0 / len);
+
+    t0 = model_now; irqs0 = model_irqs; cycles0 = driver_cycles;
+    done_count = 0;
+    memset(dst, 0, len);
+    Host_Check(SpiNor_Read(&nor, base, dst, len, Model_Done) == SUCCESS, "read accepted");
+    Model_Run();
+    Host_Check((done_count == 1) && (done_status == SUCCESS), "read callback");
+    Host_Check(memcmp(dst, src, len) == 0, "read returns the written data");
+    printf("  read  %6u B at 0x%07X: %6.1f KB/s of %.1f on the wire, %u IRQs, %.0f host cycles/KB in the driver\n",
+           (unsigned)len, (unsigned)base, Model_Rate(len, model_now - t0), MODEL_SCK_HZ / 8 / 1024.0, (unsigned)(model_irqs - irqs0), (double)(driver_cycles - cycles0) * 1024.0 / len);
+
+    // A read during an erase suspends it when the chip supports that.
+    done_count = 0;
+    Host_Check(SpiNor_EraseSector(&nor, base + len + 4096, Model_Done) == SUCCESS, "erase accepted");
+    Model_Service();
+    t0 = model_now;
+    memset(dst, 0, 256);
+    Host_Check(SpiNor_Read(&nor, base, dst, 256, NULL) == SUCCESS, "read during erase accepted");
+    while (nor.ReadPending && Model_Step()) {
+    }
+    Host_Check(memcmp(dst, src, 256) == 0, "read during erase returns the data");
+    if (nor.Info.SuspendCmd != 0) {
+        Host_Check(model_now - t0 < MODEL_TSE_NS / 2, "read during erase does not wait for the erase");
+    }
+    Model_Run();
+    Host_Check((done_count == 1) && (done_status == SUCCESS), "erase completed");
+    Host_Check(nor.Suspends == ((nor.Info.SuspendCmd != 0) ? 1U : 0U), "erase suspended once if supported");
+    Host_Check(done_time - t0 >= MODEL_TSE_NS, "suspended erase still runs its full time");
+
+    free(src);
+    free(dst);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Model entry point.
+/// @param  None.
+/// @retval 0 if every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+    Host_Init();
+    srand(1);
+
+    printf("2 MB, SFDP, 3-byte addresses\n");
+    Host_Check(Model_Bringup(0xEF4015, 0x200000, true) == SUCCESS, "init with SFDP");
+    Host_Check(nor.Info.HasSFDP && (nor.Info.Capacity == 0x200000) && (nor.Info.PageSize == 256) &&
+               (nor.Info.SectorSize == 4096) && (nor.Info.SuspendCmd == SPI_NOR_CMD_SUSPEND) &&
+               (nor.Info.ProgramPollUs == 704) && (nor.Info.ErasePollUs == 7500), "SFDP parameters");
+    Model_DataTest(0x1003, 60000);
+    Host_Check(SpiNor_Read(&nor, 0x1FFFFF, chip.PageBuf, 2, NULL) == ERROR, "read past the end rejected");
+
+    printf("32 MB, SFDP, switched to 4-byte addresses\n");
+    Host_Check(Model_Bringup(0xEF4019, 0x2000000, true) == SUCCESS, "init with EN4B");
+    Host_Check(chip.Addr4 && (nor.Info.AddrBytes == 4), "4-byte addressing");
+    Model_DataTest(0xFFF800, 8192);
+
+    printf("4 MB, no SFDP\n");
+    Host_Check(Model_Bringup(0xC22016, 0x400000, false) == SUCCESS, "init from the JEDEC ID");
+    Host_Check(!nor.Info.HasSFDP && (nor.Info.Capacity == 0x400000), "capacity from the JEDEC ID");
+    Model_DataTest(0x300100, 4096);
+
+    printf("Unknown capacity code, no SFDP\n");
+    Host_Check(Model_Bringup(0x1F8501, 0x10000, false) == ERROR, "init rejects an unknown size");
+
+    Host_Check(model_violations == 0, "no protocol violations");
+    return Host_Result();
+}
+
+/// @}
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_queue_bench.c
+/// @brief    HOST BUILD ONLY: CPU COST PER BYTE OF THE SPI QUEUE TRANSFER
+///           PATHS (8-BIT DMA, 16- AND 32-BIT PACKED).
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Build and run from the MM32F0140 folder:
+///   gcc -O2 -std=gnu99 -w -IDrivers/host -IDrivers -ISTARTUP/core
+///       -ISTARTUP/Include -IHAL_Lib/Inc Drivers/host/spi_queue_bench.c
+///       Drivers/host/host.c Drivers/spi_queue.c Drivers/drv_common.c
+///       HAL_Lib/Src/*.c -o spi_queue_bench
+///   ./spi_queue_bench
+///
+/// Each path moves BENCH_LENGTH bytes full duplex, BENCH_ROUNDS times. The
+/// time counted is everything the CPU runs for the transfer: SpiQueue_Submit
+/// and every DMA or SPI interrupt until the transfer retires, including the
+/// byte swaps of MSB-first packed buffers. What the DMA moves is emulated
+/// between the interrupts and not counted: the RX channel writes RDR into
+/// the buffer in its beat size, the TX channel leaves its last item in TDR.
+/// Bytes per host cycle compare the paths; interrupts and DMA beats per KB
+/// carry over to the target as is. MSB-first packed buffers pay for their
+/// swaps per byte, which the 8-bit path does not: what packing saves is DMA
+/// beats, i.e. bus cycles taken from the core, at one interrupt per transfer
+/// either way. A packed transfer one byte short of a whole frame count also
+/// runs its byte tail through the SPI interrupt.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SPI_QUEUE_BENCH_C_
+
+// Files includes
+#include <string.h>
+#include "host.h"
+#include "spi_queue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup HOST
+/// @{
+
+#define BENCH_LENGTH                (4096U)
+#define BENCH_ROUNDS                (2000U)
+#define BENCH_RDR                   (0x11223344U)                               ///< Every received frame
+
+static SpiQueue_TypeDef queue;
+static u32 tx_buf[BENCH_LENGTH / 4];
+static u32 rx_buf[BENCH_LENGTH / 4];
+static u32 beats;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Does what the DMA pair does for the active transfer and raises the
+///         RX transfer complete flag.
+/// @param  xfer: active transfer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_DMA(SpiQueue_TransferTypeDef* xfer)
+{
+    u32 items = queue.RxChannel->CNDTR;
+    u32 size  = ((queue.RxChannel->CCR & DMA_CCR_MSIZE) == DMA_CCR_MSIZE_WORD)     ? 4 :
+                ((queue.RxChannel->CCR & DMA_CCR_MSIZE) == DMA_CCR_MSIZE_HALFWORD) ? 2 : 1;
+    u32 frame = BENCH_RDR;
+    u32 i;
+
+    if (queue.RxChannel->CCR & DMA_CCR_MINC) {
+        for (i = 0; i < items; i++) {
+            memcpy((u8*)xfer->RxData + i * size, &frame, size);
+        }
+    }
+    if (queue.TxChannel->CCR & DMA_CCR_MINC) {
+        frame = 0;
+        memcpy(&frame, (const u8*)xfer->TxData + (items - 1) * size, size);
+        SPI2->TDR = frame;
+    }
+    beats += items * 2;
+    DMA1->ISR |= DMA_CHANNEL_FLAGS(queue.RxChannel, DMAx_FLAG_GLy | DMAx_FLAG_TCy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs one transfer to completion.
+/// @param  xfer: transfer descriptor.
+/// @param  irqs: incremented per interrupt taken.
+/// @retval Host cycles spent in the driver.
+////////////////////////////////////////////////////////////////////////////////
+static u64 Bench_Transfer(SpiQueue_TransferTypeDef* xfer, u32* irqs)
+{
+    u64 t0, cycles;
+
+    SPI2->SR = SPI_SR_TXEPT;                                                    // Nothing stale in the RX FIFO
+    t0 = Host_Cycles();
+    SpiQueue_Submit(&queue, xfer);
+    cycles = Host_Cycles() - t0;
+    while (xfer->Status == SPIQ_Status_Active) {
+        (*irqs)++;
+        if (SPI2->IER & SPI_IT_RX) {
+            // Byte tail: every byte in flight has come back.
+            SPI2->SR  |= SPI_SR_RXAVL;
+            SPI2->ISR |= SPI_ISR_RX_INTF;
+            t0 = Host_Cycles();
+            SpiQueue_IRQHandler(&queue);
+        }
+        else {
+            Bench_DMA(xfer);
+            t0 = Host_Cycles();
+            SpiQueue_DMAIRQHandler(&queue);
+        }
+        cycles += Host_Cycles() - t0;
+        SPI2->SR = SPI_SR_TXEPT;
+    }
+    return cycles;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Measures one path and checks the byte order on both sides.
+/// @param  name: path label.
+/// @param  pack: 0 for bytes, else bytes per packed frame.
+/// @param  expect: first received bytes, one frame's worth.
+/// @param  irqs_kb: receives the interrupts per KB.
+/// @param  beats_kb: receives the DMA beats per KB.
+/// @retval Bytes per host cycle.
+////////////////////////////////////////////////////////////////////////////////
+static double Bench_Path(const char* name, u8 pack, const u8* expect, double* irqs_kb, double* beats_kb)
+{
+    static const SpiQueue_DeviceTypeDef device = {
+        SPI_CPOL_Low, SPI_CPHA_1Edge, SPI_FirstBit_MSB, SPI_BaudRatePrescaler_2, 8, GPIOB, GPIO_Pin_12
+    };
+    SpiQueue_TransferTypeDef xfer;
+    u64 cycles = 0;
+    u32 irqs = 0, i;
+    u8  n = pack ? pack : 1;
+
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.Device = &device;
+    xfer.TxData = tx_buf;
+    xfer.RxData = rx_buf;
+    xfer.Length = BENCH_LENGTH;
+    xfer.Pack   = pack;
+
+    beats = 0;
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        memset(rx_buf, 0, sizeof(rx_buf));
+        cycles += Bench_Transfer(&xfer, &irqs);
+        Host_Check(xfer.Status == SPIQ_Status_Done, name);
+    }
+    Host_Check(memcmp(rx_buf, expect, n) == 0, "received frames in wire order");
+    Host_Check(memcmp((u8*)rx_buf + BENCH_LENGTH - n, expect, n) == 0, "last received frame in wire order");
+    Host_Check(SPI2->TDR == ((n == 4) ? 0xFCFDFEFFU : (n == 2) ? 0xFEFFU : 0xFFU), "last frame sent in wire order");
+    for (i = 0; i < BENCH_LENGTH; i++) {
+        if (((u8*)tx_buf)[i] != (u8)i) {
+            break;
+        }
+    }
+    Host_Check(i == BENCH_LENGTH, "TX buffer restored");
+
+    *irqs_kb  = (double)irqs * 1024.0 / BENCH_LENGTH / BENCH_ROUNDS;
+    *beats_kb = (double)beats * 1024.0 / BENCH_LENGTH / BENCH_ROUNDS;
+    printf("  %-11s %7.3f bytes/host cycle, %5.2f IRQs/KB, %6.1f DMA beats/KB\n", name,
+           (double)BENCH_LENGTH * BENCH_ROUNDS / (double)cycles, *irqs_kb, *beats_kb);
+    return (double)BENCH_LENGTH * BENCH_ROUNDS / (double)cycles;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs a packed transfer with a byte tail and checks every byte.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void Bench_Tail(void)
+{
+    static const SpiQueue_DeviceTypeDef device = {
+        SPI_CPOL_Low, SPI_CPHA_1Edge, SPI_FirstBit_MSB, SPI_BaudRatePrescaler_2, 8, GPIOB, GPIO_Pin_12
+    };
+    SpiQueue_TransferTypeDef xfer;
+    u32 irqs = 0;
+    const u8* rx = (const u8*)rx_buf;
+
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.Device = &device;
+    xfer.TxData = tx_buf;
+    xfer.RxData = rx_buf;
+    xfer.Length = BENCH_LENGTH - 1;
+    xfer.Pack   = 4;
+    memset(rx_buf, 0, sizeof(rx_buf));
+    (void)Bench_Transfer(&xfer, &irqs);
+
+    Host_Check((xfer.Status == SPIQ_Status_Done) && (irqs == 2), "packed tail: one DMA and one SPI interrupt");
+    Host_Check((rx[BENCH_LENGTH - 8] == 0x11) && (rx[BENCH_LENGTH - 5] == 0x44), "packed tail: last frame in order");
+    Host_Check((rx[BENCH_LENGTH - 4] == 0x44) && (rx[BENCH_LENGTH - 2] == 0x44) && (rx[BENCH_LENGTH - 1] == 0),
+               "packed tail: bytes received");
+    Host_Check((SPI2->TDR == 0xFE) && (queue.DataWidth == 8), "packed tail: bytes sent on an 8-bit bus");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Benchmark entry point.
+/// @param  None.
+/// @retval 0 if every check passed.
+////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+    static const u8 rx8[]  = {0x44};
+    static const u8 rx16[] = {0x33, 0x44};
+    static const u8 rx32[] = {0x11, 0x22, 0x33, 0x44};
+    double x8, x16, x32, irqs8, irqs16, irqs32, beats8, beats16, beats32;
+    u32 i;
+
+    Host_Init();
+    SpiQueue_Init(&queue, SPI2);
+    for (i = 0; i < BENCH_LENGTH; i++) {
+        ((u8*)tx_buf)[i] = (u8)i;
+    }
+    SPI2->RDR = BENCH_RDR;
+
+    printf("%u-byte full-duplex transfers, MSB first, %u rounds\n", BENCH_LENGTH, BENCH_ROUNDS);
+    x8  = Bench_Path("x8 DMA", 0, rx8, &irqs8, &beats8);
+    x16 = Bench_Path("x16 packed", 2, rx16, &irqs16, &beats16);
+    x32 = Bench_Path("x32 packed", 4, rx32, &irqs32, &beats32);
+    Bench_Tail();
+    printf("  x8 vs x32: %.1f vs %.1f DMA beats/KB; the swaps cost %.2f host cycles/byte\n", beats8, beats32,
+           1.0 / x32 - 1.0 / x8);
+
+    Host_Check((irqs16 <= irqs8) && (irqs32 <= irqs8), "packed takes no more interrupts than the 8-bit path");
+    Host_Check((beats16 * 2 <= beats8) && (beats32 * 4 <= beats8), "packed takes 1/2 or 1/4 of the DMA beats");
+    Host_Check(x32 > x16, "32-bit frames cost less per byte than 16-bit frames");
+    return Host_Result();
+}
+
+/// @}
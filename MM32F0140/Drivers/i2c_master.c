@@ -0,0 +1,502 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2c_master.c
+/// @brief    THIS FILE PROVIDES THE INTERRUPT-DRIVEN I2C MASTER FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Each transaction is a write phase, a read phase after a repeated START
+/// (REPEN), and a STOP. The interrupt handler keeps the TX FIFO topped up
+/// with data bytes and read commands and drains the RX FIFO:
+///   - TX_EMPTY fires at half FIFO while there is something left to push;
+///   - RX_FULL fires when all read commands in flight have completed, so one
+///     entry services the whole window;
+///   - once every byte is through, STOP is requested through ABORT if the
+///     controller is still holding the bus, and the transaction completes
+///     when the master state machine goes idle (STOP_DET).
+/// TX_ABRT (address or data NACK, arbitration loss) makes the controller
+/// flush its TX FIFO and send STOP; the transaction completes with
+/// I2CM_Status_Abort and the queue carries on with the next one.
+///
+/// With I2CMaster_DMACmd, transactions of I2C_MASTER_DMA_THRESHOLD bytes or
+/// more bypass the FIFO service. The TX channel writes IC_DATA_CMD: first
+/// the write bytes (byte memory, word peripheral, so bit 8 reads as 0), then
+/// one constant read command per byte to receive, without incrementing the
+/// memory address. The RX channel drains the data. A short write prefix,
+/// e.g. a register address, is put straight into the empty TX FIFO. A
+/// 256-byte burst read therefore takes the RX transfer-complete interrupt
+/// and STOP_DET, not one interrupt per FIFO window.
+///
+/// I2CM_FLAG_ACK_POLL is for EEPROM page writes. After the STOP, the driver
+/// keeps addressing the device with a one-byte read until it acknowledges,
+/// i.e. until its internal write cycle is over. The transfer completes only
+/// then, so the next transaction never meets a busy device.
+///
+/// The application forwards the vectors:
+///   void I2C1_IRQHandler(void) { I2CMaster_IRQHandler(&i2c1_master); }
+///   void DMA1_Channel4_5_IRQHandler(void) { I2CMaster_DMAIRQHandler(&i2c1_master); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _I2C_MASTER_C_
+
+// Files includes
+#include "i2c_master.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup I2C_MASTER
+/// @{
+
+static void I2CMaster_Start(I2CMaster_TypeDef* master);
+
+static const u16 I2CMaster_ReadCommand = I2C_DR_CMD;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Moves bytes between the FIFOs and the active transfer, requests
+///         STOP when everything is through, and programs the interrupt mask
+///         and FIFO thresholds for what is still outstanding.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_Service(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    u32 mask = I2C_IT_TX_ABRT | I2C_IT_STOP_DET;
+    u16 in_flight;
+
+    if (master->DMAActive) {
+        i2c->IC_INTR_MASK = mask;
+        return;
+    }
+    while ((master->RxIndex < master->CmdIndex) && (i2c->IC_STATUS & I2C_SR_RFNE)) {
+        master->RxData[master->RxIndex++] = (u8)i2c->IC_DATA_CMD;
+    }
+
+    if (!master->Aborted && !master->Stopping) {
+        while ((master->TxIndex < master->TxLength) && (i2c->IC_STATUS & I2C_SR_TFNF)) {
+            i2c->IC_DATA_CMD = master->TxData[master->TxIndex++];
+        }
+        if (master->TxIndex == master->TxLength) {
+            while ((master->CmdIndex < master->RxLength) && ((u16)(master->CmdIndex - master->RxIndex) < I2C_MASTER_FIFO_DEPTH) &&
+                   (i2c->IC_STATUS & I2C_SR_TFNF)) {
+                i2c->IC_DATA_CMD = I2C_DR_CMD;
+                master->CmdIndex++;
+            }
+        }
+
+        if ((master->TxIndex == master->TxLength) && (master->RxIndex == master->RxLength) && (i2c->IC_STATUS & I2C_SR_TFE)) {
+            master->Stopping = true;
+            if (i2c->IC_STATUS & I2C_SR_MST_ACTIV) {
+                i2c->IC_ENABLE |= I2C_ENR_ABORT;
+            }
+        }
+    }
+
+    if (!master->Aborted && !master->Stopping) {
+        in_flight = master->CmdIndex - master->RxIndex;
+        if ((master->TxIndex < master->TxLength) ||
+            ((master->CmdIndex < master->RxLength) && (in_flight < I2C_MASTER_FIFO_DEPTH))) {
+            i2c->IC_TX_TL = I2C_MASTER_FIFO_DEPTH / 2;
+            mask |= I2C_IT_TX_EMPTY;
+        }
+        else if (master->RxLength == 0) {
+            // Write-only: wait for the FIFO to drain before STOP.
+            i2c->IC_TX_TL = 0;
+            mask |= I2C_IT_TX_EMPTY;
+        }
+        if (in_flight != 0) {
+            i2c->IC_RX_TL = in_flight - 1;
+            mask |= I2C_IT_RX_FULL;
+        }
+    }
+    i2c->IC_INTR_MASK = mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stops both channels and the I2C DMA requests.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_StopDMA(I2CMaster_TypeDef* master)
+{
+    master->I2C->IC_DMA_CR = 0;
+    I2C_MASTER_TX_CHANNEL->CCR = 0;
+    I2C_MASTER_RX_CHANNEL->CCR = 0;
+    master->DMAActive = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Points the TX channel at the constant read command, one transfer
+///         per byte to receive.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_DMAReadCommands(I2CMaster_TypeDef* master)
+{
+    DRV_DMAStart(I2C_MASTER_TX_CHANNEL, DMA_CCR_DIR | DMA_CCR_MSIZE_HALFWORD | DMA_CCR_PSIZE_WORD | DMA_CCR_TEIE | DMA_CCR_PL_High,
+                 (u32)&master->I2C->IC_DATA_CMD, (u32)&I2CMaster_ReadCommand, master->RxLength);
+    master->CmdIndex = master->RxLength;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Hands the transaction to DMA if it is long enough. The RX channel
+///         is armed before the first read command can reach the bus.
+/// @param  master: pointer to the master state.
+/// @retval true if DMA now owns the transaction.
+////////////////////////////////////////////////////////////////////////////////
+static bool I2CMaster_StartDMA(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    u16 prefix = 0;
+
+    if (!master->UseDMA || ((u32)master->TxLength + master->RxLength < I2C_MASTER_DMA_THRESHOLD)) {
+        return false;
+    }
+    // A register address ahead of a read fits the empty TX FIFO and saves
+    // the TX transfer-complete interrupt.
+    if ((master->RxLength != 0) && (master->TxLength <= I2C_MASTER_FIFO_DEPTH)) {
+        prefix = master->TxLength;
+    }
+    if (master->RxLength != 0) {
+        DRV_DMAStart(I2C_MASTER_RX_CHANNEL, DMA_CCR_MINC | DMA_CCR_MSIZE_BYTE | DMA_CCR_PSIZE_WORD | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_VeryHigh,
+                     (u32)&i2c->IC_DATA_CMD, (u32)master->RxData, master->RxLength);
+    }
+    while (master->TxIndex < prefix) {
+        i2c->IC_DATA_CMD = master->TxData[master->TxIndex++];
+    }
+    if (master->TxIndex < master->TxLength) {
+        // The transfer-complete interrupt chains the read commands, or hands
+        // a write-only transaction back to I2CMaster_Service for the STOP.
+        DRV_DMAStart(I2C_MASTER_TX_CHANNEL, DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_MSIZE_BYTE | DMA_CCR_PSIZE_WORD | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_High,
+                     (u32)&i2c->IC_DATA_CMD, (u32)master->TxData, master->TxLength);
+    }
+    else {
+        I2CMaster_DMAReadCommands(master);
+    }
+    master->DMAActive = true;
+    master->Bursts++;
+    i2c->IC_DMA_CR = I2C_DMA_RXEN | I2C_DMA_TXEN;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts one bus transaction to the address in IC_TAR.
+/// @param  master: pointer to the master state.
+/// @param  tx_data: bytes to write, or NULL.
+/// @param  tx_length: number of bytes to write.
+/// @param  rx_data: receive buffer, or NULL.
+/// @param  rx_length: number of bytes to read.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_Launch(I2CMaster_TypeDef* master, const u8* tx_data, u16 tx_length, u8* rx_data, u16 rx_length)
+{
+    master->TxData   = tx_data;
+    master->TxLength = tx_length;
+    master->RxData   = rx_data;
+    master->RxLength = rx_length;
+    master->TxIndex  = 0;
+    master->CmdIndex = 0;
+    master->RxIndex  = 0;
+    master->Aborted  = false;
+    master->Stopping = false;
+    (void)master->I2C->IC_CLR_INTR;
+
+    (void)I2CMaster_StartDMA(master);
+    I2CMaster_Service(master);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Retires the head transfer and starts the next one.
+/// @param  master: pointer to the master state.
+/// @param  status: I2CM_Status_Done or I2CM_Status_Abort.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_Finish(I2CMaster_TypeDef* master, I2CMaster_Status_TypeDef status)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    I2CMaster_TransferTypeDef* xfer = master->Head;
+
+    i2c->IC_INTR_MASK = 0;
+    I2CMaster_StopDMA(master);
+    while (i2c->IC_STATUS & I2C_SR_RFNE) {
+        (void)i2c->IC_DATA_CMD;
+    }
+
+    master->Head = xfer->Next;
+    if (master->Head == NULL) {
+        master->Tail = NULL;
+    }
+    xfer->Next   = NULL;
+    xfer->Status = status;
+    (status == I2CM_Status_Done) ? master->Completed++ : master->Aborts++;
+
+    if (xfer->Callback != NULL) {
+        xfer->Callback(xfer);
+    }
+    // The callback may already have started a newly submitted transfer.
+    if ((master->Head != NULL) && (master->Head->Status == I2CM_Status_Queued)) {
+        I2CMaster_Start(master);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the transfer at the head of the queue. IC_TAR can only be
+///         written with the controller disabled, so it is only rewritten when
+///         the slave address changes.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_Start(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    I2CMaster_TransferTypeDef* xfer = master->Head;
+
+    if (xfer->Address != master->Target) {
+        I2C_Cmd(i2c, DISABLE);
+        i2c->IC_TAR    = xfer->Address;
+        master->Target = xfer->Address;
+        I2C_Cmd(i2c, ENABLE);
+    }
+    master->Polling = false;
+    xfer->Status    = I2CM_Status_Active;
+    I2CMaster_Launch(master, xfer->TxData, xfer->TxLength, xfer->RxData, xfer->RxLength);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Called once the bus is idle after a transaction: either retires
+///         the head transfer or starts (another) acknowledge poll.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CMaster_Complete(I2CMaster_TypeDef* master)
+{
+    if (master->Head->Flags & I2CM_FLAG_ACK_POLL) {
+        if (!master->Polling && !master->Aborted) {
+            master->Polling = true;
+            master->Polls   = 0;
+            I2CMaster_Launch(master, NULL, 0, &master->PollByte, 1);
+            return;
+        }
+        // A NACK while polling means the device is still busy.
+        if (master->Polling && master->Aborted && (++master->Polls < I2C_MASTER_ACK_POLL_LIMIT)) {
+            I2CMaster_Launch(master, NULL, 0, &master->PollByte, 1);
+            return;
+        }
+    }
+    I2CMaster_Finish(master, master->Aborted ? I2CM_Status_Abort : I2CM_Status_Done);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Initializes an I2C instance as master with the interrupt disabled
+///         until a transfer is queued. Pins are left to the caller.
+/// @param  master: pointer to the master state.
+/// @param  i2c: I2C1.
+/// @param  clock_speed: SCL frequency in Hz, up to 400000.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CMaster_Init(I2CMaster_TypeDef* master, I2C_TypeDef* i2c, u32 clock_speed)
+{
+    I2C_InitTypeDef i2c_init;
+
+    master->I2C       = i2c;
+    master->Head      = NULL;
+    master->Tail      = NULL;
+    master->Target    = 0xFF;
+    master->UseDMA    = false;
+    master->DMAActive = false;
+    master->Completed = 0;
+    master->Aborts    = 0;
+    master->Bursts    = 0;
+
+    RCC_APB1PeriphClockCmd(RCC_APB1ENR_I2C1, ENABLE);
+
+    I2C_StructInit(&i2c_init);
+    i2c_init.I2C_Mode       = I2C_CR_MASTER;
+    i2c_init.I2C_Speed      = (clock_speed > 100000) ? I2C_CR_FAST : I2C_CR_STD;
+    i2c_init.I2C_ClockSpeed = clock_speed;
+    I2C_Init(i2c, &i2c_init);
+    i2c->IC_INTR_MASK = 0;
+    I2C_Cmd(i2c, ENABLE);
+
+    DRV_NVICEnable(I2C1_IRQn, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Appends a transaction to the queue and starts it if idle.
+/// @param  master: pointer to the master state.
+/// @param  xfer: transfer descriptor, must stay valid until its callback.
+/// @retval ERROR if the descriptor is empty, inconsistent or already queued.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus I2CMaster_Submit(I2CMaster_TypeDef* master, I2CMaster_TransferTypeDef* xfer)
+{
+    if (((xfer->TxLength == 0) && (xfer->RxLength == 0)) ||
+        ((xfer->TxLength != 0) && (xfer->TxData == NULL)) || ((xfer->RxLength != 0) && (xfer->RxData == NULL)) ||
+        (xfer->Status == I2CM_Status_Queued) || (xfer->Status == I2CM_Status_Active)) {
+        return ERROR;
+    }
+    xfer->Next   = NULL;
+    xfer->Status = I2CM_Status_Queued;
+
+    {
+        DRV_ENTER_CRITICAL();
+        if (master->Tail != NULL) {
+            master->Tail->Next = xfer;
+            master->Tail       = xfer;
+        }
+        else {
+            master->Head = xfer;
+            master->Tail = xfer;
+            I2CMaster_Start(master);
+        }
+        DRV_EXIT_CRITICAL();
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Enables or disables DMA for bulk transfers. Call while idle. The
+///         channels (DMA1_Channel4/5) are then not available to SPI2.
+/// @param  master: pointer to the master state.
+/// @param  state: new state, ENABLE or DISABLE.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CMaster_DMACmd(I2CMaster_TypeDef* master, FunctionalState state)
+{
+    if (state != DISABLE) {
+        RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+        DRV_NVICEnable(DMA1_Channel4_5_IRQn, 1);
+    }
+    master->UseDMA = (state != DISABLE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns whether a transaction is queued or running.
+/// @param  master: pointer to the master state.
+/// @retval true if busy.
+////////////////////////////////////////////////////////////////////////////////
+bool I2CMaster_IsBusy(I2CMaster_TypeDef* master)
+{
+    return master->Head != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Last-resort recovery, e.g. from an application watchdog when a
+///         slave holds the bus: aborts the bus activity, fails every queued
+///         transaction and re-enables the controller.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CMaster_Reset(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    I2CMaster_TransferTypeDef* xfer;
+    u32 timeout = I2C_MASTER_STOP_TIMEOUT;
+
+    DRV_ENTER_CRITICAL();
+    i2c->IC_INTR_MASK = 0;
+    I2CMaster_StopDMA(master);
+    i2c->IC_ENABLE |= I2C_ENR_ABORT;
+    while ((i2c->IC_ENABLE & I2C_ENR_ABORT) && --timeout) {
+    }
+    (void)i2c->IC_CLR_INTR;
+    I2C_Cmd(i2c, DISABLE);
+    I2C_Cmd(i2c, ENABLE);
+
+    xfer = master->Head;
+    master->Head = NULL;
+    master->Tail = NULL;
+    DRV_EXIT_CRITICAL();
+
+    while (xfer != NULL) {
+        I2CMaster_TransferTypeDef* next = xfer->Next;
+        xfer->Next   = NULL;
+        xfer->Status = I2CM_Status_Abort;
+        master->Aborts++;
+        if (xfer->Callback != NULL) {
+            xfer->Callback(xfer);
+        }
+        xfer = next;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  I2C interrupt service: FIFO service, abort handling, completion.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CMaster_IRQHandler(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    u32 status = i2c->IC_INTR_STAT;
+
+    if (status & I2C_IT_TX_ABRT) {
+        (void)i2c->IC_CLR_TX_ABRT;
+        // An abort requested to generate STOP is not an error.
+        if (!master->Stopping) {
+            master->Aborted = true;
+        }
+    }
+    if (status & I2C_IT_STOP_DET) {
+        (void)i2c->IC_CLR_STOP_DET;
+    }
+    if (master->Head == NULL) {
+        i2c->IC_INTR_MASK = 0;
+        return;
+    }
+
+    if (master->Aborted && master->DMAActive) {
+        I2CMaster_StopDMA(master);
+    }
+    I2CMaster_Service(master);
+    if ((master->Aborted || master->Stopping) && !(i2c->IC_STATUS & I2C_SR_MST_ACTIV)) {
+        I2CMaster_Complete(master);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service for bulk transfers. Only this driver's
+///         channel flags are read and cleared.
+/// @param  master: pointer to the master state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CMaster_DMAIRQHandler(I2CMaster_TypeDef* master)
+{
+    I2C_TypeDef* i2c = master->I2C;
+    u32 isr = DMA1->ISR & (DMA_CHANNEL_FLAGS(I2C_MASTER_TX_CHANNEL, 0x0F) | DMA_CHANNEL_FLAGS(I2C_MASTER_RX_CHANNEL, 0x0F));
+
+    if (isr == 0) {
+        return;
+    }
+    DMA1->IFCR = isr;
+    if (!master->DMAActive) {
+        return;
+    }
+
+    if (isr & (DMA_CHANNEL_FLAGS(I2C_MASTER_TX_CHANNEL, DMAx_FLAG_TEy) | DMA_CHANNEL_FLAGS(I2C_MASTER_RX_CHANNEL, DMAx_FLAG_TEy))) {
+        I2CMaster_StopDMA(master);
+        master->Aborted = true;
+        i2c->IC_ENABLE |= I2C_ENR_ABORT;
+    }
+    else if (isr & DMA_CHANNEL_FLAGS(I2C_MASTER_RX_CHANNEL, DMAx_FLAG_TCy)) {
+        // Every read command has been answered: all that is left is STOP.
+        I2CMaster_StopDMA(master);
+        master->TxIndex = master->TxLength;
+        master->RxIndex = master->RxLength;
+    }
+    else if (isr & DMA_CHANNEL_FLAGS(I2C_MASTER_TX_CHANNEL, DMAx_FLAG_TCy)) {
+        master->TxIndex = master->TxLength;
+        if (master->RxLength != 0) {
+            I2CMaster_DMAReadCommands(master);
+            return;
+        }
+        I2CMaster_StopDMA(master);
+    }
+    else {
+        return;
+    }
+
+    I2CMaster_Service(master);
+    if ((master->Aborted || master->Stopping) && !(i2c->IC_STATUS & I2C_SR_MST_ACTIV)) {
+        I2CMaster_Complete(master);
+    }
+}
+
+/// @}
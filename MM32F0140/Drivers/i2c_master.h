@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2c_master.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE
+///           INTERRUPT-DRIVEN I2C MASTER TRANSACTION QUEUE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __I2C_MASTER_H
+#define __I2C_MASTER_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_MASTER
+/// @brief Interrupt-driven I2C master
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_MASTER_Exported_Constants
+/// @{
+
+#define I2C_MASTER_FIFO_DEPTH       (2U)                                        ///< Read commands kept in flight, <= RX FIFO depth
+#define I2C_MASTER_STOP_TIMEOUT     (3000U)                                     ///< Abort wait in I2CMaster_Reset, loop count
+#define I2C_MASTER_DMA_THRESHOLD    (8U)                                        ///< Shortest transfer moved by DMA, bytes
+#define I2C_MASTER_ACK_POLL_LIMIT   (1000U)                                     ///< Address attempts after a write, ~100 ms at 100 kHz
+
+#define I2C_MASTER_TX_CHANNEL       DMA1_Channel4                               ///< Shared with SPI2 RX
+#define I2C_MASTER_RX_CHANNEL       DMA1_Channel5                               ///< Shared with SPI2 TX
+
+#define I2CM_FLAG_ACK_POLL          (0x01U)                                     ///< After the write, poll until the slave acknowledges (EEPROM)
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_MASTER_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Transaction status enum definition
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    I2CM_Status_Idle,                                                           ///< Never submitted or already reported
+    I2CM_Status_Queued,
+    I2CM_Status_Active,
+    I2CM_Status_Done,
+    I2CM_Status_Abort                                                           ///< TX_ABRT: NACK, arbitration loss, ...
+} I2CMaster_Status_TypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Transaction descriptor: optional write phase, then an optional read
+///         phase after a repeated START, then STOP. Owned by the caller until
+///         the callback runs.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _I2CMaster_Transfer {
+    u8                              Address;                                    ///< 7-bit slave address
+    u8                              Flags;                                      ///< I2CM_FLAG_xxx, 0 for none
+    const u8*                       TxData;
+    u16                             TxLength;
+    u8*                             RxData;
+    u16                             RxLength;
+    void (*Callback)(struct _I2CMaster_Transfer* xfer);                         ///< Completion hook, runs in I2C1_IRQHandler
+    void*                           Context;                                    ///< Free for the caller
+    volatile I2CMaster_Status_TypeDef Status;
+    struct _I2CMaster_Transfer*     Next;                                       ///< Queue link, driver private
+} I2CMaster_TransferTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Per-instance master state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    I2C_TypeDef*                    I2C;
+    I2CMaster_TransferTypeDef*      Head;                                       ///< Active transfer
+    I2CMaster_TransferTypeDef*      Tail;
+    u8                              Target;                                     ///< Address in IC_TAR, 0xFF if unknown
+    const u8*                       TxData;                                     ///< Bus transaction in progress: the head
+    u16                             TxLength;                                   ///< transfer or an acknowledge poll
+    u8*                             RxData;
+    u16                             RxLength;
+    u16                             TxIndex;                                    ///< Write bytes pushed
+    u16                             CmdIndex;                                   ///< Read commands pushed
+    u16                             RxIndex;                                    ///< Read bytes received
+    bool                            Aborted;
+    bool                            Stopping;                                   ///< STOP requested, waiting for idle
+    bool                            UseDMA;                                     ///< Bulk transfers enabled, I2CMaster_DMACmd
+    bool                            DMAActive;                                  ///< Channels own the FIFOs
+    bool                            Polling;                                    ///< Acknowledge polling after a write
+    u16                             Polls;
+    u8                              PollByte;
+    u32                             Completed;                                  ///< Statistics
+    u32                             Aborts;
+    u32                             Bursts;                                     ///< Transactions moved by DMA
+} I2CMaster_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_MASTER_Exported_Functions
+/// @{
+
+void I2CMaster_Init(I2CMaster_TypeDef* master, I2C_TypeDef* i2c, u32 clock_speed);
+ErrorStatus I2CMaster_Submit(I2CMaster_TypeDef* master, I2CMaster_TransferTypeDef* xfer);
+void I2CMaster_DMACmd(I2CMaster_TypeDef* master, FunctionalState state);
+bool I2CMaster_IsBusy(I2CMaster_TypeDef* master);
+void I2CMaster_Reset(I2CMaster_TypeDef* master);
+void I2CMaster_IRQHandler(I2CMaster_TypeDef* master);
+void I2CMaster_DMAIRQHandler(I2CMaster_TypeDef* master);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __I2C_MASTER_H
+////////////////////////////////////////////////////////////////////////////////
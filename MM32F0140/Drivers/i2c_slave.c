@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2c_slave.c
+/// @brief    THIS FILE PROVIDES THE I2C SLAVE REGISTER-MAP ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The controller answers up to I2C_SLAVE_MAX_ADDRESSES addresses. IC_SAR
+/// holds the first one, and SLVMASK excludes every bit in which the
+/// addresses differ. SLVRCVADDR then tells which address was matched.
+/// Addresses that the mask lets through but that have no map read as 0xFF,
+/// and writes to them are dropped (Strays).
+///
+/// Write:  S addr+W reg data0 data1 ... P    sets the pointer, stores the data
+/// Read:   S addr+R data0 data1 ... NACK P   reads from the pointer
+/// Both directions auto-increment the pointer per map, wrapping at Count.
+///
+/// Reads run in bulk-transfer mode. RD_REQ fills the whole TX FIFO. From
+/// then on, TX_EMPTY at half FIFO keeps it topped up, and the controller
+/// only stretches the clock for the first byte. The bus rate is set at
+/// init, up to 1 MHz Fm+: there one byte is 9 us, i.e. 648 cycles at
+/// 72 MHz, which is the refill deadline; one register costs about
+/// 40 cycles. When the master NACKs (RX_DONE), the bytes still in the FIFO
+/// were never sent, so the pointer is wound back by IC_TXFLR. The
+/// controller flushes them at the next read. A callback register's Read
+/// hook therefore runs up to I2C_SLAVE_FIFO_DEPTH registers ahead of the
+/// master: keep clear-on-read side effects in Write hooks or at the end of
+/// a register block.
+///
+/// The application forwards the vector:
+///   void I2C1_IRQHandler(void) { I2CSlave_IRQHandler(&i2c1_slave); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _I2C_SLAVE_C_
+
+// Files includes
+#include "i2c_slave.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup I2C_SLAVE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Selects the map for the address the controller last matched.
+/// @param  slave: pointer to the slave state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CSlave_Lookup(I2CSlave_TypeDef* slave)
+{
+    u8 address = (u8)(I2C_GetSlaveReceivedAddr(slave->I2C) & 0x7F);
+    u8 i;
+
+    slave->Active = -1;
+    for (i = 0; i < slave->MapCount; i++) {
+        if (slave->Maps[i]->Address == address) {
+            slave->Active = (s8)i;
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the register following reg, wrapping at the map size.
+/// @param  map: register map.
+/// @param  reg: register index.
+/// @retval Next register index.
+////////////////////////////////////////////////////////////////////////////////
+static u8 I2CSlave_Next(const I2CSlave_MapTypeDef* map, u8 reg)
+{
+    return ((u16)(reg + 1) < map->Count) ? (u8)(reg + 1) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Loads register data into the TX FIFO until it is full.
+/// @param  slave: pointer to the slave state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CSlave_Fill(I2CSlave_TypeDef* slave)
+{
+    I2C_TypeDef* i2c = slave->I2C;
+    const I2CSlave_MapTypeDef* map;
+    u8 reg, value;
+
+    if (slave->Active < 0) {
+        while (i2c->IC_STATUS & I2C_SR_TFNF) {
+            i2c->IC_DATA_CMD = 0xFF;
+            slave->Strays++;
+        }
+        return;
+    }
+    map = slave->Maps[slave->Active];
+    reg = slave->Cursor;
+    while (i2c->IC_STATUS & I2C_SR_TFNF) {
+        if ((map->Access != NULL) && (map->Access[reg] == I2CS_Reg_Callback)) {
+            value = (map->Read != NULL) ? map->Read(map, reg) : 0xFF;
+        }
+        else {
+            value = map->Regs[reg];
+        }
+        i2c->IC_DATA_CMD = value;
+        reg = I2CSlave_Next(map, reg);
+        slave->Reads++;
+    }
+    slave->Cursor = reg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Ends a read: the pointer is wound back over the bytes that are
+///         still in the TX FIFO and were never clocked out.
+/// @param  slave: pointer to the slave state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CSlave_EndRead(I2CSlave_TypeDef* slave)
+{
+    I2C_TypeDef* i2c = slave->I2C;
+    const I2CSlave_MapTypeDef* map;
+    u32 unsent;
+    u8 reg;
+
+    slave->First = true;
+    if (!slave->Reading) {
+        return;
+    }
+    slave->Reading = false;
+    i2c->IC_INTR_MASK &= ~I2C_IT_TX_EMPTY;
+
+    unsent = i2c->IC_TXFLR;
+    if (slave->Active < 0) {
+        slave->Strays -= unsent;
+        return;
+    }
+    map = slave->Maps[slave->Active];
+    reg = slave->Cursor;
+    slave->Reads -= unsent;
+    while (unsent--) {
+        reg = (reg != 0) ? (u8)(reg - 1) : (u8)(map->Count - 1);
+    }
+    slave->Pointer[slave->Active] = reg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Handles written bytes: the first one after the address sets the
+///         register pointer, the following ones are stored.
+/// @param  slave: pointer to the slave state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void I2CSlave_Drain(I2CSlave_TypeDef* slave)
+{
+    I2C_TypeDef* i2c = slave->I2C;
+    const I2CSlave_MapTypeDef* map;
+    u8 value, reg;
+
+    while (i2c->IC_STATUS & I2C_SR_RFNE) {
+        value = (u8)i2c->IC_DATA_CMD;
+        if (slave->First) {
+            I2CSlave_Lookup(slave);
+        }
+        if (slave->Active < 0) {
+            slave->First = false;
+            slave->Strays++;
+            continue;
+        }
+        map = slave->Maps[slave->Active];
+        if (slave->First) {
+            slave->First = false;
+            slave->Pointer[slave->Active] = (value < map->Count) ? value : (u8)(value % map->Count);
+            continue;
+        }
+
+        reg = slave->Pointer[slave->Active];
+        if ((map->Access == NULL) || (map->Access[reg] == I2CS_Reg_RW)) {
+            map->Regs[reg] = value;
+        }
+        else if ((map->Access[reg] == I2CS_Reg_Callback) && (map->Write != NULL)) {
+            map->Write(map, reg, value);
+        }
+        slave->Pointer[slave->Active] = I2CSlave_Next(map, reg);
+        slave->Writes++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Initializes an I2C instance as slave answering the addresses of
+///         the given maps. Pins are left to the caller.
+/// @param  slave: pointer to the slave state.
+/// @param  i2c: I2C1.
+/// @param  maps: array of count register maps, must stay valid.
+/// @param  count: 1 to I2C_SLAVE_MAX_ADDRESSES.
+/// @param  clock_speed: SCL frequency the master runs in Hz, up to 1000000.
+/// @retval ERROR on an invalid map list or bus rate.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus I2CSlave_Init(I2CSlave_TypeDef* slave, I2C_TypeDef* i2c, const I2CSlave_MapTypeDef* const* maps, u8 count,
+                          u32 clock_speed)
+{
+    I2C_InitTypeDef i2c_init;
+    u32 setup_ns;
+    u16 mask = 0x7F;
+    u8 i;
+
+    if ((count == 0) || (count > I2C_SLAVE_MAX_ADDRESSES) || (clock_speed == 0) || (clock_speed > 1000000)) {
+        return ERROR;
+    }
+    for (i = 0; i < count; i++) {
+        if ((maps[i]->Count == 0) || (maps[i]->Count > 256) || (maps[i]->Address > 0x7F)) {
+            return ERROR;
+        }
+        mask &= ~(maps[i]->Address ^ maps[0]->Address);
+        slave->Maps[i]    = maps[i];
+        slave->Pointer[i] = 0;
+    }
+    slave->I2C       = i2c;
+    slave->MapCount  = count;
+    slave->Active    = -1;
+    slave->First     = true;
+    slave->Reading   = false;
+    slave->Cursor    = 0;
+    slave->Reads     = 0;
+    slave->Writes    = 0;
+    slave->Strays    = 0;
+    slave->Underruns = 0;
+
+    RCC_APB1PeriphClockCmd(RCC_APB1ENR_I2C1, ENABLE);
+
+    I2C_StructInit(&i2c_init);
+    i2c_init.I2C_Mode       = 0;
+    i2c_init.I2C_Speed      = (clock_speed > 100000) ? I2C_CR_FAST : I2C_CR_STD;
+    i2c_init.I2C_ClockSpeed = clock_speed;
+    I2C_Init(i2c, &i2c_init);
+    // As transmitter, the slave drives SDA IC_SDA_SETUP clocks before
+    // releasing a stretched SCL: tSU;DAT is 250 ns standard, 100 ns fast and
+    // 50 ns Fm+. This controller has no spike-length register, so spike
+    // suppression stays at its fixed filter.
+    setup_ns = (clock_speed > 400000) ? 50 : (clock_speed > 100000) ? 100 : 250;
+    i2c->IC_SDA_SETUP = (RCC_GetPCLK1Freq() / 1000000 * setup_ns + 999) / 1000 + 1;
+    // TX_EMPTY as soon as the FIFO is at the threshold, not after the shift
+    // register drains; STOP_DET only when this slave was addressed.
+    i2c->IC_CON = (i2c->IC_CON & ~I2C_CR_EMPINT) | I2C_CR_STOPINT;
+    i2c->IC_SAR = maps[0]->Address;
+    I2C_SlaveReceivedAddressMask(i2c, mask);
+    i2c->IC_RX_TL = 0;
+    i2c->IC_TX_TL = I2C_SLAVE_FIFO_DEPTH / 2;
+    (void)i2c->IC_CLR_INTR;
+    i2c->IC_INTR_MASK = I2C_IT_RX_FULL | I2C_IT_RD_REQ | I2C_IT_RX_DONE | I2C_IT_TX_ABRT | I2C_IT_STOP_DET;
+    I2C_Cmd(i2c, ENABLE);
+
+    // Highest priority: the controller stretches SCL until RD_REQ is served.
+    DRV_NVICEnable(I2C1_IRQn, 0);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  I2C interrupt service for the register map.
+/// @param  slave: pointer to the slave state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2CSlave_IRQHandler(I2CSlave_TypeDef* slave)
+{
+    I2C_TypeDef* i2c = slave->I2C;
+    u32 status = i2c->IC_INTR_STAT;
+
+    if (status & I2C_IT_TX_ABRT) {
+        // The controller holds the TX FIFO flushed until the abort is
+        // cleared, so clear it before RD_REQ preloads the next read.
+        (void)i2c->IC_CLR_TX_ABRT;
+    }
+    if (status & I2C_IT_RX_FULL) {
+        I2CSlave_Drain(slave);
+    }
+    if (status & I2C_IT_RD_REQ) {
+        (void)i2c->IC_CLR_RD_REQ;
+        if (slave->Reading) {
+            // The FIFO ran dry in the middle of a read.
+            slave->Underruns++;
+        }
+        else {
+            I2CSlave_Lookup(slave);
+            slave->Cursor  = (slave->Active < 0) ? 0 : slave->Pointer[slave->Active];
+            slave->Reading = true;
+            i2c->IC_INTR_MASK |= I2C_IT_TX_EMPTY;
+        }
+        I2CSlave_Fill(slave);
+    }
+    else if ((status & I2C_IT_TX_EMPTY) && slave->Reading) {
+        I2CSlave_Fill(slave);
+    }
+    if (status & I2C_IT_RX_DONE) {
+        (void)i2c->IC_CLR_RX_DONE;
+        I2CSlave_EndRead(slave);
+    }
+    if (status & I2C_IT_STOP_DET) {
+        (void)i2c->IC_CLR_STOP_DET;
+        I2CSlave_Drain(slave);
+        I2CSlave_EndRead(slave);
+    }
+}
+
+/// @}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2c_slave.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE I2C
+///           SLAVE REGISTER-MAP ENGINE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __I2C_SLAVE_H
+#define __I2C_SLAVE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_SLAVE
+/// @brief I2C slave register-map engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_SLAVE_Exported_Constants
+/// @{
+
+#define I2C_SLAVE_MAX_ADDRESSES     (4U)                                        ///< Register maps per instance
+#define I2C_SLAVE_FIFO_DEPTH        (2U)                                        ///< TX FIFO entries preloaded on a read
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_SLAVE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Register access enum definition
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    I2CS_Reg_RW,                                                                ///< Read from and written to Regs
+    I2CS_Reg_RO,                                                                ///< Writes are dropped
+    I2CS_Reg_Callback                                                           ///< Read and Write hooks, Regs unused
+} I2CSlave_Access_TypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Register map answering one slave address. The register pointer is
+///         set by the first byte of a write and auto-increments (wrapping at
+///         Count) on every byte read or written.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _I2CSlave_Map {
+    u8                              Address;                                    ///< 7-bit slave address
+    u16                             Count;                                      ///< Registers, 1 to 256
+    u8*                             Regs;                                       ///< Count bytes of register storage
+    const u8*                       Access;                                     ///< Count I2CSlave_Access_TypeDef, NULL = all RW
+    u8 (*Read)(const struct _I2CSlave_Map* map, u8 reg);                        ///< Callback registers, may run ahead, see i2c_slave.c
+    void (*Write)(const struct _I2CSlave_Map* map, u8 reg, u8 value);           ///< Callback registers
+    void*                           Context;                                    ///< Free for the caller
+} I2CSlave_MapTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Per-instance slave state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    I2C_TypeDef*                    I2C;
+    const I2CSlave_MapTypeDef*      Maps[I2C_SLAVE_MAX_ADDRESSES];
+    u8                              Pointer[I2C_SLAVE_MAX_ADDRESSES];           ///< Register pointer of each map
+    u8                              MapCount;
+    s8                              Active;                                     ///< Addressed map, -1 if none
+    bool                            First;                                      ///< Next written byte is the pointer
+    bool                            Reading;                                    ///< TX FIFO holds register data
+    u8                              Cursor;                                     ///< Next register to preload
+    u32                             Reads;                                      ///< Statistics, bytes
+    u32                             Writes;
+    u32                             Strays;                                     ///< Bytes for an address without a map
+    u32                             Underruns;                                  ///< RD_REQ with the read already running
+} I2CSlave_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2C_SLAVE_Exported_Functions
+/// @{
+
+ErrorStatus I2CSlave_Init(I2CSlave_TypeDef* slave, I2C_TypeDef* i2c, const I2CSlave_MapTypeDef* const* maps, u8 count,
+                          u32 clock_speed);
+void I2CSlave_IRQHandler(I2CSlave_TypeDef* slave);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __I2C_SLAVE_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2s_stream.c
+/// @brief    THIS FILE PROVIDES THE I2S STREAMING ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// One DMA channel runs in circular mode over a double buffer; the half and
+/// full transfer interrupts hand the half the DMA just left to the callback.
+/// At 48 kHz stereo with HalfSamples = 192 that is one interrupt per 2 ms.
+///   capture:  SPI1 RX = DMA1_Channel2, SPI2 RX = DMA1_Channel4
+///   playback: SPI1 TX = DMA1_Channel3, SPI2 TX = DMA1_Channel5
+/// The application forwards the DMA vector, e.g.
+///   void DMA1_Channel4_5_IRQHandler(void) { I2sStream_DMAIRQHandler(&stream); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _I2S_STREAM_C_
+
+// Files includes
+#include "i2s_stream.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup I2S_STREAM
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default stream settings: SPI2 master capture, Philips,
+///         16-bit, 48 kHz.
+/// @param  init_struct: pointer to an I2sStream_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2sStream_StructInit(I2sStream_InitTypeDef* init_struct)
+{
+    init_struct->SPI         = SPI2;
+    init_struct->Mode        = I2S_Mode_MasterRx;
+    init_struct->Standard    = I2S_Standard_Phillips;
+    init_struct->DataFormat  = I2S_DataFormat_16b;
+    init_struct->AudioFreq   = I2S_AudioFreq_48k;
+    init_struct->MCLKOutput  = false;
+    init_struct->Buffer      = NULL;
+    init_struct->HalfSamples = 0;
+    init_struct->Callback    = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures the SPI in I2S mode and prepares the DMA channel. The
+///         stream does not run until I2sStream_Start.
+/// @param  stream: pointer to the stream state.
+/// @param  init_struct: pointer to an I2sStream_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2sStream_Init(I2sStream_TypeDef* stream, const I2sStream_InitTypeDef* init_struct)
+{
+    I2S_InitTypeDef i2s_init;
+    SPI_TypeDef* spi = init_struct->SPI;
+    bool rx = (init_struct->Mode == I2S_Mode_MasterRx) || (init_struct->Mode == I2S_Mode_SlaveRx);
+
+    stream->SPI         = spi;
+    stream->Buffer      = (u8*)init_struct->Buffer;
+    stream->HalfSamples = init_struct->HalfSamples;
+    stream->SampleBytes = (init_struct->DataFormat == I2S_DataFormat_16b) ? 2 : 4;
+    stream->Callback    = init_struct->Callback;
+    stream->Halves      = 0;
+    stream->Late        = 0;
+    stream->Errors      = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    if (spi == SPI1) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_SPI1, ENABLE);
+        stream->Channel = rx ? DMA1_Channel2 : DMA1_Channel3;
+    }
+    else {
+        RCC_APB1PeriphClockCmd(RCC_APB1ENR_SPI2, ENABLE);
+        stream->Channel = rx ? DMA1_Channel4 : DMA1_Channel5;
+    }
+
+    i2s_init.I2S_Mode       = init_struct->Mode;
+    i2s_init.I2S_Standard   = init_struct->Standard;
+    i2s_init.I2S_DataFormat = init_struct->DataFormat;
+    i2s_init.I2S_AudioFreq  = init_struct->AudioFreq;
+    i2s_init.I2S_MCLKOutput = init_struct->MCLKOutput ? I2S_MCLKOutput_Enable : I2S_MCLKOutput_Disable;
+    i2s_init.I2S_CPOL       = I2S_CPOL_Low;
+    I2S_Init(spi, &i2s_init);
+    SPI_DataSizeTypeConfig(spi, (stream->SampleBytes == 4) ? SPI_DataSize_32b : SPI_DataSize_8b);
+
+    DRV_NVICEnable((stream->Channel == DMA1_Channel2) || (stream->Channel == DMA1_Channel3) ?
+                   DMA1_Channel2_3_IRQn : DMA1_Channel4_5_IRQn, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts streaming. For playback the whole buffer must already hold
+///         valid samples (or silence).
+/// @param  stream: pointer to the stream state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2sStream_Start(I2sStream_TypeDef* stream)
+{
+    bool tx = (stream->Channel == DMA1_Channel3) || (stream->Channel == DMA1_Channel5);
+    u32 ccr = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_VeryHigh;
+
+    ccr |= (stream->SampleBytes == 4) ? (DMA_CCR_MSIZE_WORD | DMA_CCR_PSIZE_WORD) : (DMA_CCR_MSIZE_HALFWORD | DMA_CCR_PSIZE_WORD);
+    ccr |= tx ? DMA_CCR_DIR : 0;
+    DRV_DMAStart(stream->Channel, ccr, tx ? (u32)&stream->SPI->TDR : (u32)&stream->SPI->RDR,
+                 (u32)stream->Buffer, (u16)(stream->HalfSamples * 2));
+
+    if (!tx) {
+        while (SPI_GetFlagStatus(stream->SPI, SPI_FLAG_RXAVL)) {
+            (void)SPI_ReceiveData(stream->SPI);
+        }
+    }
+    SPI_DMACmd(stream->SPI, ENABLE);
+    I2S_Cmd(stream->SPI, ENABLE);
+    SPI_Cmd(stream->SPI, ENABLE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stops streaming after the current sample.
+/// @param  stream: pointer to the stream state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2sStream_Stop(I2sStream_TypeDef* stream)
+{
+    SPI_Cmd(stream->SPI, DISABLE);
+    SPI_DMACmd(stream->SPI, DISABLE);
+    stream->Channel->CCR = 0;
+    DMA1->IFCR = DMA_CHANNEL_FLAGS(stream->Channel, DMAx_FLAG_GLy | DMAx_FLAG_TCy | DMAx_FLAG_HTy | DMAx_FLAG_TEy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service: delivers the half the DMA just finished.
+///         Only this stream's flags are read and cleared.
+/// @param  stream: pointer to the stream state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void I2sStream_DMAIRQHandler(I2sStream_TypeDef* stream)
+{
+    u32 isr = DMA1->ISR & DMA_CHANNEL_FLAGS(stream->Channel, 0x0F);
+    u32 ht  = DMA_CHANNEL_FLAGS(stream->Channel, DMAx_FLAG_HTy);
+    u32 tc  = DMA_CHANNEL_FLAGS(stream->Channel, DMAx_FLAG_TCy);
+    u32 half_bytes = (u32)stream->HalfSamples * stream->SampleBytes;
+
+    if (isr == 0) {
+        return;
+    }
+    DMA1->IFCR = isr;
+
+    if (isr & DMA_CHANNEL_FLAGS(stream->Channel, DMAx_FLAG_TEy)) {
+        stream->Errors++;
+        return;
+    }
+    if ((isr & ht) && (isr & tc)) {
+        // Serviced a whole buffer late: the current position tells which
+        // half is safe, the other one is already being overwritten.
+        stream->Late++;
+        isr &= (stream->Channel->CNDTR > stream->HalfSamples) ? ~ht : ~tc;
+    }
+    if (isr & ht) {
+        stream->Halves++;
+        if (stream->Callback != NULL) {
+            stream->Callback(stream, stream->Buffer, stream->HalfSamples);
+        }
+    }
+    if (isr & tc) {
+        stream->Halves++;
+        if (stream->Callback != NULL) {
+            stream->Callback(stream, stream->Buffer + half_bytes, stream->HalfSamples);
+        }
+    }
+}
+
+/// @}
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     i2s_stream.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE I2S
+///           STREAMING ENGINE (CIRCULAR DMA, HALF-BUFFER CALLBACKS).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __I2S_STREAM_H
+#define __I2S_STREAM_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2S_STREAM
+/// @brief I2S streaming engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2S_STREAM_Exported_Types
+/// @{
+
+struct _I2sStream;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Half-buffer hook, runs in the DMA interrupt. For capture the half
+///         holds fresh samples; for playback it must be refilled before the
+///         DMA wraps back to it. Samples are interleaved left/right, s16 for
+///         16-bit formats and s32 for the others.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*I2sStream_Callback)(struct _I2sStream* stream, void* half, u16 samples);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  I2S stream init structure definition. Pins are left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    SPI_TypeDef*                    SPI;                                        ///< SPI1 or SPI2
+    SPI_I2S_TRANS_MODE_TypeDef      Mode;                                       ///< Master/slave, TX (playback) or RX (capture)
+    SPI_I2S_STANDARD_TypeDef        Standard;
+    SPI_I2S_DATAFORMAT_TypeDef      DataFormat;                                 ///< I2S_DataFormat_16b or a 32-bit slot format
+    SPI_I2S_AUDIO_FREQ_TypeDef      AudioFreq;
+    bool                            MCLKOutput;
+    void*                           Buffer;                                     ///< Two halves of HalfSamples samples
+    u16                             HalfSamples;                                ///< Samples per half, both channels counted
+    I2sStream_Callback              Callback;
+} I2sStream_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  I2S stream state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _I2sStream {
+    SPI_TypeDef*                    SPI;
+    DMA_Channel_TypeDef*            Channel;
+    u8*                             Buffer;
+    u16                             HalfSamples;
+    u8                              SampleBytes;                                ///< 2 or 4
+    I2sStream_Callback              Callback;
+    u32                             Halves;                                     ///< Half-buffers delivered
+    u32                             Late;                                       ///< Both halves pending at once: a half was missed
+    u32                             Errors;                                     ///< DMA transfer errors
+} I2sStream_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup I2S_STREAM_Exported_Functions
+/// @{
+
+void I2sStream_StructInit(I2sStream_InitTypeDef* init_struct);
+void I2sStream_Init(I2sStream_TypeDef* stream, const I2sStream_InitTypeDef* init_struct);
+void I2sStream_Start(I2sStream_TypeDef* stream);
+void I2sStream_Stop(I2sStream_TypeDef* stream);
+void I2sStream_DMAIRQHandler(I2sStream_TypeDef* stream);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __I2S_STREAM_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,421 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     ic_measure.c
+/// @brief    THIS FILE PROVIDES THE INPUT CAPTURE MEASUREMENT ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// CH1 is captured in PWM input mode: CC1 on the rising edge, CC2 on the
+/// falling edge, and the counter is reset by each rising edge. A CC1 DMA
+/// burst of two (DCR at CCR1) then stores {period, high time} of the
+/// previous cycle into a circular ring, with no interrupt per cycle.
+/// IcMeasure_Process reduces everything captured since its last call into
+/// frequency, mean period, duty and period jitter (RMS and peak), and
+/// picks the range for the next batch:
+///   - Direct: one capture per cycle, for spans of MinTicks and up.
+///   - Reciprocal: when a cycle is shorter than MinTicks, the input is
+///     prescaled with TIM_SetIC1Prescaler to one capture per 2, 4 or 8
+///     cycles. The reset trigger precedes the prescaler, so the counter
+///     runs free, and spans are differences of timestamps. They add up
+///     without loss, so a batch is counted like a reciprocal counter:
+///     resolution is one clock over the whole batch. Duty is not measured.
+///   - Extended: a cycle longer than the counter range (0.9 ms for a
+///     16-bit timer at 72 MHz) shows up as an update event. Those inputs
+///     are slow enough for per-cycle interrupts, which add the counted
+///     wraps to the captures.
+/// Going back to fewer cycles per capture needs twice MinTicks, so the
+/// range does not toggle at a boundary.
+///
+/// With MinTicks = 1000 at 72 MHz, the direct range covers 1.1 kHz to
+/// 72 kHz at 0.1 % per cycle or better. Each capture costs two DMA
+/// transfers, and Process about 40 cycles per capture. In reciprocal mode,
+/// a sudden drop below clock / 65536 is caught by the update interrupt (a
+/// whole wrap without a capture). A drop that lands just over one wrap can
+/// give one wrong batch.
+///
+/// CC1 requests: TIM1 = DMA1_Channel2, TIM2 = DMA1_Channel5,
+/// TIM3 = DMA1_Channel4. The application forwards the vectors, e.g.
+///   void TIM3_IRQHandler(void) { IcMeasure_IRQHandler(&icm); }
+///   void DMA1_Channel4_5_IRQHandler(void) { IcMeasure_DMAIRQHandler(&icm); }
+/// TIM1 needs both TIM1_CC_IRQHandler and TIM1_BRK_UP_TRG_COM_IRQHandler.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _IC_MEASURE_C_
+
+// Files includes
+#include "ic_measure.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup IC_MEASURE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Adds counted wraps to a capture. The range is 2^32 for TIM2, so
+///         the sum is formed in 64 bits and saturates at the u32 result.
+/// @param  wraps: counter wraps before the capture.
+/// @param  range: counter range, Mask + 1.
+/// @param  ccr: captured counter value.
+/// @retval Timer clocks.
+////////////////////////////////////////////////////////////////////////////////
+static u32 IcMeasure_Extend(u32 wraps, u64 range, u32 ccr)
+{
+    u64 ticks = wraps * range + ccr;
+
+    return (ticks > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32)ticks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the capture range and restarts the ring.
+/// @param  icm: pointer to the measurement state.
+/// @param  mode: new range.
+/// @param  prescaler: input cycles per capture, 1, 2, 4 or 8.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void IcMeasure_SetMode(IcMeasure_TypeDef* icm, IcMeasure_ModeTypeDef mode, u8 prescaler)
+{
+    TIM_TypeDef* tim = icm->Timer;
+    u32 ccr = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_TCIE | DMA_CCR_PSIZE_WORD | DMA_CCR_MSIZE_WORD | DMA_CCR_PL_High;
+
+    TIM_DMACmd(tim, TIM_DMA_CC1, DISABLE);
+    TIM_ITConfig(tim, TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2, DISABLE);
+    icm->Channel->CCR = 0;
+
+    // The reset trigger comes before the input prescaler and would restart
+    // the counter on every cycle: reciprocal counting runs free.
+    tim->SMCR = (tim->SMCR & ~TIM_SMCR_SMS) | ((mode == IcMeasure_Reciprocal) ? TIM_SMCR_SMS_OFF : TIM_SMCR_SMS_RESET);
+    TIM_SetIC1Prescaler(tim, (prescaler == 8) ? TIM_ICPSC_DIV8 :
+                             (prescaler == 4) ? TIM_ICPSC_DIV4 :
+                             (prescaler == 2) ? TIM_ICPSC_DIV2 : TIM_ICPSC_DIV1);
+
+    icm->Mode       = mode;
+    icm->Prescaler  = prescaler;
+    icm->Primed     = false;
+    icm->Laps       = 0;
+    icm->Head       = 0;
+    icm->Tail       = 0;
+    icm->Overflows  = 0;
+    icm->High       = 0;
+    icm->WrapCount  = (u16)(icm->RingSize * 2);
+    icm->Overflowed = false;
+    icm->Switches++;
+
+    (void)tim->CCR1;
+    (void)tim->CCR2;
+    tim->SR = 0;
+    if (mode == IcMeasure_Extended) {
+        TIM_ITConfig(tim, TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2, ENABLE);
+        return;
+    }
+    DRV_DMAStart(icm->Channel, ccr, (u32)&tim->DMAR, (u32)icm->Ring, (u16)(icm->RingSize * 2));
+    TIM_DMACmd(tim, TIM_DMA_CC1, ENABLE);
+    TIM_ITConfig(tim, TIM_IT_Update, ENABLE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the number of captures written since the last mode
+///         change, counting a DMA wrap the interrupt has not seen yet.
+/// @param  icm: pointer to the measurement state.
+/// @retval Captures written.
+////////////////////////////////////////////////////////////////////////////////
+static u32 IcMeasure_Head(IcMeasure_TypeDef* icm)
+{
+    u32 laps, items, tc;
+
+    if (icm->Mode == IcMeasure_Extended) {
+        return icm->Head;
+    }
+    do {
+        laps  = icm->Laps;
+        items = (u32)icm->RingSize * 2 - icm->Channel->CNDTR;
+        tc    = DMA1->ISR & DMA_CHANNEL_FLAGS(icm->Channel, DMAx_FLAG_TCy);
+    } while (laps != icm->Laps);
+    if (tc && (items < icm->RingSize)) {
+        laps++;
+    }
+    return laps * icm->RingSize + (items >> 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the fewest cycles per capture that span min_ticks.
+/// @param  cycle: clocks per input cycle.
+/// @param  min_ticks: shortest wanted capture span.
+/// @retval 1, 2, 4 or 8.
+////////////////////////////////////////////////////////////////////////////////
+static u8 IcMeasure_Prescaler(u32 cycle, u32 min_ticks)
+{
+    u8 n = 1;
+
+    while ((n < 8) && ((u64)cycle * n < min_ticks)) {
+        n <<= 1;
+    }
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default measurement settings: TIM3, 1000 clocks per
+///         capture at least, no input filter.
+/// @param  init_struct: pointer to an IcMeasure_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void IcMeasure_StructInit(IcMeasure_InitTypeDef* init_struct)
+{
+    init_struct->Timer    = TIM3;
+    init_struct->Ring     = NULL;
+    init_struct->RingSize = 0;
+    init_struct->MinTicks = 1000;
+    init_struct->Filter   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures CH1 in PWM input mode with the counter at its full
+///         clock and starts capturing in the direct range.
+/// @param  icm: pointer to the measurement state.
+/// @param  init_struct: pointer to an IcMeasure_InitTypeDef structure.
+/// @retval ERROR on invalid parameters or an unsupported timer.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus IcMeasure_Init(IcMeasure_TypeDef* icm, const IcMeasure_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_ICInitTypeDef ic_init;
+    TIM_TypeDef* tim = init_struct->Timer;
+
+    if (((tim != TIM1) && (tim != TIM2) && (tim != TIM3)) || (init_struct->Ring == NULL) ||
+        (init_struct->RingSize < 4) || (init_struct->RingSize > 0x7FFF) || (init_struct->MinTicks == 0)) {
+        return ERROR;
+    }
+    icm->Clock = DRV_TimerClock(tim);
+    if (icm->Clock == 0) {
+        return ERROR;
+    }
+    icm->Timer    = tim;
+    icm->Channel  = DRV_TimerDMAChannel(tim, TIM_DMA_CC1);
+    icm->Ring     = init_struct->Ring;
+    icm->RingSize = init_struct->RingSize;
+    icm->MinTicks = init_struct->MinTicks;
+    icm->Overruns = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = 0xFFFFFFFF;
+    TIM_TimeBaseInit(tim, &tim_init);
+    icm->Mask = tim->ARR;
+    // Slave resets must not raise the update flag: it only flags a wrap.
+    TIM_UpdateRequestConfig(tim, TIM_UpdateSource_Regular);
+
+    TIM_ICStructInit(&ic_init);
+    ic_init.TIM_Channel     = TIM_Channel_1;
+    ic_init.TIM_ICPolarity  = TIM_ICPolarity_Rising;
+    ic_init.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    ic_init.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    ic_init.TIM_ICFilter    = init_struct->Filter;
+    TIM_PWMIConfig(tim, &ic_init);
+    TIM_SelectInputTrigger(tim, TIM_TS_TI1FP1);
+    TIM_DMAConfig(tim, TIM_DMABase_CCR1, TIM_DMABurstLength_2Bytes);
+
+    DRV_NVICEnable(DRV_TimerIRQn(tim), 1);
+    if (tim == TIM1) {
+        DRV_NVICEnable(TIM1_CC_IRQn, 1);
+    }
+    DRV_NVICEnable(DRV_DMAIRQn(icm->Channel), 1);
+
+    IcMeasure_SetMode(icm, IcMeasure_Direct, 1);
+    icm->Switches = 0;
+    TIM_Cmd(tim, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reduces the captures since the previous call, then adjusts the
+///         range. Call it at least once per RingSize captures; older
+///         captures are dropped and counted in Overruns.
+/// @param  icm: pointer to the measurement state.
+/// @param  result: receives the statistics.
+/// @retval ERROR if no complete cycle was captured (no input, or the range
+///         has just changed).
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus IcMeasure_Process(IcMeasure_TypeDef* icm, IcMeasure_ResultTypeDef* result)
+{
+    IcMeasure_CaptureTypeDef* c;
+    u32 head = IcMeasure_Head(icm);
+    u32 size = icm->RingSize;
+    u32 n = 0, ref = 0, min = 0xFFFFFFFF, max = 0;
+    u32 span, pos, mean, cycle, laps;
+    u64 ticks = 0, high = 0, sq = 0, var, rms, scale;
+    s64 dev = 0, mdev;
+    s32 d;
+    u8 next, shift;
+
+    if (icm->Overflowed) {
+        // Spans in the ring were cut by a wrap: measure per cycle instead.
+        IcMeasure_SetMode(icm, IcMeasure_Extended, 1);
+        return ERROR;
+    }
+    if (head - icm->Tail > size - 1) {
+        // Keep clear of the entry the DMA may be writing.
+        icm->Overruns += head - icm->Tail - (size >> 1);
+        icm->Tail      = head - (size >> 1);
+        icm->Primed    = false;
+    }
+
+    pos = icm->Tail % size;
+    while (icm->Tail != head) {
+        c   = &icm->Ring[pos];
+        pos = (pos + 1 == size) ? 0 : pos + 1;
+        icm->Tail++;
+        if (icm->Mode == IcMeasure_Reciprocal) {
+            span           = (c->Period - icm->LastStamp) & icm->Mask;
+            icm->LastStamp = c->Period;
+        }
+        else {
+            span = c->Period;
+        }
+        // The first capture after a change closes a cycle that started
+        // before it.
+        if (!icm->Primed) {
+            icm->Primed = true;
+            continue;
+        }
+        if (n == 0) {
+            ref = span;
+        }
+        d      = (s32)(span - ref);
+        dev   += d;
+        sq    += (u64)((s64)d * d);
+        ticks += span;
+        high  += (icm->Mode == IcMeasure_Reciprocal) ? 0 : c->High;
+        min    = (span < min) ? span : min;
+        max    = (span > max) ? span : max;
+        n++;
+    }
+
+    // Keep the counters small so they never wrap.
+    laps = icm->Tail / size;
+    if (laps != 0) {
+        DRV_ENTER_CRITICAL();
+        if (icm->Mode == IcMeasure_Extended) {
+            icm->Head -= laps * size;
+        }
+        else {
+            icm->Laps -= laps;
+        }
+        icm->Tail -= laps * size;
+        DRV_EXIT_CRITICAL();
+    }
+
+    if ((n == 0) || (ticks == 0)) {
+        return ERROR;
+    }
+    scale = (u64)icm->Clock * icm->Prescaler;
+    result->Mode             = icm->Mode;
+    result->Prescaler        = icm->Prescaler;
+    result->Cycles           = n * icm->Prescaler;
+    result->FrequencyMilliHz = (u64)result->Cycles * icm->Clock * 1000 / ticks;
+    result->PeriodNs         = (u32)(ticks * 1000 / n * 1000000 / scale);
+    result->Duty             = (icm->Mode == IcMeasure_Reciprocal) ? IC_MEASURE_NO_DUTY :
+                               (u16)((high * 10000 + (ticks >> 1)) / ticks);
+    // Variance in 1/256 clock^2, for a sub-clock RMS, unless it would
+    // overflow.
+    shift = (sq < ((u64)1 << 55)) ? 4 : 0;
+    mdev  = dev * ((s64)1 << shift) / (s64)n;
+    var   = (sq << (2 * shift)) / n;
+    var   = (var > (u64)(mdev * mdev)) ? var - (u64)(mdev * mdev) : 0;
+    rms   = (u64)DRV_Sqrt(var) << (4 - shift);
+    result->JitterRmsNs = (u32)(rms * 62500000 / scale);
+    result->JitterPkNs  = (u32)((u64)(max - min) * 1000000000 / scale);
+
+    // Range for the next batch.
+    mean  = (u32)(ticks / n);
+    cycle = mean / icm->Prescaler;
+    if (icm->Mode == IcMeasure_Extended) {
+        if (mean <= (icm->Mask >> 1)) {
+            IcMeasure_SetMode(icm, IcMeasure_Direct, 1);
+        }
+    }
+    else {
+        next = IcMeasure_Prescaler(cycle, icm->MinTicks);
+        if (next < icm->Prescaler) {
+            next = IcMeasure_Prescaler(cycle, (u32)icm->MinTicks * 2);
+            next = (next < icm->Prescaler) ? next : icm->Prescaler;
+        }
+        if (next != icm->Prescaler) {
+            IcMeasure_SetMode(icm, (next == 1) ? IcMeasure_Direct : IcMeasure_Reciprocal, next);
+        }
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Timer interrupt service: flags wraps in the DMA ranges, and
+///         stores overflow-extended captures in the extended range. Only
+///         the enabled flags are read and cleared.
+/// @param  icm: pointer to the measurement state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void IcMeasure_IRQHandler(IcMeasure_TypeDef* icm)
+{
+    TIM_TypeDef* tim = icm->Timer;
+    u32 sr   = tim->SR & tim->DIER & (TIM_SR_UI | TIM_SR_CC1I | TIM_SR_CC2I);
+    u32 half = icm->Mask >> 1;
+    u64 range = (u64)icm->Mask + 1;
+    u32 ovf, ccr, pos;
+    u16 count;
+    bool before;
+
+    if (sr == 0) {
+        return;
+    }
+    tim->SR = ~sr;
+
+    if (icm->Mode != IcMeasure_Extended) {
+        // Direct: the counter restarts every cycle, so a wrap is a period
+        // beyond the range. Reciprocal: it runs free, and a whole wrap
+        // without a capture is a gap beyond the range.
+        count = (u16)icm->Channel->CNDTR;
+        if ((icm->Mode == IcMeasure_Direct) || (count == icm->WrapCount)) {
+            icm->Overflowed = true;
+        }
+        icm->WrapCount = count;
+        return;
+    }
+
+    // A wrap pending with a capture in the lower half came before the edge.
+    ovf = icm->Overflows;
+    if (sr & TIM_SR_CC2I) {
+        ccr       = tim->CCR2;
+        before    = (sr & TIM_SR_UI) && (ccr <= half);
+        icm->High = IcMeasure_Extend(ovf + (before ? 1 : 0), range, ccr);
+    }
+    if (sr & TIM_SR_CC1I) {
+        ccr    = tim->CCR1;
+        before = (sr & TIM_SR_UI) && (ccr <= half);
+        pos    = icm->Head % icm->RingSize;
+        icm->Ring[pos].Period = IcMeasure_Extend(ovf + (before ? 1 : 0), range, ccr);
+        icm->Ring[pos].High   = icm->High;
+        icm->Head++;
+        icm->Overflows = ((sr & TIM_SR_UI) && !before) ? 1 : 0;
+    }
+    else if (sr & TIM_SR_UI) {
+        icm->Overflows = ovf + 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service: counts the passes over the ring.
+/// @param  icm: pointer to the measurement state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void IcMeasure_DMAIRQHandler(IcMeasure_TypeDef* icm)
+{
+    u32 isr = DMA1->ISR & DMA_CHANNEL_FLAGS(icm->Channel, 0x0F);
+
+    if (isr == 0) {
+        return;
+    }
+    DMA1->IFCR = isr;
+    if (isr & DMA_CHANNEL_FLAGS(icm->Channel, DMAx_FLAG_TCy)) {
+        icm->Laps++;
+    }
+}
+
+/// @}
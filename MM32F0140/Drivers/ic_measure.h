@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     ic_measure.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE INPUT
+///           CAPTURE FREQUENCY AND DUTY MEASUREMENT ENGINE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __IC_MEASURE_H
+#define __IC_MEASURE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup IC_MEASURE
+/// @brief Input capture measurement engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup IC_MEASURE_Exported_Constants
+/// @{
+
+#define IC_MEASURE_NO_DUTY          (0xFFFFU)                                   ///< Duty not measured (reciprocal mode)
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup IC_MEASURE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Measurement ranges, from the slowest input to the fastest
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    IcMeasure_Extended,                                                         ///< Capture interrupts, periods over the counter range
+    IcMeasure_Direct,                                                           ///< Every cycle captured by DMA
+    IcMeasure_Reciprocal                                                        ///< One capture per 2/4/8 cycles, duty not measured
+} IcMeasure_ModeTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  One DMA burst: CCR1 then CCR2
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             Period;                                     ///< Timestamp in reciprocal mode
+    u32                             High;
+} IcMeasure_CaptureTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Measurement init structure definition. The input pin (CH1) is
+///         left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Timer;                                      ///< TIM1, TIM2 or TIM3
+    IcMeasure_CaptureTypeDef*       Ring;
+    u16                             RingSize;                                   ///< Captures in Ring, 4..32767
+    u16                             MinTicks;                                   ///< Shortest capture span before prescaling the input
+    u8                              Filter;                                     ///< Input filter, 0..15
+} IcMeasure_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Statistics over the captures since the previous call
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    IcMeasure_ModeTypeDef           Mode;
+    u8                              Prescaler;                                  ///< Input cycles per capture
+    u32                             Cycles;                                     ///< Input cycles measured
+    u64                             FrequencyMilliHz;
+    u32                             PeriodNs;                                   ///< Mean period
+    u16                             Duty;                                       ///< High time in 0.01 % steps, or IC_MEASURE_NO_DUTY
+    u32                             JitterRmsNs;                                ///< Standard deviation of the period
+    u32                             JitterPkNs;                                 ///< Longest minus shortest period
+} IcMeasure_ResultTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Measurement state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Timer;
+    DMA_Channel_TypeDef*            Channel;
+    IcMeasure_CaptureTypeDef*       Ring;
+    u16                             RingSize;
+    u16                             MinTicks;
+    u32                             Clock;                                      ///< Counter clock, Hz
+    u32                             Mask;                                       ///< Counter range - 1
+    IcMeasure_ModeTypeDef           Mode;
+    u8                              Prescaler;                                  ///< 1, 2, 4 or 8
+    bool                            Primed;                                     ///< LastStamp holds a valid capture
+    u32                             LastStamp;                                  ///< Reciprocal mode: previous capture
+    volatile u32                    Laps;                                       ///< DMA passes over Ring
+    volatile u32                    Head;                                       ///< Extended mode: captures written
+    u32                             Tail;                                       ///< Captures processed
+    volatile u32                    Overflows;                                  ///< Extended mode: wraps in the current cycle
+    volatile u32                    High;                                       ///< Extended mode: high time of the current cycle
+    volatile u16                    WrapCount;                                  ///< Reciprocal mode: CNDTR at the previous wrap
+    volatile bool                   Overflowed;                                 ///< DMA modes: a period or gap exceeded the range
+    u32                             Switches;                                   ///< Mode changes
+    u32                             Overruns;                                   ///< Captures lost to a full ring
+} IcMeasure_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup IC_MEASURE_Exported_Functions
+/// @{
+
+void IcMeasure_StructInit(IcMeasure_InitTypeDef* init_struct);
+ErrorStatus IcMeasure_Init(IcMeasure_TypeDef* icm, const IcMeasure_InitTypeDef* init_struct);
+ErrorStatus IcMeasure_Process(IcMeasure_TypeDef* icm, IcMeasure_ResultTypeDef* result);
+void IcMeasure_IRQHandler(IcMeasure_TypeDef* icm);
+void IcMeasure_DMAIRQHandler(IcMeasure_TypeDef* icm);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __IC_MEASURE_H
+////////////////////////////////////////////////////////////////////////////////
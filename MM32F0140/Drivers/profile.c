@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     profile.c
+/// @brief    THIS FILE PROVIDES THE CODE PROFILER FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// A site is a static Profile_SiteTypeDef. PROFILE_BEGIN takes a 32-bit
+/// timestamp, and PROFILE_END records the difference, less the measured
+/// cost of a timestamp pair, into the site's count, min, max, sum and a
+/// log2 histogram:
+///   PROFILE_SITE(spi_isr);
+///   void SPI1_IRQHandler(void) {
+///       PROFILE_BEGIN(spi_isr);
+///       ...
+///       PROFILE_END(spi_isr);
+///   }
+/// With TIM2 as time base, a scope costs about 60 cycles: two counter
+/// reads and a short critical section to update the site. Sites can
+/// therefore be shared between interrupt levels. The mean and the
+/// conversion to ns are left to Profile_GetStats, off the hot path.
+/// Building with PROFILE_ENABLED set to 0 removes the scopes entirely.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _PROFILE_C_
+
+// Files includes
+#include "profile.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup PROFILE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Adds one measurement to a site.
+/// @param  site: profiling site.
+/// @param  ticks: raw interval in timer clocks.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Profile_Record(Profile_SiteTypeDef* site, u32 ticks)
+{
+    u32 overhead = Timestamp_GetOverhead();
+    u32 bin = 0;
+    u32 v;
+
+    ticks = (ticks > overhead) ? ticks - overhead : 0;
+    // Bit length of ticks, by halving: 5 steps instead of a loop.
+    v = ticks;
+    if (v >= 0x10000) {
+        v   >>= 16;
+        bin  += 16;
+    }
+    if (v >= 0x100) {
+        v   >>= 8;
+        bin  += 8;
+    }
+    if (v >= 0x10) {
+        v   >>= 4;
+        bin  += 4;
+    }
+    if (v >= 0x4) {
+        v   >>= 2;
+        bin  += 2;
+    }
+    bin += (v >= 0x2) ? 2 : v;
+    bin  = (bin < PROFILE_BINS) ? bin : PROFILE_BINS - 1;
+
+    {
+        DRV_ENTER_CRITICAL();
+        site->Count++;
+        site->Sum += ticks;
+        site->Min  = (ticks < site->Min) ? ticks : site->Min;
+        site->Max  = (ticks > site->Max) ? ticks : site->Max;
+        if (site->Histogram[bin] != 0xFFFF) {
+            site->Histogram[bin]++;
+        }
+        DRV_EXIT_CRITICAL();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Clears the statistics of a site.
+/// @param  site: profiling site.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Profile_Reset(Profile_SiteTypeDef* site)
+{
+    u8 i;
+
+    DRV_ENTER_CRITICAL();
+    site->Count = 0;
+    site->Min   = 0xFFFFFFFF;
+    site->Max   = 0;
+    site->Sum   = 0;
+    for (i = 0; i < PROFILE_BINS; i++) {
+        site->Histogram[i] = 0;
+    }
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reports the statistics of a site in nanoseconds.
+/// @param  site: profiling site.
+/// @param  stats: receives the report.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Profile_GetStats(const Profile_SiteTypeDef* site, Profile_StatsTypeDef* stats)
+{
+    u32 count, min, max;
+    u64 sum;
+
+    {
+        DRV_ENTER_CRITICAL();
+        count = site->Count;
+        min   = site->Min;
+        max   = site->Max;
+        sum   = site->Sum;
+        DRV_EXIT_CRITICAL();
+    }
+    stats->Count  = count;
+    stats->MinNs  = (count != 0) ? (u32)Timestamp_ToNs(min) : 0;
+    stats->MaxNs  = (u32)Timestamp_ToNs(max);
+    stats->MeanNs = (count != 0) ? (u32)Timestamp_ToNs(sum / count) : 0;
+}
+
+/// @}
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     profile.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES AND MACROS FOR THE
+///           CODE PROFILER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+// Files includes
+#include "timestamp.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PROFILE
+/// @brief Code profiler
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PROFILE_Exported_Constants
+/// @{
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED             (1)                                         ///< 0 compiles the scopes out
+#endif
+
+#define PROFILE_BINS                (16U)                                       ///< Histogram bin b: [2^(b-1), 2^b) clocks
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PROFILE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Statistics of one measured scope, in timer clocks
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    const char*                     Name;
+    u32                             Count;
+    u32                             Min;
+    u32                             Max;
+    u64                             Sum;
+    u16                             Histogram[PROFILE_BINS];                    ///< Saturating counts
+} Profile_SiteTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Profile report, in nanoseconds
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             Count;
+    u32                             MinNs;
+    u32                             MaxNs;
+    u32                             MeanNs;
+} Profile_StatsTypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PROFILE_Exported_Macros
+/// @{
+
+/// Defines a profiling site at file scope.
+#define PROFILE_SITE(site)          Profile_SiteTypeDef site = {#site, 0, 0xFFFFFFFF, 0, 0, {0}}
+
+#if PROFILE_ENABLED
+/// Opens a measured scope; pair with PROFILE_END(site) in the same block.
+#define PROFILE_BEGIN(site)         u32 profile_start_##site = Timestamp_Get32()
+#define PROFILE_END(site)           Profile_Record(&(site), Timestamp_Get32() - profile_start_##site)
+#else
+#define PROFILE_BEGIN(site)
+#define PROFILE_END(site)
+#endif
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PROFILE_Exported_Functions
+/// @{
+
+void Profile_Record(Profile_SiteTypeDef* site, u32 ticks);
+void Profile_Reset(Profile_SiteTypeDef* site);
+void Profile_GetStats(const Profile_SiteTypeDef* site, Profile_StatsTypeDef* stats);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __PROFILE_H
+////////////////////////////////////////////////////////////////////////////////
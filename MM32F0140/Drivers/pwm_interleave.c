@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     pwm_interleave.c
+/// @brief    THIS FILE PROVIDES THE INTERLEAVED MULTI-PHASE PWM SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// TIM1 runs center-aligned and drives one converter phase on each of
+/// CH1..CHn. With the phase-shift enable of a channel set in PDER, the
+/// counter is compared with CCRx while counting up and with CCRxFALL while
+/// counting down. The two edges of a pulse are therefore independent, and
+/// each pulse can be moved off the counter turning point without a second
+/// timer. Phase n is centred at n / Phases of the period, so the inductor
+/// ripple currents cancel in the output and the input current is drawn
+/// Phases times per period.
+///
+/// A pulse made of an up-count edge and a down-count edge always contains
+/// a turning point: PWM1 channels are centred on the valley, PWM2 channels
+/// on the peak. Each phase uses the turning point nearest to its centre,
+/// and its centre can move up to min(D, 1 - D) of half a period away from
+/// it. Exact interleaving thus covers any duty with 2 phases, 33..67 % with
+/// 3 and 25..75 % with 4. Outside that band a pulse stops at its turning
+/// point instead; the cancellation degrades gradually and Shifted reports
+/// how many phases are off their ideal centre.
+///
+/// The compares are preloaded. The repetition counter makes the update
+/// event happen once per period, at the valley, and the update event is
+/// held off while all the compares are written. A duty change therefore
+/// reaches every phase at the same valley, at most one period later, and
+/// no pulse is ever built from a mix of two updates except across the
+/// valley itself. An update takes about 150 cycles and uses no interrupt.
+/// This service owns TIM1 and cannot run alongside Foc.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _PWM_INTERLEAVE_C_
+
+// Files includes
+#include "pwm_interleave.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup PWM_INTERLEAVE
+/// @{
+
+static void (*const pwm_interleave_oc_init[PWM_INTERLEAVE_MAX_PHASES])(TIM_TypeDef*, TIM_OCInitTypeDef*) = {
+    TIM_OC1Init, TIM_OC2Init, TIM_OC3Init, TIM_OC4Init
+};
+
+static void (*const pwm_interleave_oc_preload[PWM_INTERLEAVE_MAX_PHASES])(TIM_TypeDef*, TIMOCPE_Typedef) = {
+    TIM_OC1PreloadConfig, TIM_OC2PreloadConfig, TIM_OC3PreloadConfig, TIM_OC4PreloadConfig
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the distance from a point of the period to the nearest
+///         counter turning point.
+/// @param  period: TIM1 ARR.
+/// @param  centre: ticks from the valley, 0 to 2 * period - 1.
+/// @param  peak: set if the peak is the nearer turning point.
+/// @retval Signed offset from the turning point, ticks.
+////////////////////////////////////////////////////////////////////////////////
+static s32 PwmInterleave_Offset(u32 period, u32 centre, bool* peak)
+{
+    *peak = false;
+    if (centre < period / 2) {
+        return (s32)centre;
+    }
+    if (centre < 2 * period - period / 2) {
+        *peak = true;
+        return (s32)centre - (s32)period;
+    }
+    return (s32)centre - (s32)(2 * period);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Places the phase centres n * 2 * Period / Phases apart, rotated
+///         by 0 or half a step, whichever keeps them nearer to the turning
+///         points.
+/// @param  pwm: pointer to the service state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void PwmInterleave_Place(PwmInterleave_TypeDef* pwm)
+{
+    u32 full = 2 * (u32)pwm->Period;
+    u32 step = full / pwm->Phases;
+    u32 worst[2] = {0, 0};
+    u32 rotate, n;
+    s32 offset;
+    bool peak;
+
+    for (rotate = 0; rotate < 2; rotate++) {
+        for (n = 0; n < pwm->Phases; n++) {
+            offset = PwmInterleave_Offset(pwm->Period, (n * step + rotate * step / 2) % full, &peak);
+            offset = (offset < 0) ? -offset : offset;
+            if ((u32)offset > worst[rotate]) {
+                worst[rotate] = (u32)offset;
+            }
+        }
+    }
+    rotate    = (worst[1] < worst[0]) ? step / 2 : 0;
+    pwm->Peak = 0;
+    for (n = 0; n < pwm->Phases; n++) {
+        pwm->Offset[n] = (s16)PwmInterleave_Offset(pwm->Period, (n * step + rotate) % full, &peak);
+        if (peak) {
+            pwm->Peak |= 1 << n;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default settings: two phases at 100 kHz, 0 % duty.
+/// @param  init_struct: pointer to a PwmInterleave_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void PwmInterleave_StructInit(PwmInterleave_InitTypeDef* init_struct)
+{
+    init_struct->Phases = 2;
+    init_struct->PwmHz  = 100000;
+    init_struct->Duty   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets up TIM1 for the phases and starts it with the outputs off.
+/// @param  pwm: pointer to the service state.
+/// @param  init_struct: pointer to a PwmInterleave_InitTypeDef structure.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus PwmInterleave_Init(PwmInterleave_TypeDef* pwm, const PwmInterleave_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_OCInitTypeDef oc_init;
+    u32 clock = DRV_TimerClock(TIM1);
+    u32 period;
+    u8 n;
+
+    if ((clock == 0) || (init_struct->PwmHz == 0) || (init_struct->Phases < 2) ||
+        (init_struct->Phases > PWM_INTERLEAVE_MAX_PHASES)) {
+        return ERROR;
+    }
+    period = clock / 2 / init_struct->PwmHz;
+    if ((period < 16) || (period >= 0xFFFF)) {
+        return ERROR;
+    }
+    pwm->Phases  = init_struct->Phases;
+    pwm->Period  = (u16)period;
+    pwm->Updates = 0;
+    PwmInterleave_Place(pwm);
+
+    DRV_TimerClockCmd(TIM1, ENABLE);
+    TIM_CtrlPWMOutputs(TIM1, DISABLE);
+    // A six-step setup leaves the mode and enable bits waiting for a COM event.
+    TIM_CCPreloadControl(TIM1, DISABLE);
+
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler         = 0;
+    tim_init.TIM_Period            = period;
+    tim_init.TIM_CounterMode       = TIM_CounterMode_CenterAligned1;
+    tim_init.TIM_RepetitionCounter = 1;
+    TIM_TimeBaseInit(TIM1, &tim_init);
+    TIM_ARRPreloadConfig(TIM1, ENABLE);
+
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OutputState = TIM_OutputState_Enable;
+    oc_init.TIM_OCPolarity  = TIM_OCPolarity_High;
+    oc_init.TIM_OCIdleState = TIM_OCIdleState_Reset;
+    for (n = 0; n < pwm->Phases; n++) {
+        oc_init.TIM_OCMode = (pwm->Peak & (1 << n)) ? TIM_OCMode_PWM2 : TIM_OCMode_PWM1;
+        pwm_interleave_oc_init[n](TIM1, &oc_init);
+        pwm_interleave_oc_preload[n](TIM1, TIM_OCPreload_Enable);
+        TIM_PWMShiftConfig(TIM1, TIM_PDER_CCR1SHIFTEN << n, ENABLE);
+    }
+
+    PwmInterleave_SetDuty(pwm, init_struct->Duty);
+    TIM_GenerateEvent(TIM1, TIM_EventSource_Update);
+    TIM_Cmd(TIM1, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the phase outputs on or off.
+/// @param  pwm: pointer to the service state.
+/// @param  state: ENABLE or DISABLE.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void PwmInterleave_Cmd(PwmInterleave_TypeDef* pwm, FunctionalState state)
+{
+    (void)pwm;
+    TIM_CtrlPWMOutputs(TIM1, state);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets the same duty on all phases.
+/// @param  pwm: pointer to the service state.
+/// @param  duty: 0 to PWM_INTERLEAVE_DUTY_FULL.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void PwmInterleave_SetDuty(PwmInterleave_TypeDef* pwm, u16 duty)
+{
+    u16 all[PWM_INTERLEAVE_MAX_PHASES];
+    u8 n;
+
+    for (n = 0; n < PWM_INTERLEAVE_MAX_PHASES; n++) {
+        all[n] = duty;
+    }
+    PwmInterleave_SetDuties(pwm, all);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets one duty per phase, e.g. to balance the phase currents. All
+///         phases change at the same valley.
+/// @param  pwm: pointer to the service state.
+/// @param  duty: Phases duties, 0 to PWM_INTERLEAVE_DUTY_FULL.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void PwmInterleave_SetDuties(PwmInterleave_TypeDef* pwm, const u16* duty)
+{
+    u32 rise[PWM_INTERLEAVE_MAX_PHASES];
+    u32 fall[PWM_INTERLEAVE_MAX_PHASES];
+    u32 period = pwm->Period;
+    u32 half, limit;
+    s32 offset;
+    u8 n, shifted = 0;
+
+    for (n = 0; n < pwm->Phases; n++) {
+        pwm->Duty[n] = (duty[n] < PWM_INTERLEAVE_DUTY_FULL) ? duty[n] : PWM_INTERLEAVE_DUTY_FULL;
+        half         = pwm->Duty[n] * period / PWM_INTERLEAVE_DUTY_FULL;
+        limit        = (half < period - half) ? half : period - half;
+        offset       = pwm->Offset[n];
+        if (offset > (s32)limit) {
+            offset = (s32)limit;
+            shifted++;
+        }
+        else if (offset < -(s32)limit) {
+            offset = -(s32)limit;
+            shifted++;
+        }
+        // Beyond the counter range a compare never matches: the output
+        // stays at one level for the whole period.
+        if (pwm->Peak & (1 << n)) {
+            rise[n] = (half == 0) ? period + 1 : period - half + offset;
+            fall[n] = (half == 0) ? period + 1 : period - half - offset;
+        }
+        else {
+            rise[n] = (half == period) ? period + 1 : half + offset;
+            fall[n] = (half == period) ? period + 1 : half - offset;
+        }
+    }
+
+    // CCR1..CCR4 and CCR1FALL..CCR4FALL are consecutive registers.
+    TIM_UpdateDisableConfig(TIM1, ENABLE);
+    for (n = 0; n < pwm->Phases; n++) {
+        (&TIM1->CCR1)[n]     = rise[n];
+        (&TIM1->CCR1FALL)[n] = fall[n];
+    }
+    TIM_UpdateDisableConfig(TIM1, DISABLE);
+    pwm->Shifted = shifted;
+    pwm->Updates++;
+}
+
+/// @}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     pwm_interleave.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE
+///           INTERLEAVED MULTI-PHASE PWM SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __PWM_INTERLEAVE_H
+#define __PWM_INTERLEAVE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PWM_INTERLEAVE
+/// @brief Interleaved multi-phase PWM service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PWM_INTERLEAVE_Exported_Constants
+/// @{
+
+#define PWM_INTERLEAVE_MAX_PHASES   (4U)                                        ///< TIM1 CH1..CH4
+#define PWM_INTERLEAVE_DUTY_FULL    (10000U)                                    ///< Duty in 0.01 % steps
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PWM_INTERLEAVE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Interleaved PWM init structure definition. The CH1..CHn pins are
+///         left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8                              Phases;                                     ///< 2 to PWM_INTERLEAVE_MAX_PHASES
+    u32                             PwmHz;                                      ///< Switching frequency of each phase
+    u16                             Duty;                                       ///< Initial duty, 0.01 %
+} PwmInterleave_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Interleaved PWM state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8                              Phases;
+    u8                              Peak;                                       ///< Bit n: phase n is centred on the counter peak
+    u16                             Period;                                     ///< TIM1 ARR, half a PWM period
+    s16                             Offset[PWM_INTERLEAVE_MAX_PHASES];          ///< Ideal centre minus the turning point, ticks
+    u16                             Duty[PWM_INTERLEAVE_MAX_PHASES];            ///< Latest duties, 0.01 %
+    u32                             Updates;
+    u8                              Shifted;                                    ///< Phases off their ideal centre at the latest update
+} PwmInterleave_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup PWM_INTERLEAVE_Exported_Functions
+/// @{
+
+void PwmInterleave_StructInit(PwmInterleave_InitTypeDef* init_struct);
+ErrorStatus PwmInterleave_Init(PwmInterleave_TypeDef* pwm, const PwmInterleave_InitTypeDef* init_struct);
+void PwmInterleave_Cmd(PwmInterleave_TypeDef* pwm, FunctionalState state);
+void PwmInterleave_SetDuty(PwmInterleave_TypeDef* pwm, u16 duty);
+void PwmInterleave_SetDuties(PwmInterleave_TypeDef* pwm, const u16* duty);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __PWM_INTERLEAVE_H
+////////////////////////////////////////////////////////////////////////////////
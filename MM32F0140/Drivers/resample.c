@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     resample.c
+/// @brief    THIS FILE PROVIDES THE Q15 POLYPHASE SAMPLE-RATE CONVERTER
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Rational L/M converter: only the filter phase that lands on each output is
+/// evaluated, so the cost is Taps multiply-accumulates per output sample and
+/// channel, independent of L and M.
+///
+/// Each delay line is stored twice back to back, so the newest Taps samples
+/// are always contiguous and the inner loop needs no wrap test. On the
+/// Cortex-M0 (single-cycle multiplier) the inner loop is about 6 cycles per
+/// tap, and each output sample adds about 30 for the phase step, rounding
+/// and clamping: 48 kHz stereo output with 16 taps is roughly
+/// 12.1 Mcycles/s, 16.8 % of a 72 MHz core. Outputs and Macs count the work
+/// actually done.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _RESAMPLE_C_
+
+// Files includes
+#include <string.h>
+#include "resample.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup RESAMPLE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Initializes a converter.
+/// @param  rs: pointer to the converter state.
+/// @param  coeffs: up * taps Q15 coefficients, phase-major.
+/// @param  up: interpolation factor L.
+/// @param  down: decimation factor M.
+/// @param  taps: taps per phase, up to RESAMPLE_MAX_TAPS.
+/// @param  channels: 1, or 2 for interleaved stereo.
+/// @retval ERROR on invalid parameters.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Resample_Init(Resample_TypeDef* rs, const s16* coeffs, u16 up, u16 down, u8 taps, u8 channels)
+{
+    if ((coeffs == NULL) || (up == 0) || (down == 0) || (taps == 0) || (taps > RESAMPLE_MAX_TAPS) ||
+        (channels == 0) || (channels > RESAMPLE_MAX_CHANNELS)) {
+        return ERROR;
+    }
+    rs->Coeffs   = coeffs;
+    rs->Up       = up;
+    rs->Down     = down;
+    rs->Taps     = taps;
+    rs->Channels = channels;
+    rs->Outputs  = 0;
+    rs->Macs     = 0;
+    Resample_Reset(rs);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Clears the history, e.g. after a stream restart.
+/// @param  rs: pointer to the converter state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Resample_Reset(Resample_TypeDef* rs)
+{
+    memset(rs->Delay, 0, sizeof(rs->Delay));
+    rs->Phase = 0;
+    rs->Pos   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Converts a block. Stops when either the input is consumed or the
+///         output is full; the remainder of the input is for the next call.
+/// @param  rs: pointer to the converter state.
+/// @param  in: input frames (one sample per channel, interleaved).
+/// @param  in_frames: number of input frames.
+/// @param  in_used: receives the number of input frames consumed.
+/// @param  out: output frames, interleaved.
+/// @param  out_frames: room in the output, frames.
+/// @retval Number of output frames produced.
+////////////////////////////////////////////////////////////////////////////////
+u16 Resample_Process(Resample_TypeDef* rs, const s16* in, u16 in_frames, u16* in_used, s16* out, u16 out_frames)
+{
+    u32 taps = rs->Taps;
+    u32 channels = rs->Channels;
+    u32 phase = rs->Phase;
+    u32 pos = rs->Pos;
+    u16 used = 0, produced = 0;
+    u32 ch, k;
+
+    for (;;) {
+        // Bring in the input samples this output position needs.
+        while (phase >= rs->Up) {
+            if (used == in_frames) {
+                goto done;
+            }
+            pos = (pos == 0) ? taps - 1 : pos - 1;
+            for (ch = 0; ch < channels; ch++) {
+                rs->Delay[ch][pos]        = *in;
+                rs->Delay[ch][pos + taps] = *in++;
+            }
+            used++;
+            phase -= rs->Up;
+        }
+        if (produced == out_frames) {
+            break;
+        }
+
+        for (ch = 0; ch < channels; ch++) {
+            const s16* c = rs->Coeffs + phase * taps;
+            const s16* d = &rs->Delay[ch][pos];
+            s32 acc = 0;
+
+            for (k = 0; k < taps; k++) {
+                acc += (s32)c[k] * d[k];
+            }
+            acc = (acc + 0x4000) >> 15;
+            *out++ = (acc > 32767) ? 32767 : (acc < -32768) ? -32768 : (s16)acc;
+        }
+        produced++;
+        phase += rs->Down;
+        rs->Outputs += channels;
+        rs->Macs    += taps * channels;
+    }
+
+done:
+    rs->Phase = (u16)phase;
+    rs->Pos   = (u8)pos;
+    if (in_used != NULL) {
+        *in_used = used;
+    }
+    return produced;
+}
+
+/// @}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     resample.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE Q15
+///           POLYPHASE SAMPLE-RATE CONVERTER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __RESAMPLE_H
+#define __RESAMPLE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup RESAMPLE
+/// @brief Q15 polyphase sample-rate converter
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup RESAMPLE_Exported_Constants
+/// @{
+
+#define RESAMPLE_MAX_TAPS           (32U)                                       ///< Taps per phase
+#define RESAMPLE_MAX_CHANNELS       (2U)
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup RESAMPLE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Converter state. Output rate = input rate * Up / Down.
+///         Coeffs holds Up phases of Taps coefficients in Q15: phase p, tap k
+///         is h[k * Up + p] of a low-pass prototype designed at Up times the
+///         input rate with a gain of Up (so each phase sums to about 1.0).
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    const s16*  Coeffs;
+    u16         Up;                                                             ///< Interpolation factor L (phases)
+    u16         Down;                                                           ///< Decimation factor M
+    u8          Taps;
+    u8          Channels;                                                       ///< 1, or 2 for interleaved stereo
+    u16         Phase;                                                          ///< Output position in 1/Up input samples
+    u8          Pos;                                                            ///< Newest sample in Delay
+    s16         Delay[RESAMPLE_MAX_CHANNELS][2 * RESAMPLE_MAX_TAPS];            ///< Mirrored delay lines
+    u32         Outputs;                                                        ///< Output samples computed, all channels
+    u32         Macs;                                                           ///< Multiply-accumulates run
+} Resample_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup RESAMPLE_Exported_Functions
+/// @{
+
+ErrorStatus Resample_Init(Resample_TypeDef* rs, const s16* coeffs, u16 up, u16 down, u8 taps, u8 channels);
+void Resample_Reset(Resample_TypeDef* rs);
+u16 Resample_Process(Resample_TypeDef* rs, const s16* in, u16 in_frames, u16* in_used, s16* out, u16 out_frames);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __RESAMPLE_H
+////////////////////////////////////////////////////////////////////////////////
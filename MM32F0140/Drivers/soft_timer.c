@@ -0,0 +1,510 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     soft_timer.c
+/// @brief    THIS FILE PROVIDES THE SOFTWARE TIMER SERVICE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Timers hang in a hierarchical timing wheel of SOFT_TIMER_LEVELS levels
+/// of SOFT_TIMER_SLOTS slots. Level l holds timers that expire within
+/// 16^(l+1) ticks, hashed by bits 4l..4l+3 of their absolute expiry. Each
+/// slot is an intrusive doubly linked list (Prev points at the link that
+/// points at the timer), so start and stop are O(1) whatever the number
+/// of timers. Each tick:
+///   - when bits 0..4l-1 of the tick count wrap to zero, the level-l slot
+///     for the new block is re-hashed into lower levels (cascade);
+///   - the level-0 slot of the tick is detached; every timer in it expires
+///     now.
+/// Idle ticks cost about 30 cycles. Each timer cascades at most
+/// SOFT_TIMER_LEVELS - 1 times in its life, so the cost per tick depends
+/// on the number of expiries and not on the number of timers armed. The
+/// wheel takes 96 pointers (384 bytes) and reaches 2^24 ticks, 4.6 h at
+/// 1 kHz; longer delays are clamped.
+///
+/// Callbacks flagged SOFT_TIMER_ISR run in the tick interrupt. The others
+/// are queued and run from SoftTimer_Run in the main loop. A periodic
+/// timer is re-armed from its previous expiry, not from when its callback
+/// ran, so it does not drift. A task timer that fires again before
+/// SoftTimer_Run got to it runs once, and Overruns counts the merge.
+///
+/// Tickless idle (TIM tick source only): SoftTimer_Idle finds the next
+/// wheel event, i.e. the first non-empty slot that a tick would process (at
+/// most 96 slot checks, about 500 cycles). No slot in between does any
+/// work, so Now can skip forward without running those ticks. The timer's
+/// reload is stretched to that many ticks, up to SOFT_TIMER_IDLE_MAX, and
+/// the core sleeps (WFI, sleep mode) with interrupts masked. On wake the
+/// counter tells how many whole ticks passed. Now is advanced by those; the
+/// reload and the counter are put back at the same phase in the current
+/// tick, so the tick stays continuous. The wakeup tick itself is left to
+/// the pending interrupt, and so are the whole ticks that passed after it
+/// before the core resumed (Backlog): they run in the tick interrupt like
+/// any other, so SOFT_TIMER_ISR callbacks never run from the main loop.
+/// After a timer wakeup, the counter value is also the wakeup latency, from
+/// the update event to the code resuming, at one counter clock of
+/// resolution. Stop mode would halt the timer on this part, so only sleep
+/// mode is used. At 1 kHz, a system idle for 100 ms wakes once instead of
+/// 100 times, and the core clock is gated in between. Restoring the phase
+/// costs one CNT write. The counter runs during the few cycles that takes,
+/// which can drift the tick by one counter clock per wakeup that is not
+/// from the tick timer. With SysTick as tick source, SoftTimer_Idle only
+/// sleeps until the next tick.
+///
+/// The tick comes from TIM14 (any basic timer) or from SysTick:
+///   void TIM14_IRQHandler(void) { SoftTimer_IRQHandler(&timers); }
+///   void SysTick_Handler(void)  { SoftTimer_IRQHandler(&timers); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SOFT_TIMER_C_
+
+// Files includes
+#include "soft_timer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup SOFT_TIMER
+/// @{
+
+#define SOFT_TIMER_ACTIVE           (0x10U)                                     ///< Linked into the wheel
+#define SOFT_TIMER_PENDING          (0x20U)                                     ///< Task callback due
+#define SOFT_TIMER_QUEUED           (0x40U)                                     ///< On the task queue
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Removes a timer from the list it is linked into.
+/// @param  timer: linked timer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SoftTimer_Unlink(SoftTimer_TimerTypeDef* timer)
+{
+    *timer->Prev = timer->Next;
+    if (timer->Next != NULL) {
+        timer->Next->Prev = timer->Prev;
+    }
+    timer->Next = NULL;
+    timer->Prev = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Links a timer into the slot of its expiry, at the lowest level
+///         that covers the remaining delay.
+/// @param  st: pointer to the wheel state.
+/// @param  timer: unlinked timer with Expiry set.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SoftTimer_Insert(SoftTimer_TypeDef* st, SoftTimer_TimerTypeDef* timer)
+{
+    u32 delta = timer->Expiry - st->Now;
+    SoftTimer_TimerTypeDef** head;
+    u8 level = 0;
+
+    while ((level < SOFT_TIMER_LEVELS - 1) && ((delta >> (SOFT_TIMER_SLOT_BITS * (level + 1))) != 0)) {
+        level++;
+    }
+    head = &st->Wheel[level][(timer->Expiry >> (SOFT_TIMER_SLOT_BITS * level)) & (SOFT_TIMER_SLOTS - 1)];
+
+    timer->Next = *head;
+    if (*head != NULL) {
+        (*head)->Prev = &timer->Next;
+    }
+    *head       = timer;
+    timer->Prev = head;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Re-hashes the timers of one slot into lower levels.
+/// @param  st: pointer to the wheel state.
+/// @param  level: level of the slot, 1 or more.
+/// @param  slot: slot index.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SoftTimer_Cascade(SoftTimer_TypeDef* st, u8 level, u32 slot)
+{
+    SoftTimer_TimerTypeDef* timer = st->Wheel[level][slot];
+    SoftTimer_TimerTypeDef* next;
+
+    st->Wheel[level][slot] = NULL;
+    while (timer != NULL) {
+        next = timer->Next;
+        SoftTimer_Insert(st, timer);
+        st->Cascaded++;
+        timer = next;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the tick source and clears the wheel.
+/// @param  st: pointer to the wheel state.
+/// @param  tim: basic timer for the tick (e.g. TIM14), NULL for SysTick.
+/// @param  tick_hz: tick rate.
+/// @retval ERROR if the rate cannot be produced.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SoftTimer_Init(SoftTimer_TypeDef* st, TIM_TypeDef* tim, u32 tick_hz)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    u32 clock, ticks, divider, d;
+    u8 level, slot;
+
+    if (tick_hz == 0) {
+        return ERROR;
+    }
+    for (level = 0; level < SOFT_TIMER_LEVELS; level++) {
+        for (slot = 0; slot < SOFT_TIMER_SLOTS; slot++) {
+            st->Wheel[level][slot] = NULL;
+        }
+    }
+    st->Now             = 0;
+    st->Backlog         = 0;
+    st->Timer           = tim;
+    st->TickHz          = tick_hz;
+    st->PendHead        = NULL;
+    st->PendTail        = NULL;
+    st->Active          = 0;
+    st->Expired         = 0;
+    st->Cascaded        = 0;
+    st->Sleeps          = 0;
+    st->IdleTicks       = 0;
+    st->WakeLatencyLast = 0;
+    st->WakeLatencyMax  = 0;
+
+    if (tim == NULL) {
+        st->TickClock = RCC_GetHCLKFreq();
+        st->Counts    = st->TickClock / tick_hz;
+        return (SysTick_Config(st->Counts) == 0) ? SUCCESS : ERROR;
+    }
+    // Few enough counts per tick that SOFT_TIMER_IDLE_MAX ticks fit the
+    // 16-bit counter; an exact divider of the tick if there is one.
+    clock   = DRV_TimerClock(tim);
+    ticks   = clock / tick_hz;
+    divider = (ticks + (0x10000 / SOFT_TIMER_IDLE_MAX) - 1) / (0x10000 / SOFT_TIMER_IDLE_MAX);
+    divider = (divider == 0) ? 1 : divider;
+    d = divider;
+    while ((d < divider * 2) && (ticks % d != 0)) {
+        d++;
+    }
+    divider = (ticks % d == 0) ? d : divider;
+    if ((ticks == 0) || (divider > 0x10000) || (ticks / divider == 0)) {
+        return ERROR;
+    }
+    st->TickClock = clock / divider;
+    st->Counts    = ticks / divider;
+
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = (u16)(divider - 1);
+    tim_init.TIM_Period    = st->Counts - 1;
+    TIM_TimeBaseInit(tim, &tim_init);
+    tim->SR = 0;
+    TIM_ITConfig(tim, TIM_IT_Update, ENABLE);
+    DRV_NVICEnable(DRV_TimerIRQn(tim), 3);
+    TIM_Cmd(tim, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Prepares a timer before its first start.
+/// @param  timer: timer to set up.
+/// @param  callback: expiry hook.
+/// @param  context: passed to the hook.
+/// @param  flags: SOFT_TIMER_ISR, or 0 for a task-context callback.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Setup(SoftTimer_TimerTypeDef* timer, SoftTimer_Callback callback, void* context, u8 flags)
+{
+    timer->Next     = NULL;
+    timer->Prev     = NULL;
+    timer->PendNext = NULL;
+    timer->Expiry   = 0;
+    timer->Period   = 0;
+    timer->Callback = callback;
+    timer->Context  = context;
+    timer->Flags    = flags & SOFT_TIMER_ISR;
+    timer->Overruns = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Arms a timer, restarting it if it is already active.
+/// @param  st: pointer to the wheel state.
+/// @param  timer: timer set up with SoftTimer_Setup.
+/// @param  delay: ticks to the first expiry, at least 1.
+/// @param  period: ticks between later expiries, 0 for one-shot.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Start(SoftTimer_TypeDef* st, SoftTimer_TimerTypeDef* timer, u32 delay, u32 period)
+{
+    delay  = (delay == 0) ? 1 : (delay > SOFT_TIMER_MAX_DELAY) ? SOFT_TIMER_MAX_DELAY : delay;
+    period = (period > SOFT_TIMER_MAX_DELAY) ? SOFT_TIMER_MAX_DELAY : period;
+
+    DRV_ENTER_CRITICAL();
+    if (timer->Flags & SOFT_TIMER_ACTIVE) {
+        SoftTimer_Unlink(timer);
+        st->Active--;
+    }
+    timer->Expiry = st->Now + delay;
+    timer->Period = period;
+    SoftTimer_Insert(st, timer);
+    timer->Flags |= SOFT_TIMER_ACTIVE;
+    st->Active++;
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Disarms a timer and cancels a task callback not yet run.
+/// @param  st: pointer to the wheel state.
+/// @param  timer: timer to stop.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Stop(SoftTimer_TypeDef* st, SoftTimer_TimerTypeDef* timer)
+{
+    DRV_ENTER_CRITICAL();
+    if (timer->Flags & SOFT_TIMER_ACTIVE) {
+        SoftTimer_Unlink(timer);
+        st->Active--;
+    }
+    timer->Flags &= (u8)~(SOFT_TIMER_ACTIVE | SOFT_TIMER_PENDING);
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Tells whether a timer is armed.
+/// @param  timer: timer to check.
+/// @retval true if armed.
+////////////////////////////////////////////////////////////////////////////////
+bool SoftTimer_IsActive(const SoftTimer_TimerTypeDef* timer)
+{
+    return (timer->Flags & SOFT_TIMER_ACTIVE) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the tick count.
+/// @param  st: pointer to the wheel state.
+/// @retval Ticks since SoftTimer_Init, wrapping at 32 bits.
+////////////////////////////////////////////////////////////////////////////////
+u32 SoftTimer_GetTicks(SoftTimer_TypeDef* st)
+{
+    return st->Now;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs the task-context callbacks that are due. Call from the main
+///         loop.
+/// @param  st: pointer to the wheel state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Run(SoftTimer_TypeDef* st)
+{
+    SoftTimer_TimerTypeDef* timer;
+    bool due;
+
+    for (;;) {
+        DRV_ENTER_CRITICAL();
+        timer = st->PendHead;
+        if (timer != NULL) {
+            st->PendHead = timer->PendNext;
+            if (st->PendHead == NULL) {
+                st->PendTail = NULL;
+            }
+            due = (timer->Flags & SOFT_TIMER_PENDING) != 0;
+            timer->Flags &= (u8)~(SOFT_TIMER_PENDING | SOFT_TIMER_QUEUED);
+        }
+        DRV_EXIT_CRITICAL();
+        if (timer == NULL) {
+            return;
+        }
+        if (due) {
+            timer->Callback(timer, timer->Context);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Advances the wheel by one tick. Called by SoftTimer_IRQHandler,
+///         or directly by an application that owns the tick source.
+/// @param  st: pointer to the wheel state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Tick(SoftTimer_TypeDef* st)
+{
+    SoftTimer_TimerTypeDef* expired;
+    SoftTimer_TimerTypeDef* timer;
+    u32 now;
+    u8 level;
+    bool call;
+
+    {
+        DRV_ENTER_CRITICAL();
+        now = ++st->Now;
+        for (level = 1; (level < SOFT_TIMER_LEVELS) && ((now & ((1UL << (SOFT_TIMER_SLOT_BITS * level)) - 1)) == 0); level++) {
+            SoftTimer_Cascade(st, level, (now >> (SOFT_TIMER_SLOT_BITS * level)) & (SOFT_TIMER_SLOTS - 1));
+        }
+        // Detach the slot; callbacks that stop a timer still in it unlink
+        // it from this local list.
+        expired = st->Wheel[0][now & (SOFT_TIMER_SLOTS - 1)];
+        st->Wheel[0][now & (SOFT_TIMER_SLOTS - 1)] = NULL;
+        if (expired != NULL) {
+            expired->Prev = &expired;
+        }
+        DRV_EXIT_CRITICAL();
+    }
+
+    for (;;) {
+        DRV_ENTER_CRITICAL();
+        timer = expired;
+        call  = false;
+        if (timer != NULL) {
+            SoftTimer_Unlink(timer);
+            st->Expired++;
+            if (timer->Period != 0) {
+                timer->Expiry += timer->Period;
+                SoftTimer_Insert(st, timer);
+            }
+            else {
+                timer->Flags &= (u8)~SOFT_TIMER_ACTIVE;
+                st->Active--;
+            }
+            if (timer->Flags & SOFT_TIMER_ISR) {
+                call = true;
+            }
+            else if (timer->Flags & SOFT_TIMER_PENDING) {
+                timer->Overruns++;
+            }
+            else {
+                timer->Flags |= SOFT_TIMER_PENDING;
+                if (!(timer->Flags & SOFT_TIMER_QUEUED)) {
+                    timer->Flags   |= SOFT_TIMER_QUEUED;
+                    timer->PendNext = NULL;
+                    if (st->PendTail != NULL) {
+                        st->PendTail->PendNext = timer;
+                    }
+                    else {
+                        st->PendHead = timer;
+                    }
+                    st->PendTail = timer;
+                }
+            }
+        }
+        DRV_EXIT_CRITICAL();
+        if (timer == NULL) {
+            return;
+        }
+        if (call) {
+            timer->Callback(timer, timer->Context);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the ticks until the next tick that has work to do: an
+///         expiry, or the cascade of a non-empty slot.
+/// @param  st: pointer to the wheel state.
+/// @retval Ticks, at least 1; 0 if task callbacks are waiting;
+///         SOFT_TIMER_MAX_DELAY if no timer is armed.
+////////////////////////////////////////////////////////////////////////////////
+u32 SoftTimer_NextEvent(SoftTimer_TypeDef* st)
+{
+    u32 now = st->Now;
+    u32 best = SOFT_TIMER_MAX_DELAY;
+    u32 block, k, d;
+    u8 level, slot;
+
+    if (st->PendHead != NULL) {
+        return 0;
+    }
+    for (level = 0; level < SOFT_TIMER_LEVELS; level++) {
+        block = now >> (SOFT_TIMER_SLOT_BITS * level);
+        for (slot = 0; slot < SOFT_TIMER_SLOTS; slot++) {
+            if (st->Wheel[level][slot] == NULL) {
+                continue;
+            }
+            k = (slot - block) & (SOFT_TIMER_SLOTS - 1);
+            k = (k == 0) ? SOFT_TIMER_SLOTS : k;
+            d = ((block + k) << (SOFT_TIMER_SLOT_BITS * level)) - now;
+            best = (d < best) ? d : best;
+        }
+    }
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sleeps until the next wheel event or any interrupt, keeping the
+///         tick count continuous. Call from the main loop when idle.
+/// @param  st: pointer to the wheel state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_Idle(SoftTimer_TypeDef* st)
+{
+    TIM_TypeDef* tim = st->Timer;
+    u32 n, cnt, whole, late = 0;
+
+    {
+        DRV_ENTER_CRITICAL();
+        n = SoftTimer_NextEvent(st);
+        if ((n == 0) || ((tim != NULL) && (tim->SR & TIM_SR_UI))) {
+            DRV_EXIT_CRITICAL();
+            return;
+        }
+        if ((tim == NULL) || (n == 1)) {
+            PWR_EnterSLEEPMode(PWR_SLEEPNOW_WFI);
+            st->Sleeps++;
+            DRV_EXIT_CRITICAL();
+            return;
+        }
+        n = (n > SOFT_TIMER_IDLE_MAX) ? SOFT_TIMER_IDLE_MAX : n;
+        tim->ARR = n * st->Counts - 1;
+        PWR_EnterSLEEPMode(PWR_SLEEPNOW_WFI);
+
+        cnt = tim->CNT;
+        if (tim->SR & TIM_SR_UI) {
+            // The stretched period ended; the pending interrupt runs tick n
+            // and the ticks that passed since.
+            cnt   = tim->CNT;
+            whole = n - 1;
+            late  = cnt / st->Counts;
+            st->Backlog = late;
+            st->WakeLatencyLast = cnt;
+            st->WakeLatencyMax  = (cnt > st->WakeLatencyMax) ? cnt : st->WakeLatencyMax;
+        }
+        else {
+            whole = cnt / st->Counts;
+        }
+        tim->ARR = st->Counts - 1;
+        if (cnt >= st->Counts) {
+            tim->CNT = cnt % st->Counts;
+        }
+        st->Now       += whole;
+        st->IdleTicks += whole + late;
+        st->Sleeps++;
+        DRV_EXIT_CRITICAL();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the measured wakeup latency of tickless idle.
+/// @param  st: pointer to the wheel state.
+/// @param  worst: true for the maximum, false for the latest timer wakeup.
+/// @retval Latency in ns.
+////////////////////////////////////////////////////////////////////////////////
+u32 SoftTimer_GetWakeLatencyNs(SoftTimer_TypeDef* st, bool worst)
+{
+    u32 counts = worst ? st->WakeLatencyMax : st->WakeLatencyLast;
+
+    return (u32)((u64)counts * 1000000000 / st->TickClock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Tick interrupt service.
+/// @param  st: pointer to the wheel state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SoftTimer_IRQHandler(SoftTimer_TypeDef* st)
+{
+    if (st->Timer != NULL) {
+        if (!(st->Timer->SR & TIM_SR_UI)) {
+            return;
+        }
+        st->Timer->SR = ~TIM_SR_UI;
+    }
+    SoftTimer_Tick(st);
+    while (st->Backlog != 0) {
+        st->Backlog--;
+        SoftTimer_Tick(st);
+    }
+}
+
+/// @}
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     soft_timer.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE SOFTWARE
+///           TIMER SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __SOFT_TIMER_H
+#define __SOFT_TIMER_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SOFT_TIMER
+/// @brief Software timer service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SOFT_TIMER_Exported_Constants
+/// @{
+
+#define SOFT_TIMER_LEVELS           (6U)                                        ///< Wheel levels
+#define SOFT_TIMER_SLOT_BITS        (4U)                                        ///< log2 of the slots per level
+#define SOFT_TIMER_SLOTS            (1U << SOFT_TIMER_SLOT_BITS)
+#define SOFT_TIMER_MAX_DELAY        ((1UL << (SOFT_TIMER_LEVELS * SOFT_TIMER_SLOT_BITS)) - 1)   ///< Longer delays are clamped
+#define SOFT_TIMER_IDLE_MAX         (250U)                                      ///< Ticks slept at once by SoftTimer_Idle
+
+#define SOFT_TIMER_ISR              (0x01U)                                     ///< Callback runs in the tick interrupt
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SOFT_TIMER_Exported_Types
+/// @{
+
+struct _SoftTimerTimer;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Expiry hook. May start and stop timers, including itself.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*SoftTimer_Callback)(struct _SoftTimerTimer* timer, void* context);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Software timer, owned by the caller and linked into the wheel
+///         while active.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _SoftTimerTimer {
+    struct _SoftTimerTimer*         Next;
+    struct _SoftTimerTimer**        Prev;                                       ///< Link that points to this timer
+    struct _SoftTimerTimer*         PendNext;                                   ///< Task-context queue
+    u32                             Expiry;                                     ///< Absolute tick
+    u32                             Period;                                     ///< 0 = one-shot
+    SoftTimer_Callback              Callback;
+    void*                           Context;
+    volatile u8                     Flags;
+    u32                             Overruns;                                   ///< Task-context expiries merged
+} SoftTimer_TimerTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Timer wheel state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    SoftTimer_TimerTypeDef*         Wheel[SOFT_TIMER_LEVELS][SOFT_TIMER_SLOTS];
+    volatile u32                    Now;                                        ///< Ticks processed
+    TIM_TypeDef*                    Timer;                                      ///< Tick source, NULL = SysTick
+    u32                             TickHz;
+    u32                             TickClock;                                  ///< Tick source counter clock, Hz
+    u32                             Counts;                                     ///< Counter clocks per tick
+    volatile u32                    Backlog;                                    ///< Ticks the next tick interrupt runs late
+    SoftTimer_TimerTypeDef*         PendHead;
+    SoftTimer_TimerTypeDef*         PendTail;
+    u32                             Active;                                     ///< Timers in the wheel
+    u32                             Expired;
+    u32                             Cascaded;                                   ///< Timers moved down a level
+    u32                             Sleeps;                                     ///< SoftTimer_Idle calls that slept
+    u32                             IdleTicks;                                  ///< Ticks skipped while asleep
+    u32                             WakeLatencyLast;                            ///< Counter clocks, timer wakeup to resume
+    u32                             WakeLatencyMax;
+} SoftTimer_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SOFT_TIMER_Exported_Functions
+/// @{
+
+ErrorStatus SoftTimer_Init(SoftTimer_TypeDef* st, TIM_TypeDef* tim, u32 tick_hz);
+void SoftTimer_Setup(SoftTimer_TimerTypeDef* timer, SoftTimer_Callback callback, void* context, u8 flags);
+void SoftTimer_Start(SoftTimer_TypeDef* st, SoftTimer_TimerTypeDef* timer, u32 delay, u32 period);
+void SoftTimer_Stop(SoftTimer_TypeDef* st, SoftTimer_TimerTypeDef* timer);
+bool SoftTimer_IsActive(const SoftTimer_TimerTypeDef* timer);
+u32 SoftTimer_GetTicks(SoftTimer_TypeDef* st);
+void SoftTimer_Run(SoftTimer_TypeDef* st);
+void SoftTimer_Tick(SoftTimer_TypeDef* st);
+u32 SoftTimer_NextEvent(SoftTimer_TypeDef* st);
+void SoftTimer_Idle(SoftTimer_TypeDef* st);
+u32 SoftTimer_GetWakeLatencyNs(SoftTimer_TypeDef* st, bool worst);
+void SoftTimer_IRQHandler(SoftTimer_TypeDef* st);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __SOFT_TIMER_H
+////////////////////////////////////////////////////////////////////////////////
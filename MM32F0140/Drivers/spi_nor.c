@@ -0,0 +1,645 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_nor.c
+/// @brief    THIS FILE PROVIDES THE EXTERNAL SPI NOR FLASH DRIVER FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The driver sits on top of an SPI transaction queue and never blocks after
+/// SpiNor_Init:
+///   - reads use FAST_READ (0x0B) with the data phase received by DMA;
+///   - writes are split at page boundaries, the next page is copied into the
+///     second staging buffer while the current one is programmed;
+///   - busy waits are replaced by a one-pulse timer: each expiry reads the
+///     status register once, the period comes from the SFDP typical times;
+///   - a read arriving during a sector erase suspends the erase (if SFDP
+///     reports suspend support), runs, then resumes it. The erase is only
+///     suspended on a poll tick, so it always gets at least one poll period
+///     of progress between two suspends.
+/// The application forwards the poll timer vector, e.g.
+///   void TIM14_IRQHandler(void) { SpiNor_TimerIRQHandler(&nor); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SPI_NOR_C_
+
+// Files includes
+#include <string.h>
+#include "spi_nor.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup SPI_NOR
+/// @{
+
+#define SPI_NOR_SFDP_SIGNATURE      (0x50444653U)                               ///< "SFDP", little endian
+#define SPI_NOR_BFPT_DWORDS         (16U)
+#define SPI_NOR_SUSPEND_US          (30U)                                       ///< tSUS, suspend to WIP clear
+#define SPI_NOR_INIT_TIMEOUT        (0x100000U)
+
+static void SpiNor_Next(SpiNor_TypeDef* nor);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the poll timer.
+/// @param  nor: pointer to the driver state.
+/// @param  us: delay before the next status read, microseconds.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_Arm(SpiNor_TypeDef* nor, u16 us)
+{
+    TIM_Cmd(nor->PollTimer, DISABLE);
+    TIM_SetAutoreload(nor->PollTimer, (us > 1) ? us : 2);
+    TIM_SetCounter(nor->PollTimer, 0);
+    TIM_Cmd(nor->PollTimer, ENABLE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the command buffer with an opcode and a flash address.
+/// @param  nor: pointer to the driver state.
+/// @param  cmd: opcode.
+/// @param  addr: flash address.
+/// @param  dummy: number of dummy bytes appended.
+/// @retval Command length in bytes.
+////////////////////////////////////////////////////////////////////////////////
+static u16 SpiNor_FormatCmd(SpiNor_TypeDef* nor, u8 cmd, u32 addr, u8 dummy)
+{
+    u8* p = nor->CmdBuf;
+
+    *p++ = cmd;
+    if (nor->Info.AddrBytes == 4) {
+        *p++ = (u8)(addr >> 24);
+    }
+    *p++ = (u8)(addr >> 16);
+    *p++ = (u8)(addr >> 8);
+    *p++ = (u8)addr;
+    while (dummy--) {
+        *p++ = 0xFF;
+    }
+    return (u16)(p - nor->CmdBuf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Prepares a transfer descriptor owned by the driver.
+/// @param  nor: pointer to the driver state.
+/// @param  xfer: descriptor to fill.
+/// @param  tx: data to send, NULL for dummy bytes.
+/// @param  rx: receive buffer, NULL for transmit-only.
+/// @param  len: number of bytes.
+/// @param  keep_cs: keep the chip selected for the next transfer.
+/// @param  callback: completion hook or NULL.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_Prepare(SpiNor_TypeDef* nor, SpiQueue_TransferTypeDef* xfer, const void* tx, void* rx, u16 len,
+                           bool keep_cs, void (*callback)(SpiQueue_TransferTypeDef*))
+{
+    xfer->Device   = &nor->Device;
+    xfer->TxData   = tx;
+    xfer->RxData   = rx;
+    xfer->Length   = len;
+    xfer->KeepCS   = keep_cs;
+    xfer->Callback = callback;
+    xfer->Context  = nor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Runs a command and optional data phase and waits for it. Only used
+///         during initialization, before the driver is in service.
+/// @param  nor: pointer to the driver state.
+/// @param  cmd_len: bytes of nor->CmdBuf to send.
+/// @param  rx: receive buffer for the data phase.
+/// @param  rx_len: data phase length, 0 for a bare command.
+/// @retval ERROR on transfer error or timeout.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus SpiNor_Transact(SpiNor_TypeDef* nor, u16 cmd_len, u8* rx, u16 rx_len)
+{
+    SpiQueue_TransferTypeDef* last = (rx_len != 0) ? &nor->DataXfer : &nor->CmdXfer;
+    u32 timeout = SPI_NOR_INIT_TIMEOUT;
+
+    SpiNor_Prepare(nor, &nor->CmdXfer, nor->CmdBuf, NULL, cmd_len, rx_len != 0, NULL);
+    SpiNor_Prepare(nor, &nor->DataXfer, NULL, rx, rx_len, false, NULL);
+    {
+        DRV_ENTER_CRITICAL();
+        SpiQueue_Submit(nor->Queue, &nor->CmdXfer);
+        if (rx_len != 0) {
+            SpiQueue_Submit(nor->Queue, &nor->DataXfer);
+        }
+        DRV_EXIT_CRITICAL();
+    }
+    while ((last->Status == SPIQ_Status_Queued) || (last->Status == SPIQ_Status_Active)) {
+        if (--timeout == 0) {
+            return ERROR;
+        }
+    }
+    return ((nor->CmdXfer.Status == SPIQ_Status_Done) && (last->Status == SPIQ_Status_Done)) ? SUCCESS : ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reads the SFDP basic flash parameter table and fills nor->Info.
+/// @param  nor: pointer to the driver state.
+/// @retval ERROR if the device has no (readable) SFDP.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus SpiNor_ReadSFDP(SpiNor_TypeDef* nor)
+{
+    u8  raw[SPI_NOR_BFPT_DWORDS * 4];
+    u32 dw[SPI_NOR_BFPT_DWORDS + 1];                                            // dw[1] .. dw[16], JESD216 numbering
+    u32 ptr, count, i, units;
+    u8  saved = nor->Info.AddrBytes;
+
+    // SFDP addressing is always 3 bytes.
+    nor->Info.AddrBytes = 3;
+    if (SpiNor_Transact(nor, SpiNor_FormatCmd(nor, SPI_NOR_CMD_RDSFDP, 0, 1), raw, 16) != SUCCESS) {
+        nor->Info.AddrBytes = saved;
+        return ERROR;
+    }
+    if ((raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((u32)raw[3] << 24)) != SPI_NOR_SFDP_SIGNATURE) {
+        nor->Info.AddrBytes = saved;
+        return ERROR;
+    }
+    // First parameter header (offset 8) is the BFPT.
+    count = raw[11];
+    ptr   = raw[12] | (raw[13] << 8) | (raw[14] << 16);
+    if (count > SPI_NOR_BFPT_DWORDS) {
+        count = SPI_NOR_BFPT_DWORDS;
+    }
+    if ((count < 9) || (SpiNor_Transact(nor, SpiNor_FormatCmd(nor, SPI_NOR_CMD_RDSFDP, ptr, 1), raw, count * 4) != SUCCESS)) {
+        nor->Info.AddrBytes = saved;
+        return ERROR;
+    }
+    nor->Info.AddrBytes = saved;
+
+    memset(dw, 0, sizeof(dw));
+    for (i = 0; i < count; i++) {
+        dw[i + 1] = raw[i * 4] | (raw[i * 4 + 1] << 8) | (raw[i * 4 + 2] << 16) | ((u32)raw[i * 4 + 3] << 24);
+    }
+
+    // DWORD2: density in bits, or 2^N bits when bit 31 is set.
+    if (dw[2] & 0x80000000U) {
+        nor->Info.Capacity = ((dw[2] & 0x7FFFFFFFU) >= 35) ? 0x80000000U : (1U << ((dw[2] & 0x7FFFFFFFU) - 3));
+    }
+    else {
+        nor->Info.Capacity = (dw[2] + 1) >> 3;
+    }
+
+    // DWORD1: 4 KB erase opcode and addressing.
+    if ((dw[1] & 0x03U) == 0x01U) {
+        nor->Info.SectorSize = 4096;
+        nor->Info.EraseCmd   = (u8)(dw[1] >> 8);
+    }
+    else if ((dw[8] & 0xFFU) != 0) {
+        // DWORD8: erase type 1, size 2^N.
+        nor->Info.SectorSize = 1U << (dw[8] & 0xFFU);
+        nor->Info.EraseCmd   = (u8)(dw[8] >> 8);
+    }
+    nor->Info.AddrBytes = (((dw[1] >> 17) & 0x03U) == 0x02U) ? 4 : 3;
+
+    // DWORD10: typical erase time of erase type 1, poll at a quarter of it.
+    units = ((dw[10] >> 9) & 0x03U);
+    units = (units == 0) ? 1000 : (units == 1) ? 16000 : (units == 2) ? 128000 : 1000000;
+    units = ((((dw[10] >> 4) & 0x1FU) + 1) * units) >> 2;
+    if (dw[10] != 0) {
+        nor->Info.ErasePollUs = (units > 0xFFFFU) ? 0xFFFF : (u16)units;
+    }
+
+    // DWORD11 (JESD216A and later): page size and typical page program time.
+    if (count >= 11) {
+        nor->Info.PageSize      = (u16)(1U << ((dw[11] >> 4) & 0x0FU));
+        units                   = (dw[11] & (1U << 13)) ? 64 : 8;
+        nor->Info.ProgramPollUs = (u16)((((dw[11] >> 8) & 0x1FU) + 1) * units);
+    }
+
+    // DWORD12 bit 31 clear: suspend/resume supported, DWORD13 holds the opcodes.
+    if ((count >= 13) && !(dw[12] & 0x80000000U)) {
+        nor->Info.ResumeCmd  = (u8)(dw[13] >> 16);
+        nor->Info.SuspendCmd = (u8)(dw[13] >> 24);
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Copies the next page-bounded chunk of the write source into the
+///         free staging buffer.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_Stage(SpiNor_TypeDef* nor)
+{
+    u32 chunk = nor->Info.PageSize - (nor->WriteAddr & (nor->Info.PageSize - 1));
+
+    if (chunk > nor->WriteLen) {
+        chunk = nor->WriteLen;
+    }
+    memcpy(nor->Page[nor->PageIndex], nor->WriteSrc, chunk);
+    nor->PageFill  = (u16)chunk;
+    nor->WriteSrc += chunk;
+    nor->WriteLen -= chunk;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Completion of the last transfer of a read, program, erase, suspend
+///         or resume sequence.
+/// @param  xfer: completed transfer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_SequenceDone(SpiQueue_TransferTypeDef* xfer)
+{
+    SpiNor_TypeDef* nor = (SpiNor_TypeDef*)xfer->Context;
+    bool ok = (xfer->Status == SPIQ_Status_Done) && (nor->CmdXfer.Status == SPIQ_Status_Done);
+    SpiNor_Callback done;
+
+    switch (nor->State) {
+        case SPINOR_State_Read:
+            if (ok && (nor->ReadLen > xfer->Length)) {
+                nor->ReadAddr += xfer->Length;
+                nor->ReadBuf  += xfer->Length;
+                nor->ReadLen  -= xfer->Length;
+                nor->State     = SPINOR_State_Idle;
+                SpiNor_Next(nor);
+                return;
+            }
+            nor->ReadPending = false;
+            nor->State       = SPINOR_State_Idle;
+            done             = nor->ReadDone;
+            if (done != NULL) {
+                done(nor, ok ? SUCCESS : ERROR);
+            }
+            break;
+
+        case SPINOR_State_Program:
+            if (!ok) {
+                nor->WritePending = false;
+                nor->State        = SPINOR_State_Idle;
+                if (nor->WriteDone != NULL) {
+                    nor->WriteDone(nor, ERROR);
+                }
+                break;
+            }
+            nor->State = SPINOR_State_ProgramWait;
+            SpiNor_Arm(nor, nor->Info.ProgramPollUs);
+            return;
+
+        case SPINOR_State_Erase:
+            if (!ok) {
+                nor->EraseTail = (nor->EraseTail + 1) & (SPI_NOR_ERASE_QUEUE - 1);
+                nor->State     = SPINOR_State_Idle;
+                if (nor->EraseDone != NULL) {
+                    nor->EraseDone(nor, ERROR);
+                }
+                break;
+            }
+            nor->State = SPINOR_State_EraseWait;
+            SpiNor_Arm(nor, nor->Info.ErasePollUs);
+            return;
+
+        case SPINOR_State_Suspend:
+            SpiNor_Arm(nor, SPI_NOR_SUSPEND_US);
+            return;
+
+        default:
+            return;
+    }
+    SpiNor_Next(nor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Completion of a status register read.
+/// @param  xfer: completed status transfer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_StatusDone(SpiQueue_TransferTypeDef* xfer)
+{
+    SpiNor_TypeDef* nor = (SpiNor_TypeDef*)xfer->Context;
+    u16 period = (nor->State == SPINOR_State_ProgramWait) ? nor->Info.ProgramPollUs :
+                 (nor->State == SPINOR_State_EraseWait) ? nor->Info.ErasePollUs : SPI_NOR_SUSPEND_US;
+
+    if ((xfer->Status != SPIQ_Status_Done) || (nor->StatusRx[1] & SPI_NOR_SR_WIP)) {
+        SpiNor_Arm(nor, period);
+        return;
+    }
+
+    switch (nor->State) {
+        case SPINOR_State_ProgramWait:
+            nor->State = SPINOR_State_Idle;
+            if (nor->PageFill == 0) {
+                nor->WritePending = false;
+                if (nor->WriteDone != NULL) {
+                    nor->WriteDone(nor, SUCCESS);
+                }
+            }
+            break;
+
+        case SPINOR_State_EraseWait:
+            nor->EraseTail = (nor->EraseTail + 1) & (SPI_NOR_ERASE_QUEUE - 1);
+            nor->State     = SPINOR_State_Idle;
+            if (nor->EraseDone != NULL) {
+                nor->EraseDone(nor, SUCCESS);
+            }
+            break;
+
+        case SPINOR_State_Suspend:
+            nor->EraseSuspended = true;
+            nor->State          = SPINOR_State_Idle;
+            nor->Suspends++;
+            break;
+
+        default:
+            return;
+    }
+    SpiNor_Next(nor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Issues the next fast-read burst of the pending read.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_StartRead(SpiNor_TypeDef* nor)
+{
+    u16 chunk = (nor->ReadLen > SPI_NOR_READ_CHUNK) ? SPI_NOR_READ_CHUNK : (u16)nor->ReadLen;
+    u16 cmd_len = SpiNor_FormatCmd(nor, SPI_NOR_CMD_FAST_READ, nor->ReadAddr, 1);
+
+    nor->State = SPINOR_State_Read;
+    SpiNor_Prepare(nor, &nor->CmdXfer, nor->CmdBuf, NULL, cmd_len, true, NULL);
+    SpiNor_Prepare(nor, &nor->DataXfer, NULL, nor->ReadBuf, chunk, false, SpiNor_SequenceDone);
+    SpiQueue_Submit(nor->Queue, &nor->CmdXfer);
+    SpiQueue_Submit(nor->Queue, &nor->DataXfer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Issues WREN + PAGE PROGRAM for the staged page, then stages the
+///         following page into the other buffer while this one is sent.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_StartProgram(SpiNor_TypeDef* nor)
+{
+    u16 cmd_len = SpiNor_FormatCmd(nor, SPI_NOR_CMD_PP, nor->WriteAddr, 0);
+    u16 len     = nor->PageFill;
+
+    nor->State        = SPINOR_State_Program;
+    nor->WriteStarted = true;
+    SpiNor_Prepare(nor, &nor->WrenXfer, nor->WrenBuf, NULL, 1, false, NULL);
+    SpiNor_Prepare(nor, &nor->CmdXfer, nor->CmdBuf, NULL, cmd_len, true, NULL);
+    SpiNor_Prepare(nor, &nor->DataXfer, nor->Page[nor->PageIndex], NULL, len, false, SpiNor_SequenceDone);
+    SpiQueue_Submit(nor->Queue, &nor->WrenXfer);
+    SpiQueue_Submit(nor->Queue, &nor->CmdXfer);
+    SpiQueue_Submit(nor->Queue, &nor->DataXfer);
+
+    nor->WriteAddr += len;
+    nor->PageIndex ^= 1;
+    nor->PageFill   = 0;
+    if (nor->WriteLen != 0) {
+        SpiNor_Stage(nor);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Issues WREN + erase for the oldest queued sector.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_StartErase(SpiNor_TypeDef* nor)
+{
+    u16 cmd_len = SpiNor_FormatCmd(nor, nor->Info.EraseCmd, nor->EraseAddr[nor->EraseTail], 0);
+
+    nor->State = SPINOR_State_Erase;
+    SpiNor_Prepare(nor, &nor->WrenXfer, nor->WrenBuf, NULL, 1, false, NULL);
+    SpiNor_Prepare(nor, &nor->CmdXfer, nor->CmdBuf, NULL, cmd_len, false, SpiNor_SequenceDone);
+    SpiQueue_Submit(nor->Queue, &nor->WrenXfer);
+    SpiQueue_Submit(nor->Queue, &nor->CmdXfer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sends a one-byte suspend or resume opcode.
+/// @param  nor: pointer to the driver state.
+/// @param  cmd: opcode.
+/// @param  state: state entered while the opcode is on the bus.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_SendControl(SpiNor_TypeDef* nor, u8 cmd, SpiNor_State_TypeDef state)
+{
+    nor->State     = state;
+    nor->CmdBuf[0] = cmd;
+    SpiNor_Prepare(nor, &nor->CmdXfer, nor->CmdBuf, NULL, 1, false, SpiNor_SequenceDone);
+    SpiQueue_Submit(nor->Queue, &nor->CmdXfer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Picks the next operation when the flash is idle. Reads go first,
+///         a started write finishes before queued erases, a suspended erase
+///         only admits reads.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_Next(SpiNor_TypeDef* nor)
+{
+    if (nor->State != SPINOR_State_Idle) {
+        return;
+    }
+    if (nor->ReadPending) {
+        SpiNor_StartRead(nor);
+    }
+    else if (nor->EraseSuspended) {
+        nor->EraseSuspended = false;
+        SpiNor_SendControl(nor, nor->Info.ResumeCmd, SPINOR_State_Erase);
+    }
+    else if (nor->WritePending && nor->WriteStarted) {
+        SpiNor_StartProgram(nor);
+    }
+    else if (nor->EraseHead != nor->EraseTail) {
+        SpiNor_StartErase(nor);
+    }
+    else if (nor->WritePending) {
+        SpiNor_StartProgram(nor);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the next operation if the flash is idle, or brings the next
+///         erase poll forward so a new read can suspend the erase.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiNor_Kick(SpiNor_TypeDef* nor)
+{
+    DRV_ENTER_CRITICAL();
+    if (nor->State == SPINOR_State_Idle) {
+        SpiNor_Next(nor);
+    }
+    else if ((nor->State == SPINOR_State_EraseWait) && nor->ReadPending && (nor->Info.SuspendCmd != 0) &&
+             (nor->PollTimer->CR1 & TIM_CR1_CEN)) {
+        SpiNor_Arm(nor, 1);
+    }
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Identifies the flash and sets up the poll timer. Blocks on the
+///         queue, so the queue's interrupts must already be forwarded.
+/// @param  nor: pointer to the driver state.
+/// @param  queue: bus queue the flash is attached to.
+/// @param  device: bus settings, 8-bit frames, mode 0 or 3.
+/// @param  poll_timer: free basic timer (TIM14, TIM16, TIM17, ...).
+/// @retval ERROR if no flash answers or its size is unknown.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiNor_Init(SpiNor_TypeDef* nor, SpiQueue_TypeDef* queue, const SpiQueue_DeviceTypeDef* device, TIM_TypeDef* poll_timer)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    u8 id[3];
+
+    memset(nor, 0, sizeof(*nor));
+    nor->Queue      = queue;
+    nor->Device     = *device;
+    nor->PollTimer  = poll_timer;
+    nor->State      = SPINOR_State_Idle;
+    nor->WrenBuf[0] = SPI_NOR_CMD_WREN;
+    nor->StatusTx[0] = SPI_NOR_CMD_RDSR;
+    nor->StatusTx[1] = 0xFF;
+    SpiNor_Prepare(nor, &nor->StatusXfer, nor->StatusTx, nor->StatusRx, 2, false, SpiNor_StatusDone);
+
+    // Defaults for parts without SFDP.
+    nor->Info.AddrBytes     = 3;
+    nor->Info.PageSize      = 256;
+    nor->Info.SectorSize    = 4096;
+    nor->Info.EraseCmd      = SPI_NOR_CMD_SE;
+    nor->Info.ProgramPollUs = 400;
+    nor->Info.ErasePollUs   = 5000;
+
+    nor->CmdBuf[0] = SPI_NOR_CMD_RDID;
+    if (SpiNor_Transact(nor, 1, id, 3) != SUCCESS) {
+        return ERROR;
+    }
+    nor->Info.JedecId = (id[0] << 16) | (id[1] << 8) | id[2];
+    if ((nor->Info.JedecId == 0) || (nor->Info.JedecId == 0xFFFFFF)) {
+        return ERROR;
+    }
+    nor->Info.Capacity = ((id[2] >= 0x10) && (id[2] < 0x20)) ? (1U << id[2]) : 0;
+
+    nor->Info.HasSFDP = (SpiNor_ReadSFDP(nor) == SUCCESS);
+    if (nor->Info.Capacity == 0) {
+        return ERROR;
+    }
+    if (nor->Info.PageSize > SPI_NOR_PAGE_MAX) {
+        nor->Info.PageSize = SPI_NOR_PAGE_MAX;
+    }
+    if ((nor->Info.AddrBytes == 3) && (nor->Info.Capacity > 0x1000000U)) {
+        nor->CmdBuf[0] = SPI_NOR_CMD_EN4B;
+        if (SpiNor_Transact(nor, 1, NULL, 0) != SUCCESS) {
+            return ERROR;
+        }
+        nor->Info.AddrBytes = 4;
+    }
+
+    DRV_TimerClockCmd(poll_timer, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = (u16)(DRV_TimerClock(poll_timer) / 1000000 - 1);
+    tim_init.TIM_Period    = 0xFFFF;
+    TIM_TimeBaseInit(poll_timer, &tim_init);
+    TIM_SelectOnePulseMode(poll_timer, TIM_OPMode_Single);
+    TIM_ClearITPendingBit(poll_timer, TIM_IT_Update);
+    TIM_ITConfig(poll_timer, TIM_IT_Update, ENABLE);
+    DRV_NVICEnable(DRV_TimerIRQn(poll_timer), 2);
+
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Queues a read. Only one read may be outstanding.
+/// @param  nor: pointer to the driver state.
+/// @param  addr: flash address.
+/// @param  buf: destination, must stay valid until the callback.
+/// @param  len: number of bytes.
+/// @param  done: completion callback or NULL.
+/// @retval ERROR if a read is already pending or the range is invalid.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiNor_Read(SpiNor_TypeDef* nor, u32 addr, u8* buf, u32 len, SpiNor_Callback done)
+{
+    if (nor->ReadPending || (len == 0) || (addr + len > nor->Info.Capacity)) {
+        return ERROR;
+    }
+    nor->ReadAddr    = addr;
+    nor->ReadBuf     = buf;
+    nor->ReadLen     = len;
+    nor->ReadDone    = done;
+    nor->ReadPending = true;
+    SpiNor_Kick(nor);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Queues a program operation. The target range must be erased.
+/// @param  nor: pointer to the driver state.
+/// @param  addr: flash address, any alignment.
+/// @param  src: data, must stay valid until the callback.
+/// @param  len: number of bytes.
+/// @param  done: completion callback or NULL.
+/// @retval ERROR if a write is already pending or the range is invalid.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiNor_Write(SpiNor_TypeDef* nor, u32 addr, const u8* src, u32 len, SpiNor_Callback done)
+{
+    if (nor->WritePending || (len == 0) || (addr + len > nor->Info.Capacity)) {
+        return ERROR;
+    }
+    nor->WriteAddr    = addr;
+    nor->WriteSrc     = src;
+    nor->WriteLen     = len;
+    nor->WriteDone    = done;
+    nor->WriteStarted = false;
+    nor->PageIndex    = 0;
+    SpiNor_Stage(nor);
+    nor->WritePending = true;
+    SpiNor_Kick(nor);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Queues the erase of the sector containing addr. The callback runs
+///         once per sector.
+/// @param  nor: pointer to the driver state.
+/// @param  addr: any address inside the sector.
+/// @param  done: completion callback or NULL, shared by all queued erases.
+/// @retval ERROR if the erase queue is full or the address is invalid.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiNor_EraseSector(SpiNor_TypeDef* nor, u32 addr, SpiNor_Callback done)
+{
+    u8 next = (nor->EraseHead + 1) & (SPI_NOR_ERASE_QUEUE - 1);
+
+    if ((next == nor->EraseTail) || (addr >= nor->Info.Capacity)) {
+        return ERROR;
+    }
+    nor->EraseAddr[nor->EraseHead] = addr & ~(nor->Info.SectorSize - 1);
+    nor->EraseDone = done;
+    nor->EraseHead = next;
+    SpiNor_Kick(nor);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns whether any operation is pending or running.
+/// @param  nor: pointer to the driver state.
+/// @retval true if busy.
+////////////////////////////////////////////////////////////////////////////////
+bool SpiNor_IsBusy(SpiNor_TypeDef* nor)
+{
+    return (nor->State != SPINOR_State_Idle) || nor->ReadPending || nor->WritePending ||
+           nor->EraseSuspended || (nor->EraseHead != nor->EraseTail);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Poll timer interrupt service: reads the status register, or
+///         suspends the running erase when a read is waiting.
+/// @param  nor: pointer to the driver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiNor_TimerIRQHandler(SpiNor_TypeDef* nor)
+{
+    if (!TIM_GetITStatus(nor->PollTimer, TIM_IT_Update)) {
+        return;
+    }
+    TIM_ClearITPendingBit(nor->PollTimer, TIM_IT_Update);
+
+    if ((nor->State == SPINOR_State_EraseWait) && nor->ReadPending && (nor->Info.SuspendCmd != 0)) {
+        SpiNor_SendControl(nor, nor->Info.SuspendCmd, SPINOR_State_Suspend);
+        return;
+    }
+    nor->Polls++;
+    SpiQueue_Submit(nor->Queue, &nor->StatusXfer);
+}
+
+/// @}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_nor.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE EXTERNAL
+///           SPI NOR FLASH DRIVER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __SPI_NOR_H
+#define __SPI_NOR_H
+
+// Files includes
+#include "spi_queue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_NOR
+/// @brief External SPI NOR flash driver
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_NOR_Exported_Constants
+/// @{
+
+#define SPI_NOR_CMD_WREN            (0x06U)                                     ///< Write enable
+#define SPI_NOR_CMD_RDSR            (0x05U)                                     ///< Read status register 1
+#define SPI_NOR_CMD_FAST_READ       (0x0BU)                                     ///< Fast read, 8 dummy clocks
+#define SPI_NOR_CMD_PP              (0x02U)                                     ///< Page program
+#define SPI_NOR_CMD_SE              (0x20U)                                     ///< 4 KB sector erase
+#define SPI_NOR_CMD_RDID            (0x9FU)                                     ///< JEDEC ID
+#define SPI_NOR_CMD_RDSFDP          (0x5AU)                                     ///< Read SFDP, 8 dummy clocks
+#define SPI_NOR_CMD_EN4B            (0xB7U)                                     ///< Enter 4-byte address mode
+#define SPI_NOR_CMD_SUSPEND         (0x75U)                                     ///< Erase/program suspend
+#define SPI_NOR_CMD_RESUME          (0x7AU)                                     ///< Erase/program resume
+
+#define SPI_NOR_SR_WIP              (0x01U)                                     ///< Write in progress
+
+#define SPI_NOR_PAGE_MAX            (256U)                                      ///< Largest page the staging buffers hold
+#define SPI_NOR_ERASE_QUEUE         (8U)                                        ///< Pending sector erases, power of 2
+#define SPI_NOR_READ_CHUNK          (0xFFF0U)                                   ///< Bytes per DMA read burst
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_NOR_Exported_Types
+/// @{
+
+struct _SpiNor;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Completion callback, runs in interrupt context.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*SpiNor_Callback)(struct _SpiNor* nor, ErrorStatus status);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Driver state enum definition
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    SPINOR_State_Idle,
+    SPINOR_State_Read,                                                          ///< Fast-read burst on the bus
+    SPINOR_State_Program,                                                       ///< WREN + PP + data queued
+    SPINOR_State_ProgramWait,                                                   ///< Polling WIP after a page
+    SPINOR_State_Erase,                                                         ///< WREN + SE queued
+    SPINOR_State_EraseWait,                                                     ///< Polling WIP during an erase
+    SPINOR_State_Suspend                                                        ///< Suspend sent, waiting for WIP to clear
+} SpiNor_State_TypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Geometry and timings, filled from SFDP (or JEDEC ID defaults)
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32 JedecId;                                                                ///< Manufacturer, type, capacity
+    u32 Capacity;                                                               ///< Bytes
+    u16 PageSize;                                                               ///< Bytes
+    u32 SectorSize;                                                             ///< Smallest erase unit, bytes
+    u8  EraseCmd;                                                               ///< Opcode of SectorSize erase
+    u8  SuspendCmd;                                                             ///< 0 if erase suspend unsupported
+    u8  ResumeCmd;
+    u8  AddrBytes;                                                              ///< 3 or 4
+    u16 ProgramPollUs;                                                          ///< WIP poll period while programming
+    u16 ErasePollUs;                                                            ///< WIP poll period while erasing
+    bool HasSFDP;
+} SpiNor_InfoTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  NOR driver state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _SpiNor {
+    SpiQueue_TypeDef*           Queue;
+    SpiQueue_DeviceTypeDef      Device;
+    TIM_TypeDef*                PollTimer;                                      ///< One-pulse timer, 1 MHz tick
+    SpiNor_InfoTypeDef          Info;
+
+    volatile SpiNor_State_TypeDef State;
+    bool                        EraseSuspended;                                 ///< Erase parked, array readable
+
+    SpiQueue_TransferTypeDef    WrenXfer;
+    SpiQueue_TransferTypeDef    CmdXfer;
+    SpiQueue_TransferTypeDef    DataXfer;
+    SpiQueue_TransferTypeDef    StatusXfer;
+    u8                          WrenBuf[1];
+    u8                          CmdBuf[6];
+    u8                          StatusTx[2];
+    u8                          StatusRx[2];
+
+    // Read request
+    bool                        ReadPending;
+    u32                         ReadAddr;
+    u8*                         ReadBuf;
+    u32                         ReadLen;
+    SpiNor_Callback             ReadDone;
+
+    // Program request, two staging pages: one on the bus, one being filled
+    bool                        WritePending;
+    bool                        WriteStarted;                                   ///< At least one page issued
+    u32                         WriteAddr;                                      ///< Flash address of the staged page
+    const u8*                   WriteSrc;                                       ///< Next byte not yet staged
+    u32                         WriteLen;                                       ///< Bytes not yet staged
+    SpiNor_Callback             WriteDone;
+    u8                          Page[2][SPI_NOR_PAGE_MAX];
+    u8                          PageIndex;                                      ///< Page buffer holding the next chunk
+    u16                         PageFill;                                       ///< Bytes staged in Page[PageIndex]
+
+    // Erase ring
+    u32                         EraseAddr[SPI_NOR_ERASE_QUEUE];
+    u8                          EraseHead;
+    u8                          EraseTail;
+    SpiNor_Callback             EraseDone;
+
+    // Statistics
+    u32                         Polls;
+    u32                         Suspends;
+} SpiNor_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_NOR_Exported_Functions
+/// @{
+
+ErrorStatus SpiNor_Init(SpiNor_TypeDef* nor, SpiQueue_TypeDef* queue, const SpiQueue_DeviceTypeDef* device, TIM_TypeDef* poll_timer);
+ErrorStatus SpiNor_Read(SpiNor_TypeDef* nor, u32 addr, u8* buf, u32 len, SpiNor_Callback done);
+ErrorStatus SpiNor_Write(SpiNor_TypeDef* nor, u32 addr, const u8* src, u32 len, SpiNor_Callback done);
+ErrorStatus SpiNor_EraseSector(SpiNor_TypeDef* nor, u32 addr, SpiNor_Callback done);
+bool SpiNor_IsBusy(SpiNor_TypeDef* nor);
+void SpiNor_TimerIRQHandler(SpiNor_TypeDef* nor);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __SPI_NOR_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,490 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_queue.c
+/// @brief    THIS FILE PROVIDES THE SPI TRANSACTION QUEUE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// One queue per SPI bus. Transfers run over the bus's fixed DMA pair:
+///   SPI1: RX = DMA1_Channel2, TX = DMA1_Channel3 (DMA1_Channel2_3_IRQn)
+///   SPI2: RX = DMA1_Channel4, TX = DMA1_Channel5 (DMA1_Channel4_5_IRQn)
+/// The application forwards the DMA and SPI vectors, e.g.
+///   void DMA1_Channel2_3_IRQHandler(void) { SpiQueue_DMAIRQHandler(&spi1_queue); }
+///   void SPI1_IRQHandler(void)            { SpiQueue_IRQHandler(&spi1_queue); }
+///
+/// Full-duplex transfers complete on the RX channel. Transmit-only transfers
+/// complete on the SPI TXEPT interrupt, once the last frame left the shifter.
+///
+/// Packed transfers move the whole frames of a byte stream over the same DMA
+/// pair in 16- or 32-bit beats, so 4-byte frames take a quarter of the DMA
+/// beats of the 8-bit path and still one interrupt per transfer. They always
+/// run full duplex and complete on RX. For MSB-first devices the TX buffer
+/// is byte-swapped in place before the DMA starts and swapped back when it
+/// completes, and the received frames are swapped once they have landed, so
+/// the wire order matches the buffers; that costs about 10 cycles per frame
+/// and buffer. A tail shorter than a frame goes out as bytes from the SPI RX
+/// interrupt, which needs at most one entry for up to SPIQ_FIFO_DEPTH bytes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SPI_QUEUE_C_
+
+// Files includes
+#include "spi_queue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup SPI_QUEUE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Drives the chip-select of a device.
+/// @param  queue: pointer to the bus queue.
+/// @param  device: device to select or release.
+/// @param  state: ENABLE asserts (low), DISABLE releases.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_ChipSelect(SpiQueue_TypeDef* queue, const SpiQueue_DeviceTypeDef* device, FunctionalState state)
+{
+    if (device->CSPort != NULL) {
+        state ? GPIO_ResetBits(device->CSPort, device->CSPin) : GPIO_SetBits(device->CSPort, device->CSPin);
+    }
+    else {
+        SPI_CSInternalSelected(queue->SPI, state);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Applies a device's format, clock and width, and the RX direction.
+///         Registers are only touched when the cached value differs.
+/// @param  queue: pointer to the bus queue.
+/// @param  device: device about to be accessed.
+/// @param  rx: true when the transfer receives.
+/// @param  width: frame size in bits, the device's or the packed one.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_Configure(SpiQueue_TypeDef* queue, const SpiQueue_DeviceTypeDef* device, bool rx, u8 width)
+{
+    SPI_TypeDef* spi = queue->SPI;
+    u32 format = (u32)device->CPOL | (u32)device->CPHA | (u32)device->FirstBit;
+
+    if ((format != queue->Format) || ((u32)device->Prescaler != queue->Prescaler) || (width != queue->DataWidth)) {
+        SPI_Cmd(spi, DISABLE);
+        MODIFY_REG(spi->CCR, SPI_CCR_CPOL | SPI_CCR_CPHA | SPI_CCR_LSBFE, format);
+        MODIFY_REG(spi->BRR, BRR_Mask, device->Prescaler);
+        if (width != queue->DataWidth) {
+            SPI_DataSizeConfig(spi, width);
+            SPI_DataSizeTypeConfig(spi, (width > 8) ? SPI_DataSize_32b : SPI_DataSize_8b);
+        }
+        SPI_Cmd(spi, ENABLE);
+
+        queue->Format    = format;
+        queue->Prescaler = device->Prescaler;
+        queue->DataWidth = width;
+    }
+
+    if (rx != queue->RxEnabled) {
+        SPI_BiDirectionalLineConfig(spi, rx ? SPI_Direction_Rx : SPI_Disable_Rx);
+        queue->RxEnabled = rx;
+    }
+    if (rx) {
+        while (SPI_GetFlagStatus(spi, SPI_FLAG_RXAVL)) {
+            (void)SPI_ReceiveData(spi);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Releases another device if needed, configures the bus and selects
+///         the transfer's device.
+/// @param  queue: pointer to the bus queue.
+/// @param  device: device about to be accessed.
+/// @param  rx: true when the transfer receives.
+/// @param  width: frame size in bits.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_Select(SpiQueue_TypeDef* queue, const SpiQueue_DeviceTypeDef* device, bool rx, u8 width)
+{
+    if ((queue->Selected != NULL) && (queue->Selected != device)) {
+        SpiQueue_ChipSelect(queue, queue->Selected, DISABLE);
+        queue->Selected = NULL;
+    }
+    SpiQueue_Configure(queue, device, rx, width);
+    if (queue->Selected == NULL) {
+        SpiQueue_ChipSelect(queue, device, ENABLE);
+        queue->Selected = device;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reverses the byte order of every frame of a packed buffer.
+/// @param  buf: buffer aligned to the frame size.
+/// @param  frames: number of frames.
+/// @param  n: frame size in bytes (2 or 4).
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_Swap(void* buf, u16 frames, u8 n)
+{
+    u32* w = (u32*)buf;
+    u16* h = (u16*)buf;
+
+    if (n == 4) {
+        while (frames--) {
+            *w = __REV(*w);
+            w++;
+        }
+    }
+    else {
+        while (frames--) {
+            *h = (u16)((*h >> 8) | (*h << 8));
+            h++;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Packed mode tail service: drains received bytes and refills the
+///         TX FIFO up to SPIQ_FIFO_DEPTH bytes in flight, then picks the RX
+///         trigger level for the bytes left.
+/// @param  queue: pointer to the bus queue.
+/// @retval true once the whole transfer has been received.
+////////////////////////////////////////////////////////////////////////////////
+static bool SpiQueue_TailService(SpiQueue_TypeDef* queue)
+{
+    SpiQueue_TransferTypeDef* xfer = queue->Head;
+    SPI_TypeDef* spi = queue->SPI;
+    const u8* tx = (const u8*)xfer->TxData;
+    u8* rx = (u8*)xfer->RxData;
+    u32 frame;
+
+    while ((queue->RxPos < queue->TxPos) && SPI_GetFlagStatus(spi, SPI_FLAG_RXAVL)) {
+        frame = spi->RDR;
+        if (rx != NULL) {
+            rx[queue->RxPos] = (u8)frame;
+        }
+        queue->RxPos++;
+    }
+    if (queue->RxPos == xfer->Length) {
+        return true;
+    }
+
+    while ((queue->TxPos < xfer->Length) && ((u32)(queue->TxPos - queue->RxPos) < SPIQ_FIFO_DEPTH)) {
+        spi->TDR = (tx != NULL) ? tx[queue->TxPos] : 0xFF;
+        queue->TxPos++;
+    }
+    SPI_FifoTrigger(spi, SPI_RXTLF, ((u32)(queue->TxPos - queue->RxPos) >= SPIQ_FIFO_DEPTH / 2) ? ENABLE : DISABLE);
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the byte tail of a packed transfer on an 8-bit bus with
+///         empty FIFOs.
+/// @param  queue: pointer to the bus queue.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_StartTail(SpiQueue_TypeDef* queue)
+{
+    SPI_ClearITPendingBit(queue->SPI, SPI_IT_RX);
+    (void)SpiQueue_TailService(queue);
+    exSPI_ITConfig(queue->SPI, SPI_IT_RX, ENABLE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Ends the DMA part of a packed transfer: restores the byte order of
+///         the buffers and starts the tail, if any.
+/// @param  queue: pointer to the bus queue.
+/// @retval true if the transfer is complete.
+////////////////////////////////////////////////////////////////////////////////
+static bool SpiQueue_PackedDone(SpiQueue_TypeDef* queue)
+{
+    SpiQueue_TransferTypeDef* xfer = queue->Head;
+    u16 frames = queue->RxPos / xfer->Pack;
+
+    queue->TxChannel->CCR = 0;
+    queue->RxChannel->CCR = 0;
+    if (queue->Swapped) {
+        SpiQueue_Swap((void*)xfer->TxData, frames, xfer->Pack);
+        queue->Swapped = false;
+    }
+    if ((xfer->RxData != NULL) && (xfer->Device->FirstBit != SPI_FirstBit_LSB)) {
+        SpiQueue_Swap(xfer->RxData, frames, xfer->Pack);
+    }
+    if (queue->RxPos == xfer->Length) {
+        return true;
+    }
+    // FIFO and shifter are empty here, the width can change.
+    SpiQueue_Configure(queue, xfer->Device, true, 8);
+    SpiQueue_StartTail(queue);
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the transfer at the head of the queue.
+/// @param  queue: pointer to the bus queue.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_Start(SpiQueue_TypeDef* queue)
+{
+    SpiQueue_TransferTypeDef* xfer = queue->Head;
+    const SpiQueue_DeviceTypeDef* device = xfer->Device;
+    bool rx = (xfer->RxData != NULL);
+    u8  width = device->DataWidth;
+    u16 count = xfer->Length;
+    u32 size, ccr;
+
+    if (xfer->Pack > 1) {
+        // Whole frames by DMA, full duplex; the tail as bytes afterwards.
+        count        = xfer->Length / xfer->Pack;
+        width        = xfer->Pack * 8;
+        rx           = true;
+        queue->TxPos = (u16)(count * xfer->Pack);
+        queue->RxPos = queue->TxPos;
+        if (count == 0) {
+            SpiQueue_Select(queue, device, true, 8);
+            xfer->Status = SPIQ_Status_Active;
+            SpiQueue_StartTail(queue);
+            return;
+        }
+        if ((xfer->TxData != NULL) && (device->FirstBit != SPI_FirstBit_LSB)) {
+            SpiQueue_Swap((void*)xfer->TxData, count, xfer->Pack);
+            queue->Swapped = true;
+        }
+    }
+
+    if (width <= 8) {
+        size = DMA_CCR_MSIZE_BYTE | DMA_CCR_PSIZE_BYTE;
+    }
+    else if (width <= 16) {
+        size = DMA_CCR_MSIZE_HALFWORD | DMA_CCR_PSIZE_WORD;
+    }
+    else {
+        size = DMA_CCR_MSIZE_WORD | DMA_CCR_PSIZE_WORD;
+    }
+
+    SpiQueue_Select(queue, device, rx, width);
+    xfer->Status = SPIQ_Status_Active;
+
+    if (rx) {
+        ccr = size | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_VeryHigh;
+        ccr |= (xfer->RxData != NULL) ? DMA_CCR_MINC : 0;
+        DRV_DMAStart(queue->RxChannel, ccr, (u32)&queue->SPI->RDR,
+                     (xfer->RxData != NULL) ? (u32)xfer->RxData : (u32)&queue->Sink, count);
+    }
+
+    queue->Dummy = 0xFFFFFFFF;
+    ccr = size | DMA_CCR_DIR | DMA_CCR_TEIE | DMA_CCR_PL_High;
+    ccr |= (xfer->TxData != NULL) ? DMA_CCR_MINC : 0;
+    ccr |= rx ? 0 : DMA_CCR_TCIE;
+    DRV_DMAStart(queue->TxChannel, ccr, (u32)&queue->SPI->TDR,
+                 (xfer->TxData != NULL) ? (u32)xfer->TxData : (u32)&queue->Dummy, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Retires the head transfer and starts the next one.
+/// @param  queue: pointer to the bus queue.
+/// @param  status: SPIQ_Status_Done or SPIQ_Status_Error.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiQueue_Finish(SpiQueue_TypeDef* queue, SpiQueue_Status_TypeDef status)
+{
+    SpiQueue_TransferTypeDef* xfer = queue->Head;
+
+    queue->TxChannel->CCR = 0;
+    queue->RxChannel->CCR = 0;
+    if (xfer->Pack > 1) {
+        exSPI_ITConfig(queue->SPI, SPI_IT_RX, DISABLE);
+        SPI_FifoTrigger(queue->SPI, SPI_RXTLF, DISABLE);
+        if (queue->Swapped) {
+            // Aborted by a DMA error: give the caller its data back.
+            SpiQueue_Swap((void*)xfer->TxData, xfer->Length / xfer->Pack, xfer->Pack);
+            queue->Swapped = false;
+        }
+    }
+
+    if (!xfer->KeepCS || (status != SPIQ_Status_Done)) {
+        SpiQueue_ChipSelect(queue, xfer->Device, DISABLE);
+        queue->Selected = NULL;
+    }
+
+    queue->Head = xfer->Next;
+    if (queue->Head == NULL) {
+        queue->Tail = NULL;
+    }
+    xfer->Next   = NULL;
+    xfer->Status = status;
+    (status == SPIQ_Status_Done) ? queue->Completed++ : queue->Errors++;
+
+    if (xfer->Callback != NULL) {
+        xfer->Callback(xfer);
+    }
+    // The callback may already have started a newly submitted transfer.
+    if ((queue->Head != NULL) && (queue->Head->Status == SPIQ_Status_Queued)) {
+        SpiQueue_Start(queue);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Initializes a bus queue: SPI master with software NSS, DMA
+///         requests and the DMA/SPI interrupts. Pins are left to the caller.
+/// @param  queue: pointer to the bus queue.
+/// @param  spi: SPI1 or SPI2.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiQueue_Init(SpiQueue_TypeDef* queue, SPI_TypeDef* spi)
+{
+    SPI_InitTypeDef spi_init;
+
+    queue->SPI        = spi;
+    queue->Head       = NULL;
+    queue->Tail       = NULL;
+    queue->Selected   = NULL;
+    queue->Swapped    = false;
+    queue->Completed  = 0;
+    queue->Errors     = 0;
+    queue->PackedIRQs = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    if (spi == SPI1) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_SPI1, ENABLE);
+        queue->RxChannel = DMA1_Channel2;
+        queue->TxChannel = DMA1_Channel3;
+    }
+    else {
+        RCC_APB1PeriphClockCmd(RCC_APB1ENR_SPI2, ENABLE);
+        queue->RxChannel = DMA1_Channel4;
+        queue->TxChannel = DMA1_Channel5;
+    }
+
+    SPI_StructInit(&spi_init);
+    spi_init.SPI_Mode = SPI_Mode_Master;
+    spi_init.SPI_NSS  = SPI_NSS_Soft;
+    SPI_Init(spi, &spi_init);
+    SPI_CSInternalSelected(spi, DISABLE);
+    SPI_BiDirectionalLineConfig(spi, SPI_Direction_Tx);
+    SPI_BiDirectionalLineConfig(spi, SPI_Direction_Rx);
+    SPI_DMACmd(spi, ENABLE);
+    SET_BIT(spi->GCR, SPI_GCR_IEN);
+    SPI_Cmd(spi, ENABLE);
+
+    queue->Format    = (u32)spi_init.SPI_CPOL | (u32)spi_init.SPI_CPHA | (u32)spi_init.SPI_FirstBit;
+    queue->Prescaler = spi_init.SPI_BaudRatePrescaler;
+    queue->DataWidth = spi_init.SPI_DataWidth;
+    queue->RxEnabled = true;
+
+    DRV_NVICEnable((spi == SPI1) ? DMA1_Channel2_3_IRQn : DMA1_Channel4_5_IRQn, 1);
+    DRV_NVICEnable((spi == SPI1) ? SPI1_IRQn : SPI2_IRQn, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Appends a transfer to the bus queue and starts it if idle.
+/// @param  queue: pointer to the bus queue.
+/// @param  xfer: transfer descriptor, must stay valid until its callback.
+/// @retval ERROR if the descriptor is incomplete, already queued, or packed
+///         with a buffer not aligned to Pack.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiQueue_Submit(SpiQueue_TypeDef* queue, SpiQueue_TransferTypeDef* xfer)
+{
+    if ((xfer->Device == NULL) || (xfer->Length == 0) ||
+        (xfer->Status == SPIQ_Status_Queued) || (xfer->Status == SPIQ_Status_Active)) {
+        return ERROR;
+    }
+    if ((xfer->Pack > 1) && (((xfer->Pack != 2) && (xfer->Pack != 4)) || (xfer->Device->DataWidth != 8) ||
+                             ((((u32)xfer->TxData | (u32)xfer->RxData) & (xfer->Pack - 1)) != 0))) {
+        return ERROR;
+    }
+    xfer->Next   = NULL;
+    xfer->Status = SPIQ_Status_Queued;
+
+    {
+        DRV_ENTER_CRITICAL();
+        if (queue->Tail != NULL) {
+            queue->Tail->Next = xfer;
+            queue->Tail       = xfer;
+        }
+        else {
+            queue->Head = xfer;
+            queue->Tail = xfer;
+            SpiQueue_Start(queue);
+        }
+        DRV_EXIT_CRITICAL();
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns whether a transfer is queued or running.
+/// @param  queue: pointer to the bus queue.
+/// @retval true if busy.
+////////////////////////////////////////////////////////////////////////////////
+bool SpiQueue_IsBusy(SpiQueue_TypeDef* queue)
+{
+    return queue->Head != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service for the bus's channel pair. Only this bus's
+///         flags are read and cleared, so the vector can be shared.
+/// @param  queue: pointer to the bus queue.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiQueue_DMAIRQHandler(SpiQueue_TypeDef* queue)
+{
+    u32 isr   = DMA1->ISR;
+    u32 rx_tc = DMA_CHANNEL_FLAGS(queue->RxChannel, DMAx_FLAG_TCy);
+    u32 tx_tc = DMA_CHANNEL_FLAGS(queue->TxChannel, DMAx_FLAG_TCy);
+    u32 error = DMA_CHANNEL_FLAGS(queue->RxChannel, DMAx_FLAG_TEy) | DMA_CHANNEL_FLAGS(queue->TxChannel, DMAx_FLAG_TEy);
+    u32 all   = DMA_CHANNEL_FLAGS(queue->RxChannel, 0x0F) | DMA_CHANNEL_FLAGS(queue->TxChannel, 0x0F);
+
+    if (!(isr & all)) {
+        return;
+    }
+    DMA1->IFCR = isr & all;
+
+    if (queue->Head == NULL) {
+        return;
+    }
+    if (isr & error) {
+        SpiQueue_Finish(queue, SPIQ_Status_Error);
+    }
+    else if (queue->RxEnabled && (isr & rx_tc)) {
+        if ((queue->Head->Pack < 2) || SpiQueue_PackedDone(queue)) {
+            SpiQueue_Finish(queue, SPIQ_Status_Done);
+        }
+    }
+    else if (!queue->RxEnabled && (isr & tx_tc)) {
+        // Last frame is still in the FIFO; finish once the shifter drains.
+        // The flag latched while the FIFO was empty before the transfer, so
+        // clear it first, then catch a shifter that drained before enabling.
+        queue->TxChannel->CCR = 0;
+        SPI_ClearITPendingBit(queue->SPI, SPI_IT_TXEPT);
+        exSPI_ITConfig(queue->SPI, SPI_IT_TXEPT, ENABLE);
+        if (SPI_GetFlagStatus(queue->SPI, SPI_FLAG_TXEPT)) {
+            exSPI_ITConfig(queue->SPI, SPI_IT_TXEPT, DISABLE);
+            SPI_ClearITPendingBit(queue->SPI, SPI_IT_TXEPT);
+            SpiQueue_Finish(queue, SPIQ_Status_Done);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  SPI interrupt service, completes transmit-only transfers and
+///         services the byte tail of packed transfers.
+/// @param  queue: pointer to the bus queue.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiQueue_IRQHandler(SpiQueue_TypeDef* queue)
+{
+    if ((queue->SPI->IER & SPI_IT_RX) && SPI_GetITStatus(queue->SPI, SPI_IT_RX)) {
+        SPI_ClearITPendingBit(queue->SPI, SPI_IT_RX);
+        queue->PackedIRQs++;
+        if ((queue->Head != NULL) && SpiQueue_TailService(queue)) {
+            SpiQueue_Finish(queue, SPIQ_Status_Done);
+        }
+    }
+    if ((queue->SPI->IER & SPI_IT_TXEPT) && SPI_GetITStatus(queue->SPI, SPI_IT_TXEPT)) {
+        SPI_ClearITPendingBit(queue->SPI, SPI_IT_TXEPT);
+        exSPI_ITConfig(queue->SPI, SPI_IT_TXEPT, DISABLE);
+        if (queue->Head != NULL) {
+            SpiQueue_Finish(queue, SPIQ_Status_Done);
+        }
+    }
+}
+
+/// @}
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_queue.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE SPI
+///           TRANSACTION QUEUE (DMA FULL-DUPLEX, AUTOMATIC CHIP-SELECT).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __SPI_QUEUE_H
+#define __SPI_QUEUE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_QUEUE
+/// @brief SPI transaction queue driver
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_QUEUE_Exported_Constants
+/// @{
+
+#define SPIQ_FIFO_DEPTH             (4U)                                        ///< Bytes kept in flight in a packed tail
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_QUEUE_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Transaction status enum definition
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    SPIQ_Status_Idle,                                                           ///< Never submitted or already reported
+    SPIQ_Status_Queued,                                                         ///< Waiting for the bus
+    SPIQ_Status_Active,                                                         ///< DMA running
+    SPIQ_Status_Done,                                                           ///< Finished successfully
+    SPIQ_Status_Error                                                           ///< DMA transfer error
+} SpiQueue_Status_TypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Per-device bus settings. The CS pin must already be configured as
+///         a push-pull output; CSPort = NULL selects the SPI's own NSS output.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    SPI_CPOL_TypeDef                CPOL;                                       ///< Clock polarity
+    SPI_CPHA_TypeDef                CPHA;                                       ///< Clock phase
+    SPI_FirstBit_TypeDef            FirstBit;                                   ///< MSB or LSB first
+    SPI_BaudRatePrescaler_TypeDef   Prescaler;                                  ///< SCK = PCLK / Prescaler
+    u8                              DataWidth;                                  ///< Frame size, 1 .. 32 bits
+    GPIO_TypeDef*                   CSPort;                                     ///< Chip-select port, NULL for hardware NSS
+    u16                             CSPin;                                      ///< Chip-select pin mask
+} SpiQueue_DeviceTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Transaction descriptor. Owned by the caller until the callback
+///         runs; must not be modified while queued.
+///         Buffers hold one u8 per frame up to 8 bits, one u16 up to 16 bits,
+///         one u32 above. TxData = NULL clocks out 0xFF; RxData = NULL runs
+///         the transfer transmit-only.
+///         Pack = 2 or 4 sends a byte stream of an 8-bit device as 16- or
+///         32-bit frames by DMA: Length then counts bytes, the buffers must
+///         be aligned to Pack, the wire order is unchanged and a tail
+///         shorter than a frame goes out as bytes. For MSB-first devices
+///         TxData must be in RAM: it is byte-swapped in place while the
+///         transfer runs and restored before the callback.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _SpiQueue_Transfer {
+    const SpiQueue_DeviceTypeDef*   Device;                                     ///< Target device
+    const void*                     TxData;                                     ///< Frames to send, or NULL
+    void*                           RxData;                                     ///< Frames received, or NULL
+    u16                             Length;                                     ///< Number of frames
+    bool                            KeepCS;                                     ///< Keep CS asserted for the next transfer
+    u8                              Pack;                                       ///< 0, or bytes per frame in packed mode (2, 4)
+    void (*Callback)(struct _SpiQueue_Transfer* xfer);                          ///< Completion hook, runs in the DMA/SPI ISR
+    void*                           Context;                                    ///< Free for the caller
+    volatile SpiQueue_Status_TypeDef Status;                                    ///< Updated by the driver
+    struct _SpiQueue_Transfer*      Next;                                       ///< Queue link, driver private
+} SpiQueue_TransferTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Per-bus queue state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    SPI_TypeDef*                    SPI;
+    DMA_Channel_TypeDef*            TxChannel;
+    DMA_Channel_TypeDef*            RxChannel;
+    SpiQueue_TransferTypeDef*       Head;                                       ///< Active transfer
+    SpiQueue_TransferTypeDef*       Tail;
+    const SpiQueue_DeviceTypeDef*   Selected;                                   ///< Device whose CS is asserted
+    u32                             Format;                                     ///< Cached CPOL | CPHA | LSBFE
+    u32                             Prescaler;                                  ///< Cached BRR
+    u8                              DataWidth;                                  ///< Cached ECR width
+    bool                            RxEnabled;                                  ///< Cached RXEN
+    u16                             TxPos;                                      ///< Packed mode: bytes written to the FIFO
+    u16                             RxPos;                                      ///< Packed mode: bytes read back
+    bool                            Swapped;                                    ///< Packed mode: TxData is byte-swapped
+    u32                             Dummy;                                      ///< Fill word
+    u32                             Sink;                                       ///< Packed mode: discarded RX frames
+    u32                             Completed;                                  ///< Statistics
+    u32                             Errors;
+    u32                             PackedIRQs;                                 ///< Packed tail interrupts taken
+} SpiQueue_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_QUEUE_Exported_Functions
+/// @{
+
+void SpiQueue_Init(SpiQueue_TypeDef* queue, SPI_TypeDef* spi);
+ErrorStatus SpiQueue_Submit(SpiQueue_TypeDef* queue, SpiQueue_TransferTypeDef* xfer);
+bool SpiQueue_IsBusy(SpiQueue_TypeDef* queue);
+void SpiQueue_DMAIRQHandler(SpiQueue_TypeDef* queue);
+void SpiQueue_IRQHandler(SpiQueue_TypeDef* queue);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __SPI_QUEUE_H
+////////////////////////////////////////////////////////////////////////////////
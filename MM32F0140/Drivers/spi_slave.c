@@ -0,0 +1,292 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_slave.c
+/// @brief    THIS FILE PROVIDES THE SPI SLAVE STREAMING RECEIVER FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The SPI RX DMA channel runs in circular mode over the ring buffer and is
+/// never stopped, so no byte depends on interrupt latency. The rising edge of
+/// NSS (EXTI) closes a frame: the DMA write position at that moment, extended
+/// to an absolute count with the lap counter, is the frame's end. Frames are
+/// published as pointers into the ring and stay valid until released.
+///
+/// The application forwards three vectors, all at the same priority so none
+/// preempts another while the lap counter is read:
+///   void DMA1_Channel2_3_IRQHandler(void) { SpiSlave_DMAIRQHandler(&slave); }
+///   void EXTI4_15_IRQHandler(void)        { SpiSlave_NSSIRQHandler(&slave); }
+///   void SPI1_IRQHandler(void)            { SpiSlave_IRQHandler(&slave); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _SPI_SLAVE_C_
+
+// Files includes
+#include "spi_slave.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup SPI_SLAVE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Absolute number of bytes written by the DMA so far. A lap whose TC
+///         interrupt is still pending is accounted for.
+/// @param  slave: pointer to the receiver state.
+/// @retval Byte count.
+////////////////////////////////////////////////////////////////////////////////
+static u32 SpiSlave_Position(SpiSlave_TypeDef* slave)
+{
+    u32 laps = slave->Laps;
+    u32 pos  = slave->Size - slave->Channel->CNDTR;
+
+    if ((DMA1->ISR & DMA_CHANNEL_FLAGS(slave->Channel, DMAx_FLAG_TCy)) && (pos < (u32)(slave->Size >> 1))) {
+        laps++;
+    }
+    return laps * slave->Size + pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Builds the consumer view of a queued frame.
+/// @param  slave: pointer to the receiver state.
+/// @param  slot: index in the frame queue, between Tail and Head.
+/// @param  frame: filled with pointers into the ring buffer.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+static void SpiSlave_Describe(SpiSlave_TypeDef* slave, u8 slot, SpiSlave_FrameTypeDef* frame)
+{
+    u32 offset = slave->Start[slot] & (slave->Size - 1);
+    u32 first  = slave->Size - offset;
+
+    if (first > slave->Length[slot]) {
+        first = slave->Length[slot];
+    }
+    frame->Data       = slave->Buffer + offset;
+    frame->Length     = (u16)first;
+    frame->WrapLength = (u16)(slave->Length[slot] - first);
+    frame->Wrap       = (frame->WrapLength != 0) ? slave->Buffer : NULL;
+    frame->Sequence   = slave->Sequence - ((slave->Head - slot) & (SPI_SLAVE_FRAMES - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default receiver settings: SPI1 mode 0, MSB first.
+/// @param  init_struct: pointer to a SpiSlave_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiSlave_StructInit(SpiSlave_InitTypeDef* init_struct)
+{
+    init_struct->SPI        = SPI1;
+    init_struct->CPOL       = SPI_CPOL_Low;
+    init_struct->CPHA       = SPI_CPHA_1Edge;
+    init_struct->FirstBit   = SPI_FirstBit_MSB;
+    init_struct->HighSpeed  = true;
+    init_struct->Buffer     = NULL;
+    init_struct->BufferSize = 0;
+    init_struct->NSSPort    = GPIOA;
+    init_struct->NSSPin     = GPIO_Pin_4;
+    init_struct->Callback   = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures the SPI as an 8-bit receive-only slave with hardware
+///         NSS, starts the circular DMA and arms the NSS rising edge.
+/// @param  slave: pointer to the receiver state.
+/// @param  init_struct: pointer to a SpiSlave_InitTypeDef structure.
+/// @retval ERROR if the buffer size is not a power of 2.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus SpiSlave_Init(SpiSlave_TypeDef* slave, const SpiSlave_InitTypeDef* init_struct)
+{
+    SPI_InitTypeDef  spi_init;
+    EXTI_InitTypeDef exti_init;
+    SPI_TypeDef* spi = init_struct->SPI;
+    u8 pin = 0;
+
+    if ((init_struct->Buffer == NULL) || (init_struct->BufferSize < 2) ||
+        (init_struct->BufferSize & (init_struct->BufferSize - 1))) {
+        return ERROR;
+    }
+    while ((pin < 15) && !(init_struct->NSSPin & (1U << pin))) {
+        pin++;
+    }
+
+    slave->SPI          = spi;
+    slave->Buffer       = init_struct->Buffer;
+    slave->Size         = init_struct->BufferSize;
+    slave->NSSLine      = 1U << pin;
+    slave->Callback     = init_struct->Callback;
+    slave->Laps         = 0;
+    slave->FrameStart   = 0;
+    slave->Consumed     = 0;
+    slave->Sequence     = 0;
+    slave->Head         = 0;
+    slave->Tail         = 0;
+    slave->Frames       = 0;
+    slave->DataOverruns = 0;
+    slave->FrameDrops   = 0;
+    slave->SpiOverruns  = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    RCC_APB2PeriphClockCmd(RCC_APB2ENR_EXTI, ENABLE);
+    if (spi == SPI1) {
+        RCC_APB2PeriphClockCmd(RCC_APB2ENR_SPI1, ENABLE);
+        slave->Channel = DMA1_Channel2;
+    }
+    else {
+        RCC_APB1PeriphClockCmd(RCC_APB1ENR_SPI2, ENABLE);
+        slave->Channel = DMA1_Channel4;
+    }
+
+    SPI_StructInit(&spi_init);
+    spi_init.SPI_Mode      = SPI_Mode_Slave;
+    spi_init.SPI_NSS       = SPI_NSS_Hard;
+    spi_init.SPI_DataWidth = SPI_DataWidth_8b;
+    spi_init.SPI_CPOL      = init_struct->CPOL;
+    spi_init.SPI_CPHA      = init_struct->CPHA;
+    spi_init.SPI_FirstBit  = init_struct->FirstBit;
+    SPI_Init(spi, &spi_init);
+    SPI_SlaveAdjust(spi, init_struct->HighSpeed ? SPI_SlaveAdjust_FAST : SPI_SlaveAdjust_LOW);
+    exSPI_DataEdgeAdjust(spi, init_struct->HighSpeed ? SPI_DataEdgeAdjust_FAST : SPI_DataEdgeAdjust_LOW);
+    SPI_BiDirectionalLineConfig(spi, SPI_Disable_Tx);
+    SPI_BiDirectionalLineConfig(spi, SPI_Direction_Rx);
+
+    DRV_DMAStart(slave->Channel,
+                 DMA_CCR_MSIZE_BYTE | DMA_CCR_PSIZE_BYTE | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_TCIE | DMA_CCR_PL_VeryHigh,
+                 (u32)&spi->RDR, (u32)slave->Buffer, slave->Size);
+    SPI_DMACmd(spi, ENABLE);
+    SPI_ClearITPendingBit(spi, SPI_IT_RXOERR);
+    exSPI_ITConfig(spi, SPI_IT_RXOERR, ENABLE);
+    SET_BIT(spi->GCR, SPI_GCR_IEN);
+    SPI_Cmd(spi, ENABLE);
+
+    EXTI_LineConfig((u8)(((u32)init_struct->NSSPort - GPIOA_BASE) >> 10), pin);
+    EXTI_StructInit(&exti_init);
+    exti_init.EXTI_Line    = slave->NSSLine;
+    exti_init.EXTI_Mode    = EXTI_Mode_Interrupt;
+    exti_init.EXTI_Trigger = EXTI_Trigger_Rising;
+    exti_init.EXTI_LineCmd = ENABLE;
+    EXTI_Init(&exti_init);
+    EXTI_ClearITPendingBit(slave->NSSLine);
+
+    DRV_NVICEnable((spi == SPI1) ? DMA1_Channel2_3_IRQn : DMA1_Channel4_5_IRQn, 0);
+    DRV_NVICEnable((spi == SPI1) ? SPI1_IRQn : SPI2_IRQn, 0);
+    DRV_NVICEnable((pin < 2) ? EXTI0_1_IRQn : (pin < 4) ? EXTI2_3_IRQn : EXTI4_15_IRQn, 0);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the oldest published frame without removing it.
+/// @param  slave: pointer to the receiver state.
+/// @param  frame: filled with pointers into the ring buffer.
+/// @retval false if no frame is waiting.
+////////////////////////////////////////////////////////////////////////////////
+bool SpiSlave_GetFrame(SpiSlave_TypeDef* slave, SpiSlave_FrameTypeDef* frame)
+{
+    bool found;
+
+    // The NSS interrupt advances Head and Sequence, and Tail on an overrun.
+    DRV_ENTER_CRITICAL();
+    found = (slave->Tail != slave->Head);
+    if (found) {
+        SpiSlave_Describe(slave, slave->Tail, frame);
+    }
+    DRV_EXIT_CRITICAL();
+    return found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Hands a frame's bytes back to the DMA. Frames are released in
+///         order; a frame already discarded by an overrun is ignored.
+/// @param  slave: pointer to the receiver state.
+/// @param  frame: frame returned by SpiSlave_GetFrame or the callback.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiSlave_Release(SpiSlave_TypeDef* slave, const SpiSlave_FrameTypeDef* frame)
+{
+    DRV_ENTER_CRITICAL();
+    if ((slave->Tail != slave->Head) && (frame->Sequence == slave->Sequence - ((slave->Head - slave->Tail) & (SPI_SLAVE_FRAMES - 1)))) {
+        slave->Tail     = (slave->Tail + 1) & (SPI_SLAVE_FRAMES - 1);
+        slave->Consumed = (slave->Tail != slave->Head) ? slave->Start[slave->Tail] : slave->FrameStart;
+    }
+    DRV_EXIT_CRITICAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service, counts ring laps.
+/// @param  slave: pointer to the receiver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiSlave_DMAIRQHandler(SpiSlave_TypeDef* slave)
+{
+    u32 tc = DMA_CHANNEL_FLAGS(slave->Channel, DMAx_FLAG_TCy);
+
+    if (DMA1->ISR & tc) {
+        DMA1->IFCR = tc | DMA_CHANNEL_FLAGS(slave->Channel, DMAx_FLAG_GLy);
+        slave->Laps++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  NSS rising edge service: closes the current frame and publishes
+///         it, or drops it when the consumer fell a ring behind.
+/// @param  slave: pointer to the receiver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiSlave_NSSIRQHandler(SpiSlave_TypeDef* slave)
+{
+    u32 end, length;
+    u8  next;
+    SpiSlave_FrameTypeDef frame;
+
+    if (!EXTI_GetITStatus(slave->NSSLine)) {
+        return;
+    }
+    EXTI_ClearITPendingBit(slave->NSSLine);
+
+    end    = SpiSlave_Position(slave);
+    length = end - slave->FrameStart;
+    if (length == 0) {
+        return;
+    }
+
+    if (end - slave->Consumed > slave->Size) {
+        // Unreleased frames were overwritten: discard them all.
+        slave->DataOverruns++;
+        slave->Tail     = slave->Head;
+        slave->Consumed = slave->FrameStart;
+        if (length > slave->Size) {
+            slave->FrameStart = end;
+            slave->Consumed   = end;
+            return;
+        }
+    }
+
+    next = (slave->Head + 1) & (SPI_SLAVE_FRAMES - 1);
+    if (next == slave->Tail) {
+        slave->FrameDrops++;
+        slave->FrameStart = end;
+        return;
+    }
+    slave->Start[slave->Head]  = slave->FrameStart;
+    slave->Length[slave->Head] = length;
+    slave->Head                = next;
+    slave->FrameStart          = end;
+    slave->Sequence++;
+    slave->Frames++;
+
+    if (slave->Callback != NULL) {
+        SpiSlave_Describe(slave, (next - 1) & (SPI_SLAVE_FRAMES - 1), &frame);
+        slave->Callback(slave, &frame);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  SPI interrupt service, counts RX FIFO overruns.
+/// @param  slave: pointer to the receiver state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void SpiSlave_IRQHandler(SpiSlave_TypeDef* slave)
+{
+    if (SPI_GetITStatus(slave->SPI, SPI_IT_RXOERR)) {
+        SPI_ClearITPendingBit(slave->SPI, SPI_IT_RXOERR);
+        slave->SpiOverruns++;
+    }
+}
+
+/// @}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     spi_slave.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE SPI SLAVE
+///           STREAMING RECEIVER (CIRCULAR DMA, NSS FRAME DELIMITING).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __SPI_SLAVE_H
+#define __SPI_SLAVE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_SLAVE
+/// @brief SPI slave streaming receiver
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_SLAVE_Exported_Constants
+/// @{
+
+#define SPI_SLAVE_FRAMES            (8U)                                        ///< Published frames awaiting release, power of 2
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_SLAVE_Exported_Types
+/// @{
+
+struct _SpiSlave;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  A received frame, pointing into the ring buffer. A frame that
+///         crosses the end of the ring continues at Wrap.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    const u8*   Data;                                                           ///< First segment
+    u16         Length;
+    const u8*   Wrap;                                                           ///< Second segment, NULL if none
+    u16         WrapLength;
+    u32         Sequence;                                                       ///< Frame number, pass back to SpiSlave_Release
+} SpiSlave_FrameTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Frame published hook, runs in the NSS interrupt. The frame stays
+///         valid until released.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*SpiSlave_Callback)(struct _SpiSlave* slave, const SpiSlave_FrameTypeDef* frame);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  SPI slave receiver init structure definition. The NSS pin must be
+///         configured as the SPI's NSS alternate function by the caller; its
+///         input also feeds the EXTI line that closes each frame.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    SPI_TypeDef*            SPI;                                                ///< SPI1 or SPI2
+    SPI_CPOL_TypeDef        CPOL;
+    SPI_CPHA_TypeDef        CPHA;
+    SPI_FirstBit_TypeDef    FirstBit;
+    bool                    HighSpeed;                                          ///< Fast slave/data edge adjustment
+    u8*                     Buffer;                                             ///< Ring buffer
+    u16                     BufferSize;                                         ///< Power of 2
+    GPIO_TypeDef*           NSSPort;
+    u16                     NSSPin;                                             ///< Single pin mask
+    SpiSlave_Callback       Callback;                                           ///< Optional, NULL to poll
+} SpiSlave_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Receiver state. Positions are absolute byte counts since Init,
+///         the ring offset is the low bits.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _SpiSlave {
+    SPI_TypeDef*            SPI;
+    DMA_Channel_TypeDef*    Channel;
+    u8*                     Buffer;
+    u16                     Size;
+    u32                     NSSLine;                                            ///< EXTI line mask
+    SpiSlave_Callback       Callback;
+
+    volatile u32            Laps;                                               ///< Completed DMA passes over the ring
+    u32                     FrameStart;                                         ///< Start of the frame being received
+    volatile u32            Consumed;                                           ///< Everything before this is released
+    u32                     Start[SPI_SLAVE_FRAMES];
+    u32                     Length[SPI_SLAVE_FRAMES];
+    u32                     Sequence;                                           ///< Number of the next published frame
+    volatile u8             Head;
+    volatile u8             Tail;
+
+    // Statistics
+    u32                     Frames;                                             ///< Frames published
+    u32                     DataOverruns;                                       ///< Unreleased data overwritten by DMA
+    u32                     FrameDrops;                                         ///< Frame queue full
+    u32                     SpiOverruns;                                        ///< RX FIFO overrun, DMA too late
+} SpiSlave_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup SPI_SLAVE_Exported_Functions
+/// @{
+
+void SpiSlave_StructInit(SpiSlave_InitTypeDef* init_struct);
+ErrorStatus SpiSlave_Init(SpiSlave_TypeDef* slave, const SpiSlave_InitTypeDef* init_struct);
+bool SpiSlave_GetFrame(SpiSlave_TypeDef* slave, SpiSlave_FrameTypeDef* frame);
+void SpiSlave_Release(SpiSlave_TypeDef* slave, const SpiSlave_FrameTypeDef* frame);
+void SpiSlave_DMAIRQHandler(SpiSlave_TypeDef* slave);
+void SpiSlave_NSSIRQHandler(SpiSlave_TypeDef* slave);
+void SpiSlave_IRQHandler(SpiSlave_TypeDef* slave);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __SPI_SLAVE_H
+////////////////////////////////////////////////////////////////////////////////
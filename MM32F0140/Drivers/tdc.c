@@ -0,0 +1,306 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     tdc.c
+/// @brief    THIS FILE PROVIDES THE TIME INTERVAL MEASUREMENT (TDC) SERVICE
+///           FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The counter runs free at its full clock. CH1 captures the start edge,
+/// and CH2 the stop edge, both configured through TIM_ICInit. The stop
+/// event raises a CC2 DMA burst of two (DCR at CCR1), which stores the
+/// latest start and the stop into the next buffer entry. A batch of any
+/// size up to 32767 therefore fills with no CPU work per measurement. Each
+/// measurement costs two DMA transfers. The next start must not come
+/// before the burst has read CCR1, about 0.3 us later.
+///
+/// A single measurement is quantised to one clock (13.9 ns at 72 MHz).
+/// When the edges are asynchronous to the timer clock, an interval of
+/// k + f clocks reads k or k + 1, with probability 1 - f and f. The batch
+/// mean therefore converges to the true interval, and its standard error,
+/// noise / sqrt(count), is reported as the effective resolution. With
+/// 10000 measurements at 72 MHz, that is under 70 ps. Edges locked to the
+/// timer clock do not dither, and then averaging gains nothing. The noise
+/// histogram shows this case: a single occupied bin.
+///
+/// Tdc_Calibrate applies a two-point linear calibration, interpolating
+/// between two known intervals:
+///   - zero: the same edge fed to both inputs, giving the skew of the two
+///     input paths (synchroniser and filter);
+///   - reference: a known interval, giving the true clock period.
+/// Results are in picoseconds, for intervals up to 4.2 ms: Tdc_Init and
+/// Tdc_Calibrate keep MaxTicks within that, which also keeps MeanQ8 and its
+/// signed offset correction from wrapping on the 32-bit TIM2. Tdc_Process
+/// costs about 80 cycles per measurement (two passes), off the capture
+/// path.
+///
+/// CC2 requests: TIM1 and TIM2 both use DMA1_Channel3. The application
+/// forwards the DMA vector:
+///   void DMA1_Channel2_3_IRQHandler(void) { Tdc_DMAIRQHandler(&tdc); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _TDC_C_
+
+// Files includes
+#include "tdc.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup TDC
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the longest interval whose calibrated value still fits
+///         IntervalPs, 2^32 ps, at the current clock period. On TIM2 the
+///         counter range is far longer, and MeanQ8 would wrap too.
+/// @param  tdc: pointer to the TDC state.
+/// @retval Timer ticks.
+////////////////////////////////////////////////////////////////////////////////
+static u32 Tdc_PsLimit(const Tdc_TypeDef* tdc)
+{
+    return (u32)(((u64)0xFFFFFFFF << 8) / tdc->PsPerClockQ8);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default TDC settings: TIM2, rising edges, no filter.
+/// @param  init_struct: pointer to a Tdc_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Tdc_StructInit(Tdc_InitTypeDef* init_struct)
+{
+    init_struct->Timer         = TIM2;
+    init_struct->StartPolarity = TIM_ICPolarity_Rising;
+    init_struct->StopPolarity  = TIM_ICPolarity_Rising;
+    init_struct->Filter        = 0;
+    init_struct->MaxTicks      = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Configures the start and stop captures with the counter at its
+///         full clock, and an uncalibrated (nominal) clock period.
+/// @param  tdc: pointer to the TDC state.
+/// @param  init_struct: pointer to a Tdc_InitTypeDef structure.
+/// @retval ERROR if the timer has no CC2 DMA or its clock is unknown.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Tdc_Init(Tdc_TypeDef* tdc, const Tdc_InitTypeDef* init_struct)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_ICInitTypeDef ic_init;
+    TIM_TypeDef* tim = init_struct->Timer;
+
+    if ((tim != TIM1) && (tim != TIM2)) {
+        return ERROR;
+    }
+    tdc->Clock = DRV_TimerClock(tim);
+    if (tdc->Clock == 0) {
+        return ERROR;
+    }
+    tdc->Timer        = tim;
+    tdc->Channel      = DRV_TimerDMAChannel(tim, TIM_DMA_CC2);
+    tdc->OffsetQ8     = 0;
+    tdc->PsPerClockQ8 = (u32)((1000000000000ULL << 8) / tdc->Clock);
+    tdc->Buffer       = NULL;
+    tdc->Count        = 0;
+    tdc->Busy         = false;
+    tdc->Batches      = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = 0xFFFFFFFF;
+    TIM_TimeBaseInit(tim, &tim_init);
+    tdc->Mask     = tim->ARR;
+    tdc->MaxTicks = ((init_struct->MaxTicks != 0) && (init_struct->MaxTicks < tdc->Mask)) ?
+                    init_struct->MaxTicks : (tdc->Mask >> 1);
+    if (tdc->MaxTicks > Tdc_PsLimit(tdc)) {
+        tdc->MaxTicks = Tdc_PsLimit(tdc);
+    }
+
+    TIM_ICStructInit(&ic_init);
+    ic_init.TIM_Channel     = TIM_Channel_1;
+    ic_init.TIM_ICPolarity  = init_struct->StartPolarity;
+    ic_init.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    ic_init.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    ic_init.TIM_ICFilter    = init_struct->Filter;
+    TIM_ICInit(tim, &ic_init);
+    ic_init.TIM_Channel     = TIM_Channel_2;
+    ic_init.TIM_ICPolarity  = init_struct->StopPolarity;
+    TIM_ICInit(tim, &ic_init);
+    TIM_DMAConfig(tim, TIM_DMABase_CCR1, TIM_DMABurstLength_2Bytes);
+
+    DRV_NVICEnable(DRV_DMAIRQn(tdc->Channel), 1);
+    TIM_Cmd(tim, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Captures the next count measurements into buffer.
+/// @param  tdc: pointer to the TDC state.
+/// @param  buffer: count samples, untouched until the batch completes.
+/// @param  count: measurements, 1..32767.
+/// @retval ERROR if a batch is running or the parameters are invalid.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Tdc_Start(Tdc_TypeDef* tdc, Tdc_SampleTypeDef* buffer, u16 count)
+{
+    if (tdc->Busy || (buffer == NULL) || (count == 0) || (count > 0x7FFF)) {
+        return ERROR;
+    }
+    tdc->Buffer = buffer;
+    tdc->Count  = count;
+    tdc->Busy   = true;
+    // Drop a stop captured before the batch.
+    (void)tdc->Timer->CCR2;
+    DRV_DMAStart(tdc->Channel,
+                 DMA_CCR_MINC | DMA_CCR_PSIZE_WORD | DMA_CCR_MSIZE_WORD | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_VeryHigh,
+                 (u32)&tdc->Timer->DMAR, (u32)buffer, (u16)(count * 2));
+    TIM_DMACmd(tdc->Timer, TIM_DMA_CC2, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Abandons the running batch.
+/// @param  tdc: pointer to the TDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Tdc_Stop(Tdc_TypeDef* tdc)
+{
+    TIM_DMACmd(tdc->Timer, TIM_DMA_CC2, DISABLE);
+    tdc->Channel->CCR = 0;
+    DMA1->IFCR = DMA_CHANNEL_FLAGS(tdc->Channel, DMAx_FLAG_GLy | DMAx_FLAG_TCy | DMAx_FLAG_HTy | DMAx_FLAG_TEy);
+    tdc->Count = 0;
+    tdc->Busy  = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Reduces the last completed batch: mean, noise, calibrated
+///         interval, effective resolution, throughput and noise histogram.
+///         Throughput spans the first start to the last stop, so with a
+///         16-bit timer, measurements must come less than 0.9 ms apart.
+/// @param  tdc: pointer to the TDC state.
+/// @param  result: receives the statistics.
+/// @retval ERROR while a batch runs, or if no measurement was in range.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Tdc_Process(Tdc_TypeDef* tdc, Tdc_ResultTypeDef* result)
+{
+    Tdc_SampleTypeDef* s = tdc->Buffer;
+    u32 count = tdc->Count;
+    u32 n = 0, ref = 0, span = 0, iv, i, bin;
+    u64 sum = 0, sq = 0, var, ps;
+    s64 dev = 0, mdev;
+    s32 d, mean;
+    u8 shift;
+
+    if (tdc->Busy || (s == NULL) || (count == 0)) {
+        return ERROR;
+    }
+    for (i = 0; i < count; i++) {
+        if (i != 0) {
+            span += (s[i].Start - s[i - 1].Start) & tdc->Mask;
+        }
+        iv = (s[i].Stop - s[i].Start) & tdc->Mask;
+        if (iv > tdc->MaxTicks) {
+            continue;
+        }
+        if (n == 0) {
+            ref = iv;
+        }
+        d    = (s32)(iv - ref);
+        dev += d;
+        sq  += (u64)((s64)d * d);
+        sum += iv;
+        n++;
+    }
+    span += (s[count - 1].Stop - s[count - 1].Start) & tdc->Mask;
+
+    result->Count      = n;
+    result->Rejected   = count - n;
+    result->Throughput = (span != 0) ? (u32)((u64)count * tdc->Clock / span) : 0;
+    if (n == 0) {
+        return ERROR;
+    }
+    result->MeanQ8 = (u32)((sum << 8) / n);
+    // Variance in 1/65536 clock^2 unless it would overflow.
+    shift = (sq < ((u64)1 << 47)) ? 8 : 0;
+    mdev  = dev * ((s64)1 << shift) / (s64)n;
+    var   = (sq << (2 * shift)) / n;
+    var   = (var > (u64)(mdev * mdev)) ? var - (u64)(mdev * mdev) : 0;
+    result->NoiseQ8 = DRV_Sqrt(var) << (8 - shift);
+
+    mean = (s32)result->MeanQ8 - tdc->OffsetQ8;
+    ps   = (mean > 0) ? (u64)mean * tdc->PsPerClockQ8 : 0;
+    result->IntervalPs   = (u32)(ps >> 16);
+    result->NoisePs      = (u32)(((u64)result->NoiseQ8 * tdc->PsPerClockQ8) >> 16);
+    result->ResolutionPs = (u32)((u64)result->NoisePs * 16 / DRV_Sqrt((u64)n << 8));
+
+    // Histogram around the mean: Histogram[7] holds floor(mean).
+    result->Base = ((result->MeanQ8 >> 8) > (TDC_BINS / 2 - 1)) ? (result->MeanQ8 >> 8) - (TDC_BINS / 2 - 1) : 0;
+    for (i = 0; i < TDC_BINS; i++) {
+        result->Histogram[i] = 0;
+    }
+    for (i = 0; i < count; i++) {
+        iv = (s[i].Stop - s[i].Start) & tdc->Mask;
+        if (iv > tdc->MaxTicks) {
+            continue;
+        }
+        bin = (iv > result->Base) ? iv - result->Base : 0;
+        bin = (bin < TDC_BINS) ? bin : TDC_BINS - 1;
+        if (result->Histogram[bin] != 0xFFFF) {
+            result->Histogram[bin]++;
+        }
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Two-point calibration from batches of known intervals. The stop
+///         path must not be faster than the start path, or zero-length
+///         intervals wrap and are rejected.
+/// @param  tdc: pointer to the TDC state.
+/// @param  zero: batch with the same edge on both inputs, or NULL to keep
+///         the offset.
+/// @param  ref: batch of a known interval, or NULL to keep the clock period.
+/// @param  ref_ps: the known interval, in picoseconds.
+/// @retval ERROR if the reference is not longer than the offset.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Tdc_Calibrate(Tdc_TypeDef* tdc, const Tdc_ResultTypeDef* zero, const Tdc_ResultTypeDef* ref, u32 ref_ps)
+{
+    s32 offset = (zero != NULL) ? (s32)zero->MeanQ8 : tdc->OffsetQ8;
+
+    if (ref != NULL) {
+        if ((s32)ref->MeanQ8 <= offset) {
+            return ERROR;
+        }
+        tdc->PsPerClockQ8 = (u32)(((u64)ref_ps << 16) / (u32)((s32)ref->MeanQ8 - offset));
+        if (tdc->MaxTicks > Tdc_PsLimit(tdc)) {
+            tdc->MaxTicks = Tdc_PsLimit(tdc);
+        }
+    }
+    tdc->OffsetQ8 = offset;
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service: ends the batch.
+/// @param  tdc: pointer to the TDC state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Tdc_DMAIRQHandler(Tdc_TypeDef* tdc)
+{
+    u32 isr = DMA1->ISR & DMA_CHANNEL_FLAGS(tdc->Channel, 0x0F);
+
+    if (isr == 0) {
+        return;
+    }
+    DMA1->IFCR = isr;
+    if (isr & DMA_CHANNEL_FLAGS(tdc->Channel, DMAx_FLAG_TEy)) {
+        Tdc_Stop(tdc);
+        return;
+    }
+    if (isr & DMA_CHANNEL_FLAGS(tdc->Channel, DMAx_FLAG_TCy)) {
+        TIM_DMACmd(tdc->Timer, TIM_DMA_CC2, DISABLE);
+        tdc->Channel->CCR = 0;
+        tdc->Batches++;
+        tdc->Busy = false;
+    }
+}
+
+/// @}
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     tdc.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE TIME
+///           INTERVAL MEASUREMENT (TDC) SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __TDC_H
+#define __TDC_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TDC
+/// @brief Time interval measurement service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TDC_Exported_Constants
+/// @{
+
+#define TDC_BINS                    (16U)                                       ///< Noise histogram bins, one clock each
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TDC_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  One measurement, as read by the CC2 DMA burst
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             Start;                                      ///< CCR1: latest start edge
+    u32                             Stop;                                       ///< CCR2: stop edge
+} Tdc_SampleTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  TDC init structure definition. The start (CH1) and stop (CH2)
+///         pins are left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Timer;                                      ///< TIM2 (32 bits) or TIM1
+    TIMICP_Typedef                  StartPolarity;
+    TIMICP_Typedef                  StopPolarity;
+    u8                              Filter;                                     ///< Input filter, 0..15, on both inputs
+    u32                             MaxTicks;                                   ///< Longer intervals are rejected, 0 for half the range, at most 4.2 ms
+} Tdc_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Statistics of one batch
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u32                             Count;                                      ///< Accepted measurements
+    u32                             Rejected;                                   ///< Stops without a start in range
+    u32                             MeanQ8;                                     ///< Mean interval, 1/256 clock
+    u32                             NoiseQ8;                                    ///< Standard deviation, 1/256 clock
+    u32                             IntervalPs;                                 ///< Calibrated mean
+    u32                             NoisePs;
+    u32                             ResolutionPs;                               ///< Standard error of the mean
+    u32                             Throughput;                                 ///< Measurements per second
+    u32                             Base;                                       ///< Clocks counted in Histogram[0]
+    u16                             Histogram[TDC_BINS];                        ///< Saturating, end bins take the outliers
+} Tdc_ResultTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  TDC state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Timer;
+    DMA_Channel_TypeDef*            Channel;
+    u32                             Clock;                                      ///< Counter clock, Hz
+    u32                             Mask;                                       ///< Counter range - 1
+    u32                             MaxTicks;
+    s32                             OffsetQ8;                                   ///< Input skew, 1/256 clock
+    u32                             PsPerClockQ8;                               ///< Calibrated clock period, 1/256 ps
+    Tdc_SampleTypeDef*              Buffer;
+    u16                             Count;
+    volatile bool                   Busy;                                       ///< A batch is being captured
+    u32                             Batches;
+} Tdc_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TDC_Exported_Functions
+/// @{
+
+void Tdc_StructInit(Tdc_InitTypeDef* init_struct);
+ErrorStatus Tdc_Init(Tdc_TypeDef* tdc, const Tdc_InitTypeDef* init_struct);
+ErrorStatus Tdc_Start(Tdc_TypeDef* tdc, Tdc_SampleTypeDef* buffer, u16 count);
+void Tdc_Stop(Tdc_TypeDef* tdc);
+ErrorStatus Tdc_Process(Tdc_TypeDef* tdc, Tdc_ResultTypeDef* result);
+ErrorStatus Tdc_Calibrate(Tdc_TypeDef* tdc, const Tdc_ResultTypeDef* zero, const Tdc_ResultTypeDef* ref, u32 ref_ps);
+void Tdc_DMAIRQHandler(Tdc_TypeDef* tdc);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __TDC_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,315 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     tim_wave.c
+/// @brief    THIS FILE PROVIDES THE TIMER DMA-BURST WAVEFORM ENGINE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// DCR points the timer's DMA burst at CCR1 with a length of Channels.
+/// Each update event then raises Channels DMA requests, and every DMAR
+/// write lands in the next CCR. One table step holds the compares of one
+/// period, and the DMA walks the table with no CPU involvement. CCR
+/// preload is enabled: a step written during period k takes effect at the
+/// update that ends it, so the output trails the table by one period, and
+/// a step can never be half applied.
+///
+/// Four duty cycles at 20 kHz cost 80k DMA transfers per second, and no
+/// interrupt per period. In circular mode the half/full transfer
+/// interrupts hand back the half the DMA left, e.g. 625 Hz for a 64-step
+/// table. u16 tables are zero-extended into the 32-bit DMAR, so TIM2
+/// compares are limited to 16 bits. u8 tables halve the memory whenever
+/// the period fits in 256 clocks.
+///
+/// Update requests are served by fixed channels:
+///   TIM1 = DMA1_Channel5, TIM2 = DMA1_Channel2, TIM3 = DMA1_Channel3,
+///   TIM16 = DMA1_Channel3 (4 remapped), TIM17 = DMA1_Channel1 (2 remapped)
+/// and the application forwards the DMA vector, e.g.
+///   void DMA1_Channel4_5_IRQHandler(void) { TimWave_DMAIRQHandler(&wave); }
+///
+/// WS2812 strips use a one-shot u8 table on CC1: one slot per bit, 1.25 us
+/// each, a 0.40 us pulse for 0 and 0.80 us for 1, then TIM_WAVE_LED_RESET
+/// low slots that latch the frame. The application writes RGB triples at
+/// the start of the frame buffer. TimWave_LedEncode expands them in place,
+/// from the last LED back, into 24 compares each. That costs about 150
+/// cycles per LED, and the bits themselves cost no CPU. 100 LEDs take
+/// 2448 slots (3.1 ms on the wire) in a 2448-byte buffer. The expansion
+/// consumes the pixels, so they are rewritten before each show.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _TIM_WAVE_C_
+
+// Files includes
+#include "tim_wave.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup TIM_WAVE
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills the default waveform settings: TIM1, four channels,
+///         circular u16 table.
+/// @param  init_struct: pointer to a TimWave_InitTypeDef structure.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void TimWave_StructInit(TimWave_InitTypeDef* init_struct)
+{
+    init_struct->Timer     = TIM1;
+    init_struct->Channels  = 4;
+    init_struct->ByteTable = false;
+    init_struct->Table     = NULL;
+    init_struct->Steps     = 0;
+    init_struct->Circular  = true;
+    init_struct->Callback  = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Points the timer's DMA burst at CCR1..CCRn, enables the compare
+///         preloads and prepares the DMA channel. The table does not play
+///         until TimWave_Start.
+/// @param  wave: pointer to the waveform state.
+/// @param  init_struct: pointer to a TimWave_InitTypeDef structure.
+/// @retval ERROR on invalid parameters, a table longer than one DMA count
+///         (Steps x Channels above 0xFFFF) or a timer without update DMA.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus TimWave_Init(TimWave_TypeDef* wave, const TimWave_InitTypeDef* init_struct)
+{
+    TIM_TypeDef* tim = init_struct->Timer;
+    u8 n = init_struct->Channels;
+    bool single = (tim == TIM16) || (tim == TIM17);
+
+    wave->Channel = DRV_TimerDMAChannel(tim, TIM_DMA_Update);
+    if ((wave->Channel == NULL) || (n == 0) || (n > 4) || (single && (n > 1)) ||
+        (init_struct->Table == NULL) || (init_struct->Steps == 0) || ((u32)init_struct->Steps * n > 0xFFFF) ||
+        (init_struct->Circular && (init_struct->Steps & 1))) {
+        return ERROR;
+    }
+    wave->Timer     = tim;
+    wave->Table     = (u8*)init_struct->Table;
+    wave->Steps     = init_struct->Steps;
+    wave->Channels  = n;
+    wave->ItemBytes = init_struct->ByteTable ? 1 : 2;
+    wave->Circular  = init_struct->Circular;
+    wave->Busy      = false;
+    wave->Callback  = init_struct->Callback;
+    wave->LedZero   = 0;
+    wave->LedOne    = 0;
+    wave->Halves    = 0;
+    wave->Late      = 0;
+    wave->Errors    = 0;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBENR_DMA1, ENABLE);
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_DMAConfig(tim, TIM_DMABase_CCR1, (TIMDMABURSTLENGTH_Typedef)((u32)(n - 1) << 8));
+    TIM_OC1PreloadConfig(tim, TIM_OCPreload_Enable);
+    if (n > 1) {
+        TIM_OC2PreloadConfig(tim, TIM_OCPreload_Enable);
+    }
+    if (n > 2) {
+        TIM_OC3PreloadConfig(tim, TIM_OCPreload_Enable);
+    }
+    if (n > 3) {
+        TIM_OC4PreloadConfig(tim, TIM_OCPreload_Enable);
+    }
+    DRV_NVICEnable(DRV_DMAIRQn(wave->Channel), 1);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts playing the table from its first step, at the next update
+///         event. The timer must be running.
+/// @param  wave: pointer to the waveform state.
+/// @retval ERROR if the table is already playing.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus TimWave_Start(TimWave_TypeDef* wave)
+{
+    u32 ccr = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_WORD | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_PL_VeryHigh;
+
+    if (wave->Busy) {
+        return ERROR;
+    }
+    ccr |= (wave->ItemBytes == 1) ? DMA_CCR_MSIZE_BYTE : DMA_CCR_MSIZE_HALFWORD;
+    ccr |= wave->Circular ? (DMA_CCR_CIRC | DMA_CCR_HTIE) : 0;
+    wave->Busy = true;
+    DRV_DMAStart(wave->Channel, ccr, (u32)&wave->Timer->DMAR, (u32)wave->Table,
+                 (u16)((u32)wave->Steps * wave->Channels));
+    TIM_DMACmd(wave->Timer, TIM_DMA_Update, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Stops the table. The compares keep the last step loaded.
+/// @param  wave: pointer to the waveform state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void TimWave_Stop(TimWave_TypeDef* wave)
+{
+    TIM_DMACmd(wave->Timer, TIM_DMA_Update, DISABLE);
+    wave->Channel->CCR = 0;
+    DMA1->IFCR = DMA_CHANNEL_FLAGS(wave->Channel, DMAx_FLAG_GLy | DMAx_FLAG_TCy | DMAx_FLAG_HTy | DMAx_FLAG_TEy);
+    wave->Busy = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sets up a timer channel 1 as a WS2812 data output: 800 kHz PWM,
+///         idle low, and a one-shot u8 table over the frame buffer. The pin
+///         is left to the caller.
+/// @param  wave: pointer to the waveform state.
+/// @param  tim: TIM1, TIM2, TIM3, TIM16 or TIM17.
+/// @param  frame: TIM_WAVE_LED_BYTES(leds) bytes.
+/// @param  leds: LEDs on the strip.
+/// @retval ERROR if the timer clock is unknown or the timer has no update DMA.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus TimWave_LedInit(TimWave_TypeDef* wave, TIM_TypeDef* tim, u8* frame, u16 leds)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    TIM_OCInitTypeDef oc_init;
+    TimWave_InitTypeDef wave_init;
+    u32 clock = DRV_TimerClock(tim);
+    u32 prescaler, period;
+
+    if ((clock == 0) || (TIM_WAVE_LED_BYTES(leds) > 0xFFFF)) {
+        return ERROR;
+    }
+    TimWave_StructInit(&wave_init);
+    wave_init.Timer     = tim;
+    wave_init.Channels  = 1;
+    wave_init.ByteTable = true;
+    wave_init.Table     = frame;
+    wave_init.Steps     = (u16)TIM_WAVE_LED_BYTES(leds);
+    wave_init.Circular  = false;
+    if (TimWave_Init(wave, &wave_init) != SUCCESS) {
+        return ERROR;
+    }
+
+    // The compares must fit in a byte: prescale if a bit lasts 256 clocks or more.
+    prescaler     = clock / TIM_WAVE_LED_HZ / 256 + 1;
+    period        = clock / prescaler / TIM_WAVE_LED_HZ;
+    wave->LedZero = (u8)((period * 8 + 12) / 25);                               // 0.40 of 1.25 us
+    wave->LedOne  = (u8)((period * 16 + 12) / 25);                              // 0.80 of 1.25 us
+
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = prescaler - 1;
+    tim_init.TIM_Period    = period - 1;
+    TIM_TimeBaseInit(tim, &tim_init);
+    TIM_ARRPreloadConfig(tim, ENABLE);
+
+    TIM_OCStructInit(&oc_init);
+    oc_init.TIM_OCMode      = TIM_OCMode_PWM1;
+    oc_init.TIM_OutputState = TIM_OutputState_Enable;
+    oc_init.TIM_Pulse       = 0;
+    oc_init.TIM_OCPolarity  = TIM_OCPolarity_High;
+    TIM_OC1Init(tim, &oc_init);
+    TIM_OC1PreloadConfig(tim, TIM_OCPreload_Enable);
+    if ((tim == TIM1) || (tim == TIM16) || (tim == TIM17)) {
+        TIM_CtrlPWMOutputs(tim, ENABLE);
+    }
+    TIM_Cmd(tim, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Expands the RGB triples at the start of the frame buffer, in
+///         place, into one compare per bit in G-R-B order, and appends the
+///         latch slots. LED n's slots start at byte 24n, beyond the pixels
+///         of all LEDs before it, so working from the last LED back never
+///         overwrites a pixel not yet read.
+/// @param  wave: pointer to a waveform set up by TimWave_LedInit.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void TimWave_LedEncode(TimWave_TypeDef* wave)
+{
+    u16 leds = (u16)((wave->Steps - TIM_WAVE_LED_RESET) / TIM_WAVE_LED_BITS);
+    u8* rgb  = wave->Table + (u32)leds * 3;
+    u8* out  = wave->Table + (u32)leds * TIM_WAVE_LED_BITS;
+    u8 zero  = wave->LedZero;
+    u8 one   = wave->LedOne;
+    u32 grb, i;
+
+    for (i = 0; i < TIM_WAVE_LED_RESET; i++) {
+        out[i] = 0;
+    }
+    while (leds-- != 0) {
+        rgb -= 3;
+        out -= TIM_WAVE_LED_BITS;
+        grb  = ((u32)rgb[1] << 16) | ((u32)rgb[0] << 8) | rgb[2];
+        for (i = 0; i < TIM_WAVE_LED_BITS; i++) {
+            out[i] = (grb & 0x800000) ? one : zero;
+            grb  <<= 1;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Encodes the frame buffer and sends it to the strip. Completion
+///         is signalled by the callback, or by Busy going false.
+/// @param  wave: pointer to a waveform set up by TimWave_LedInit.
+/// @retval ERROR if the previous frame is still being sent.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus TimWave_LedShow(TimWave_TypeDef* wave)
+{
+    if (wave->Busy) {
+        return ERROR;
+    }
+    TimWave_LedEncode(wave);
+    return TimWave_Start(wave);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  DMA interrupt service: hands back the half the DMA just left, or
+///         ends a one-shot table. Only this waveform's flags are read and
+///         cleared.
+/// @param  wave: pointer to the waveform state.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void TimWave_DMAIRQHandler(TimWave_TypeDef* wave)
+{
+    u32 isr   = DMA1->ISR & DMA_CHANNEL_FLAGS(wave->Channel, 0x0F);
+    u32 ht    = DMA_CHANNEL_FLAGS(wave->Channel, DMAx_FLAG_HTy);
+    u32 tc    = DMA_CHANNEL_FLAGS(wave->Channel, DMAx_FLAG_TCy);
+    u16 half  = wave->Steps / 2;
+    u32 items = (u32)half * wave->Channels;
+
+    if (isr == 0) {
+        return;
+    }
+    DMA1->IFCR = isr;
+
+    if (isr & DMA_CHANNEL_FLAGS(wave->Channel, DMAx_FLAG_TEy)) {
+        wave->Errors++;
+        TimWave_Stop(wave);
+        return;
+    }
+    if (!wave->Circular) {
+        if (isr & tc) {
+            // The last step sits in the preload registers and still plays
+            // for one period; the request is no longer needed.
+            TIM_DMACmd(wave->Timer, TIM_DMA_Update, DISABLE);
+            wave->Channel->CCR = 0;
+            wave->Busy = false;
+            wave->Halves++;
+            if (wave->Callback != NULL) {
+                wave->Callback(wave, wave->Table, wave->Steps);
+            }
+        }
+        return;
+    }
+    if ((isr & ht) && (isr & tc)) {
+        // Serviced a whole table late: the current position tells which
+        // half is safe, the other one is already being played.
+        wave->Late++;
+        isr &= (wave->Channel->CNDTR > items) ? ~ht : ~tc;
+    }
+    if (isr & ht) {
+        wave->Halves++;
+        if (wave->Callback != NULL) {
+            wave->Callback(wave, wave->Table, half);
+        }
+    }
+    if (isr & tc) {
+        wave->Halves++;
+        if (wave->Callback != NULL) {
+            wave->Callback(wave, wave->Table + items * wave->ItemBytes, half);
+        }
+    }
+}
+
+/// @}
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     tim_wave.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE TIMER
+///           DMA-BURST WAVEFORM ENGINE AND THE WS2812 LED ENCODER.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __TIM_WAVE_H
+#define __TIM_WAVE_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIM_WAVE
+/// @brief Timer DMA-burst waveform engine
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIM_WAVE_Exported_Constants
+/// @{
+
+#define TIM_WAVE_LED_HZ             (800000U)                                   ///< WS2812 bit rate
+#define TIM_WAVE_LED_BITS           (24U)                                       ///< Compare slots per LED, G-R-B, MSB first
+
+#ifndef TIM_WAVE_LED_RESET
+#define TIM_WAVE_LED_RESET          (48U)                                       ///< Low slots latching a frame: 60 us (use 240 for 280 us parts)
+#endif
+
+/// Size of an LED frame buffer, in bytes.
+#define TIM_WAVE_LED_BYTES(leds)    ((u32)(leds) * TIM_WAVE_LED_BITS + TIM_WAVE_LED_RESET)
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIM_WAVE_Exported_Types
+/// @{
+
+struct _TimWave;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Table hook, runs in the DMA interrupt. In circular mode it gets
+///         the half of the table the DMA just left, to refill before the DMA
+///         wraps back to it. In one-shot mode it gets the whole table once
+///         the last step has been loaded.
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*TimWave_Callback)(struct _TimWave* wave, void* steps, u16 count);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Waveform init structure definition. The time base, the output
+///         compare modes and the pins are left to the caller.
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    TIM_TypeDef*                    Timer;                                      ///< TIM1, TIM2, TIM3, TIM16 or TIM17
+    u8                              Channels;                                   ///< CCR1..CCRn written per period, 1..4
+    bool                            ByteTable;                                  ///< Table of u8 instead of u16 compares
+    void*                           Table;                                      ///< Steps x Channels compare values
+    u16                             Steps;                                      ///< Periods in the table, even if Circular
+    bool                            Circular;                                   ///< Repeat the table, or play it once
+    TimWave_Callback                Callback;
+} TimWave_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Waveform state
+////////////////////////////////////////////////////////////////////////////////
+typedef struct _TimWave {
+    TIM_TypeDef*                    Timer;
+    DMA_Channel_TypeDef*            Channel;
+    u8*                             Table;
+    u16                             Steps;
+    u8                              Channels;
+    u8                              ItemBytes;                                  ///< 1 or 2
+    bool                            Circular;
+    volatile bool                   Busy;                                       ///< The table is playing
+    TimWave_Callback                Callback;
+    u8                              LedZero;                                    ///< WS2812 compare for a 0 bit
+    u8                              LedOne;                                     ///< WS2812 compare for a 1 bit
+    u32                             Halves;                                     ///< Table halves (or one-shot tables) delivered
+    u32                             Late;                                       ///< Both halves pending at once: a refill was missed
+    u32                             Errors;                                     ///< DMA transfer errors
+} TimWave_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIM_WAVE_Exported_Functions
+/// @{
+
+void TimWave_StructInit(TimWave_InitTypeDef* init_struct);
+ErrorStatus TimWave_Init(TimWave_TypeDef* wave, const TimWave_InitTypeDef* init_struct);
+ErrorStatus TimWave_Start(TimWave_TypeDef* wave);
+void TimWave_Stop(TimWave_TypeDef* wave);
+ErrorStatus TimWave_LedInit(TimWave_TypeDef* wave, TIM_TypeDef* tim, u8* frame, u16 leds);
+void TimWave_LedEncode(TimWave_TypeDef* wave);
+ErrorStatus TimWave_LedShow(TimWave_TypeDef* wave);
+void TimWave_DMAIRQHandler(TimWave_TypeDef* wave);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __TIM_WAVE_H
+////////////////////////////////////////////////////////////////////////////////
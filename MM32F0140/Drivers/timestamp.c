@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     timestamp.c
+/// @brief    THIS FILE PROVIDES THE MONOTONIC TIMESTAMP SERVICE FUNCTIONS.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// The Cortex-M0 has no cycle counter, so one timer runs free at its full
+/// clock, with no prescaler, and serves as the system time base. The
+/// counter width is probed by writing all ones to ARR: TIM2 keeps 32 bits,
+/// the others 16. The update interrupt counts overflows (epochs), and
+/// time = epoch << width | CNT. Timestamp_Get64 needs no lock and is
+/// callable from any priority:
+///   - epoch, CNT and the pending update flag are read in that order;
+///   - the sequence is retried if the overflow interrupt ran in between;
+///   - an update still pending (the reader masks or outranks the timer
+///     interrupt) adds one epoch if CNT already wrapped, i.e. is in the
+///     lower half.
+/// With TIM2 at 72 MHz, a read costs about 20 cycles, and overflow
+/// interrupts come once a minute. Timestamp_Get32 is then a single
+/// register read; intervals up to 59 s can be taken as the difference of
+/// two Get32 values. With a 16-bit timer, the overflow interrupt runs every
+/// 0.9 ms, and it must not be held off for more than half of that.
+///
+/// The application forwards the vector:
+///   void TIM2_IRQHandler(void) { Timestamp_IRQHandler(); }
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _TIMESTAMP_C_
+
+// Files includes
+#include "timestamp.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup TIMESTAMP
+/// @{
+
+static TIM_TypeDef* timestamp_timer;
+static volatile u32 timestamp_epoch;
+static u32 timestamp_mask;
+static u8 timestamp_bits;
+static u32 timestamp_clock;
+static u32 timestamp_overhead;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Starts the time base and measures the cost of a timestamp pair.
+/// @param  tim: TIM2 (32 bits) or a free 16-bit timer.
+/// @retval ERROR if the timer clock is unknown.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus Timestamp_Init(TIM_TypeDef* tim)
+{
+    TIM_TimeBaseInitTypeDef tim_init;
+    u32 t0, t1, i;
+
+    timestamp_clock = DRV_TimerClock(tim);
+    if (timestamp_clock == 0) {
+        return ERROR;
+    }
+    timestamp_timer = tim;
+    timestamp_epoch = 0;
+
+    DRV_TimerClockCmd(tim, ENABLE);
+    TIM_TimeBaseStructInit(&tim_init);
+    tim_init.TIM_Prescaler = 0;
+    tim_init.TIM_Period    = 0xFFFFFFFF;
+    TIM_TimeBaseInit(tim, &tim_init);
+    timestamp_mask = tim->ARR;
+    timestamp_bits = (timestamp_mask > 0xFFFF) ? 32 : 16;
+    tim->SR = 0;
+    TIM_ITConfig(tim, TIM_IT_Update, ENABLE);
+    DRV_NVICEnable(DRV_TimerIRQn(tim), 0);
+    TIM_Cmd(tim, ENABLE);
+
+    timestamp_overhead = 0xFFFFFFFF;
+    for (i = 0; i < 8; i++) {
+        t0 = Timestamp_Get32();
+        t1 = Timestamp_Get32();
+        timestamp_overhead = (t1 - t0 < timestamp_overhead) ? t1 - t0 : timestamp_overhead;
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the 64-bit monotonic time.
+/// @param  None.
+/// @retval Timer clocks since Timestamp_Init.
+////////////////////////////////////////////////////////////////////////////////
+u64 Timestamp_Get64(void)
+{
+    u32 epoch, cnt, pending;
+
+    do {
+        epoch   = timestamp_epoch;
+        cnt     = timestamp_timer->CNT;
+        pending = timestamp_timer->SR & TIM_SR_UI;
+    } while (epoch != timestamp_epoch);
+    if (pending && (cnt <= (timestamp_mask >> 1))) {
+        epoch++;
+    }
+    return ((u64)epoch << timestamp_bits) + cnt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the low 32 bits of the time, for intervals.
+/// @param  None.
+/// @retval Timer clocks, wrapping at 32 bits.
+////////////////////////////////////////////////////////////////////////////////
+u32 Timestamp_Get32(void)
+{
+    return (timestamp_bits == 32) ? timestamp_timer->CNT : (u32)Timestamp_Get64();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the time base clock.
+/// @param  None.
+/// @retval Hz.
+////////////////////////////////////////////////////////////////////////////////
+u32 Timestamp_GetClock(void)
+{
+    return timestamp_clock;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the clocks measured between two back-to-back
+///         Timestamp_Get32 calls, to subtract from short intervals.
+/// @param  None.
+/// @retval Timer clocks.
+////////////////////////////////////////////////////////////////////////////////
+u32 Timestamp_GetOverhead(void)
+{
+    return timestamp_overhead;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Converts timer clocks to nanoseconds.
+/// @param  ticks: timer clocks, any count.
+/// @retval Nanoseconds.
+////////////////////////////////////////////////////////////////////////////////
+u64 Timestamp_ToNs(u64 ticks)
+{
+    // Whole seconds and the remainder apart, so the product cannot overflow.
+    return (ticks / timestamp_clock) * 1000000000 + (ticks % timestamp_clock) * 1000000000 / timestamp_clock;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Overflow interrupt service.
+/// @param  None.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void Timestamp_IRQHandler(void)
+{
+    if (timestamp_timer->SR & TIM_SR_UI) {
+        timestamp_timer->SR = ~TIM_SR_UI;
+        timestamp_epoch++;
+    }
+}
+
+/// @}
@@ -0,0 +1,37 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     timestamp.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE MONOTONIC
+///           TIMESTAMP SERVICE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __TIMESTAMP_H
+#define __TIMESTAMP_H
+
+// Files includes
+#include "drv_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIMESTAMP
+/// @brief Monotonic timestamp service
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup TIMESTAMP_Exported_Functions
+/// @{
+
+ErrorStatus Timestamp_Init(TIM_TypeDef* tim);
+u64 Timestamp_Get64(void);
+u32 Timestamp_Get32(void);
+u32 Timestamp_GetClock(void);
+u32 Timestamp_GetOverhead(void);
+u64 Timestamp_ToNs(u64 ticks);
+void Timestamp_IRQHandler(void);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __TIMESTAMP_H
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,413 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     uart_link.c
+/// @brief    THIS FILE PROVIDES THE UART LINK BRING-UP FUNCTIONS: AUTO-BAUD
+///           DETECTION, RATE NEGOTIATION AND RUNTIME BAUD SWITCHING.
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Negotiation sequence (all frames are UART_LINK_FRAME_LEN bytes):
+///
+///   peer                             device
+///   0x55 0x55 ...          ---->     auto-baud locks onto the peer's rate
+///   CAPS(peer max)         ---->
+///                          <----     PROPOSE(best common rate)
+///   ACCEPT(rate)           ---->     peer is now silent: frame boundary
+///   (switches after TX)              (switches after ACCEPT is received)
+///   CONFIRM(rate)          ---->     at the new rate
+///                          <----     CONFIRM(rate)
+///
+/// If the CONFIRM exchange fails both ends fall back to the previous rate.
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#define _UART_LINK_C_
+
+// Files includes
+#include "uart_link.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @addtogroup UART_LINK
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Transmits one byte, waiting for room in the TX buffer.
+/// @param  link: pointer to the link state.
+/// @param  value: byte to transmit.
+/// @retval SUCCESS or ERROR on timeout.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus UartLink_PutByte(UartLink_TypeDef* link, u8 value)
+{
+    u32 timeout = link->Timeout;
+
+    while (UART_GetFlagStatus(link->UART, UART_FLAG_TXFULL)) {
+        if (timeout-- == 0) {
+            return ERROR;
+        }
+    }
+    UART_SendData(link->UART, value);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Receives one byte.
+/// @param  link: pointer to the link state.
+/// @param  value: where the byte is stored.
+/// @retval SUCCESS or ERROR on timeout.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus UartLink_GetByte(UartLink_TypeDef* link, u8* value)
+{
+    u32 timeout = link->Timeout;
+
+    while (!UART_GetFlagStatus(link->UART, UART_FLAG_RXAVL)) {
+        if (timeout-- == 0) {
+            return ERROR;
+        }
+    }
+    *value = (u8)UART_ReceiveData(link->UART);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Sends a negotiation frame.
+/// @param  link: pointer to the link state.
+/// @param  cmd: UART_LINK_CMD_xxx.
+/// @param  baud: rate carried by the frame.
+/// @retval SUCCESS or ERROR on timeout.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus UartLink_SendFrame(UartLink_TypeDef* link, u8 cmd, u32 baud)
+{
+    u8 frame[UART_LINK_FRAME_LEN];
+    u8 i;
+
+    frame[0] = UART_LINK_SOF;
+    frame[1] = cmd;
+    frame[2] = (u8)(baud);
+    frame[3] = (u8)(baud >> 8);
+    frame[4] = (u8)(baud >> 16);
+    frame[5] = (u8)(baud >> 24);
+    frame[6] = frame[1] ^ frame[2] ^ frame[3] ^ frame[4] ^ frame[5];
+
+    for (i = 0; i < UART_LINK_FRAME_LEN; i++) {
+        if (UartLink_PutByte(link, frame[i]) != SUCCESS) {
+            return ERROR;
+        }
+    }
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Waits for a negotiation frame with the expected command. Sync
+///         characters and other noise in front of the SOF are skipped.
+/// @param  link: pointer to the link state.
+/// @param  cmd: expected UART_LINK_CMD_xxx.
+/// @param  baud: where the rate carried by the frame is stored.
+/// @retval SUCCESS, or ERROR on timeout, bad checksum or unexpected command.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus UartLink_WaitFrame(UartLink_TypeDef* link, u8 cmd, u32* baud)
+{
+    u8 frame[UART_LINK_FRAME_LEN];
+    u8 i;
+    u8 skip = 0;
+
+    do {
+        if (UartLink_GetByte(link, &frame[0]) != SUCCESS) {
+            return ERROR;
+        }
+    } while ((frame[0] != UART_LINK_SOF) && (++skip < 64));
+
+    if (frame[0] != UART_LINK_SOF) {
+        return ERROR;
+    }
+    for (i = 1; i < UART_LINK_FRAME_LEN; i++) {
+        if (UartLink_GetByte(link, &frame[i]) != SUCCESS) {
+            return ERROR;
+        }
+    }
+    if ((frame[1] ^ frame[2] ^ frame[3] ^ frame[4] ^ frame[5]) != frame[6]) {
+        return ERROR;
+    }
+    if (frame[1] != cmd) {
+        return ERROR;
+    }
+    *baud = (u32)frame[2] | ((u32)frame[3] << 8) | ((u32)frame[4] << 16) | ((u32)frame[5] << 24);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Programs a pre-computed divider once the line is idle.
+/// @param  link: pointer to the link state.
+/// @param  brr: integer part of the divider.
+/// @param  fra: fractional part of the divider.
+/// @retval SUCCESS or ERROR if the transmitter never drained.
+////////////////////////////////////////////////////////////////////////////////
+static ErrorStatus UartLink_WriteDivider(UartLink_TypeDef* link, u32 brr, u32 fra)
+{
+    u32 timeout = link->Timeout * UART_LINK_FRAME_LEN;
+
+    // Frame boundary: TX buffer and shift register empty, nothing pending in RX.
+    while (!UART_GetFlagStatus(link->UART, UART_FLAG_TXEPT)) {
+        if (timeout-- == 0) {
+            return ERROR;
+        }
+    }
+    while (UART_GetFlagStatus(link->UART, UART_FLAG_RXAVL)) {
+        (void)UART_ReceiveData(link->UART);
+    }
+
+    UART_Cmd(link->UART, DISABLE);
+    link->UART->BRR = brr;
+    link->UART->FRA = fra;
+    UART_Cmd(link->UART, ENABLE);
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the highest table rate not above limit whose divider error
+///         stays within the configured bound.
+/// @param  link: pointer to the link state.
+/// @param  limit: upper bound, 0 for none.
+/// @retval The selected rate, or 0 if no entry qualifies.
+////////////////////////////////////////////////////////////////////////////////
+static u32 UartLink_BestRate(UartLink_TypeDef* link, u32 limit)
+{
+    u32 pclk = UartLink_GetClock(link->UART);
+    u32 brr, fra;
+    u16 error;
+    s32 i;
+
+    for (i = (s32)link->BaudCount - 1; i >= 0; i--) {
+        if ((limit != 0) && (link->BaudTable[i] > limit)) {
+            continue;
+        }
+        if (UartLink_CalcDivider(pclk, link->BaudTable[i], link->MaxErrorPermille, &brr, &fra, &error) == SUCCESS) {
+            return link->BaudTable[i];
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Fills each init_struct member with its default value.
+/// @param  init_struct: pointer to a UartLink_InitTypeDef structure
+///         which will be initialized.
+/// @retval None.
+////////////////////////////////////////////////////////////////////////////////
+void UartLink_StructInit(UartLink_InitTypeDef* init_struct)
+{
+    static const u32 default_rates[] = {
+        115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000
+    };
+
+    init_struct->UART             = UART1;
+    init_struct->StartBaud        = 115200;
+    init_struct->BaudTable        = default_rates;
+    init_struct->BaudCount        = sizeof(default_rates) / sizeof(default_rates[0]);
+    init_struct->MaxErrorPermille = UART_LINK_DEFAULT_ERROR;
+    init_struct->Timeout          = UART_LINK_DEFAULT_TIMEOUT;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Initializes the link state and programs the start rate. The UART
+///         pins, clock and frame format must already be set up by UART_Init.
+/// @param  link: pointer to the link state.
+/// @param  init_struct: pointer to a UartLink_InitTypeDef structure.
+/// @retval SUCCESS, or ERROR if the start rate cannot be programmed.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_Init(UartLink_TypeDef* link, UartLink_InitTypeDef* init_struct)
+{
+    link->UART             = init_struct->UART;
+    link->BaudTable        = init_struct->BaudTable;
+    link->BaudCount        = init_struct->BaudCount;
+    link->MaxErrorPermille = init_struct->MaxErrorPermille;
+    link->Timeout          = init_struct->Timeout;
+    link->Baud             = 0;
+    link->PeerMaxBaud      = 0;
+    link->ErrorPermille    = 0;
+
+    UART_AutoBaudRateCmd(link->UART, DISABLE);
+    return UartLink_SetBaud(link, init_struct->StartBaud);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the kernel clock of the given UART.
+/// @param  uart: UART1, UART2 or UART3.
+/// @retval PCLK2 for UART1, PCLK1 for the others (same rule as UART_Init).
+////////////////////////////////////////////////////////////////////////////////
+u32 UartLink_GetClock(UART_TypeDef* uart)
+{
+    return (uart == UART1) ? RCC_GetPCLK2Freq() : RCC_GetPCLK1Freq();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Computes the rounded BRR/FRA pair for a rate and checks the error.
+/// @param  pclk: UART kernel clock in Hz.
+/// @param  baud: requested rate.
+/// @param  max_error: highest accepted error in 0.1 %.
+/// @param  brr: integer divider output.
+/// @param  fra: fractional (1/16) divider output.
+/// @param  error: actual error output in 0.1 %.
+/// @retval SUCCESS if the rate is reachable within max_error.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_CalcDivider(u32 pclk, u32 baud, u16 max_error, u32* brr, u32* fra, u16* error)
+{
+    u32 div16, actual, diff;
+
+    if (baud == 0) {
+        return ERROR;
+    }
+    div16 = (pclk + baud / 2) / baud;
+    if (div16 < 16) {
+        return ERROR;
+    }
+    actual = pclk / div16;
+    diff   = (actual > baud) ? (actual - baud) : (baud - actual);
+
+    *brr   = div16 / 16;
+    *fra   = div16 % 16;
+    *error = (u16)((diff * 1000U) / baud);
+
+    return (*error <= max_error) ? SUCCESS : ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Measures the peer's rate from a 0x55 sync character and snaps it
+///         to the closest supported table rate.
+/// @param  link: pointer to the link state.
+/// @retval SUCCESS if a supported rate was recognised.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_AutoDetect(UartLink_TypeDef* link)
+{
+    UART_TypeDef* uart = link->UART;
+    u32 timeout = link->Timeout * 16;
+    u32 pclk = UartLink_GetClock(uart);
+    u32 measured, div16, diff, best = 0, best_diff = U32_MAX;
+    u8 i;
+
+    WRITE_REG(uart->ICR, UART_ICR_ABRENDCLR | UART_ICR_ABRERRCLR);
+    UART_AutoBaudRateSet(uart, ABRMODE_VALUE0X55, ENABLE);
+
+    while (!(uart->ISR & (UART_ISR_ABREND_INTF | UART_ISR_ABRERR_INTF))) {
+        if (timeout-- == 0) {
+            UART_AutoBaudRateCmd(uart, DISABLE);
+            return ERROR;
+        }
+    }
+    UART_AutoBaudRateCmd(uart, DISABLE);
+
+    if (uart->ISR & UART_ISR_ABRERR_INTF) {
+        WRITE_REG(uart->ICR, UART_ICR_ABRENDCLR | UART_ICR_ABRERRCLR);
+        return ERROR;
+    }
+    WRITE_REG(uart->ICR, UART_ICR_ABRENDCLR);
+
+    // The hardware loaded BRR/FRA from the measured bit time.
+    div16 = uart->BRR * 16 + uart->FRA;
+    if (div16 == 0) {
+        return ERROR;
+    }
+    measured = pclk / div16;
+
+    for (i = 0; i < link->BaudCount; i++) {
+        diff = (measured > link->BaudTable[i]) ? (measured - link->BaudTable[i]) : (link->BaudTable[i] - measured);
+        if (diff < best_diff) {
+            best_diff = diff;
+            best      = link->BaudTable[i];
+        }
+    }
+    if ((best == 0) || ((best_diff * 1000U) / best > link->MaxErrorPermille * 2U)) {
+        return ERROR;
+    }
+    return UartLink_SetBaud(link, best);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Negotiates the highest rate both ends support and switches to it.
+///         Must be called at the rate the peer is currently using.
+/// @param  link: pointer to the link state.
+/// @retval SUCCESS if the link runs at the negotiated rate, ERROR if the
+///         exchange failed (the previous rate is then restored).
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_Negotiate(UartLink_TypeDef* link)
+{
+    u32 old_baud = link->Baud;
+    u32 peer_max, best, echo;
+
+    if (UartLink_WaitFrame(link, UART_LINK_CMD_CAPS, &peer_max) != SUCCESS) {
+        return ERROR;
+    }
+    link->PeerMaxBaud = peer_max;
+
+    best = UartLink_BestRate(link, peer_max);
+    if (best == 0) {
+        best = old_baud;
+    }
+
+    if (UartLink_SendFrame(link, UART_LINK_CMD_PROPOSE, best) != SUCCESS) {
+        return ERROR;
+    }
+    if ((UartLink_WaitFrame(link, UART_LINK_CMD_ACCEPT, &echo) != SUCCESS) || (echo != best)) {
+        return ERROR;
+    }
+
+    // The peer has finished its ACCEPT frame and switches once it is out.
+    if (UartLink_SetBaud(link, best) != SUCCESS) {
+        return ERROR;
+    }
+
+    if ((UartLink_WaitFrame(link, UART_LINK_CMD_CONFIRM, &echo) == SUCCESS) && (echo == best)) {
+        if (UartLink_SendFrame(link, UART_LINK_CMD_CONFIRM, best) == SUCCESS) {
+            return SUCCESS;
+        }
+    }
+
+    UartLink_SetBaud(link, old_baud);
+    return ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Full bring-up: auto-detect the peer's rate, then negotiate up.
+/// @param  link: pointer to the link state.
+/// @retval ERROR if auto-baud saw no usable sync, else the result of the
+///         negotiation.
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_BringUp(UartLink_TypeDef* link)
+{
+    if (UartLink_AutoDetect(link) != SUCCESS) {
+        return ERROR;
+    }
+    return UartLink_Negotiate(link);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Switches the link to a new rate at the next frame boundary.
+/// @param  link: pointer to the link state.
+/// @param  baud: new rate.
+/// @retval SUCCESS, or ERROR if the rate exceeds the error limit or the
+///         transmitter never drained (the old rate is then kept).
+////////////////////////////////////////////////////////////////////////////////
+ErrorStatus UartLink_SetBaud(UartLink_TypeDef* link, u32 baud)
+{
+    u32 brr, fra;
+    u16 error;
+
+    if (UartLink_CalcDivider(UartLink_GetClock(link->UART), baud, link->MaxErrorPermille, &brr, &fra, &error) != SUCCESS) {
+        return ERROR;
+    }
+    if (UartLink_WriteDivider(link, brr, fra) != SUCCESS) {
+        return ERROR;
+    }
+    link->Baud          = baud;
+    link->ErrorPermille = error;
+    return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  Returns the nominal rate currently programmed.
+/// @param  link: pointer to the link state.
+/// @retval Rate in baud.
+////////////////////////////////////////////////////////////////////////////////
+u32 UartLink_GetBaud(UartLink_TypeDef* link)
+{
+    return link->Baud;
+}
+
+/// @}
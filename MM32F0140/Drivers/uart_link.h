@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file     uart_link.h
+/// @brief    THIS FILE CONTAINS ALL THE FUNCTIONS PROTOTYPES FOR THE UART LINK
+///           BRING-UP (AUTO-BAUD, RATE NEGOTIATION AND RUNTIME BAUD SWITCH).
+////////////////////////////////////////////////////////////////////////////////
+
+// Define to prevent recursive inclusion
+#ifndef __UART_LINK_H
+#define __UART_LINK_H
+
+// Files includes
+#include "hal_conf.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup UART_LINK
+/// @brief UART link bring-up driver
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup UART_LINK_Exported_Constants
+/// @{
+
+#define UART_LINK_SOF               (0xA5U)                                     ///< Start of every negotiation frame
+
+#define UART_LINK_CMD_CAPS          (0x01U)                                     ///< Peer -> device: highest rate the peer supports
+#define UART_LINK_CMD_PROPOSE       (0x02U)                                     ///< Device -> peer: rate to switch to
+#define UART_LINK_CMD_ACCEPT        (0x03U)                                     ///< Peer -> device: proposal accepted, switch now
+#define UART_LINK_CMD_CONFIRM       (0x04U)                                     ///< Both: link verified at the new rate
+
+#define UART_LINK_FRAME_LEN         (7U)                                        ///< SOF + CMD + 4 byte rate (LE) + XOR checksum
+
+#define UART_LINK_DEFAULT_ERROR     (20U)                                       ///< Default baud error limit, 2.0 %
+#define UART_LINK_DEFAULT_TIMEOUT   (200000U)                                   ///< Default per-byte spin count
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup UART_LINK_Exported_Types
+/// @{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  UART link init structure definition
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    UART_TypeDef*   UART;                                                       ///< UART1, UART2 or UART3
+    u32             StartBaud;                                                  ///< Rate used when auto-baud is skipped or fails
+    const u32*      BaudTable;                                                  ///< Rates this end supports, ascending
+    u8              BaudCount;                                                  ///< Number of entries in BaudTable
+    u16             MaxErrorPermille;                                           ///< Highest accepted divider error, in 0.1 %
+    u32             Timeout;                                                    ///< Spin count allowed per received byte
+} UartLink_InitTypeDef;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief  UART link state definition
+////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    UART_TypeDef*   UART;
+    const u32*      BaudTable;
+    u8              BaudCount;
+    u16             MaxErrorPermille;
+    u32             Timeout;
+    u32             Baud;                                                       ///< Nominal rate currently programmed
+    u32             PeerMaxBaud;                                                ///< Highest rate advertised by the peer
+    u16             ErrorPermille;                                              ///< Divider error of the current rate
+} UartLink_TypeDef;
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @defgroup UART_LINK_Exported_Functions
+/// @{
+
+void UartLink_StructInit(UartLink_InitTypeDef* init_struct);
+ErrorStatus UartLink_Init(UartLink_TypeDef* link, UartLink_InitTypeDef* init_struct);
+
+u32 UartLink_GetClock(UART_TypeDef* uart);
+ErrorStatus UartLink_CalcDivider(u32 pclk, u32 baud, u16 max_error, u32* brr, u32* fra, u16* error);
+
+ErrorStatus UartLink_AutoDetect(UartLink_TypeDef* link);
+ErrorStatus UartLink_Negotiate(UartLink_TypeDef* link);
+ErrorStatus UartLink_BringUp(UartLink_TypeDef* link);
+ErrorStatus UartLink_SetBaud(UartLink_TypeDef* link, u32 baud);
+u32 UartLink_GetBaud(UartLink_TypeDef* link);
+
+/// @}
+
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif // __UART_LINK_H
+////////////////////////////////////////////////////////////////////////////////
@@ -200,9 +200,6 @@ typedef enum {
 
 #define GLOBAL
 
-static u8 I2C_CMD_DIR = 0;
-u16       I2C_DMA_DIR = 0;
-
 #else
 #define GLOBAL extern
 #endif
@@ -22,6 +22,10 @@
 #include "hal_i2c.h"
 #include "hal_rcc.h"
 
+// I2C_CheckEvent read-command latch and DMA direction; private to this file.
+static u8  I2C_CMD_DIR = 0;
+static u16 I2C_DMA_DIR = 0;
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @addtogroup MM32_Hardware_Abstract_Layer
 /// @{
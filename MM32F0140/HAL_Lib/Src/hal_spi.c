@@ -569,6 +569,7 @@ void I2S_Init(SPI_TypeDef* spi, I2S_InitTypeDef* I2S_InitStruct)
             if (remainder > ((16 * packetlength * (I2S_InitStruct->I2S_AudioFreq)))) {
                 result = result + 1;
             }
+            i2sdiv = result;
             if ((i2sdiv < 1) || (i2sdiv > 0x1FF)) {
                 i2sdiv = 1;
             }